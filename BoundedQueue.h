@@ -0,0 +1,205 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// Colas acotadas sin locks para conectar etapas de un pipeline. try_push y
+// try_pop nunca bloquean; push y pop esperan (girando, después cediendo el
+// hilo y al final durmiendo de a poco) a que haya lugar o datos, que es lo que
+// frena a una etapa rápida cuando la siguiente no da abasto. Cuando los
+// productores terminan llaman a close(): pop devuelve false una vez vaciada.
+// La capacidad se redondea a una potencia de dos.
+namespace queue_detail {
+
+constexpr size_t CACHE_LINE = 64;
+
+inline size_t round_capacity(size_t capacity) {
+    if (capacity == 0) throw std::runtime_error("La capacidad de la cola debe ser positiva");
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    return rounded;
+}
+
+} // namespace queue_detail
+
+// Espera creciente para reintentar una operación que no bloquea
+class Backoff {
+public:
+    void pause() {
+        if (++rounds <= 64) return;
+        if (rounds <= 128) {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+private:
+    unsigned rounds = 0;
+};
+
+// Un productor y un consumidor: un anillo con los índices de escritura y de
+// lectura en líneas de caché separadas; cada lado guarda una copia del índice
+// del otro para no leer el atómico compartido en cada operación.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : slots(queue_detail::round_capacity(capacity)), mask(slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool try_push(T& value) {
+        size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cached_other > mask) {
+            producer.cached_other = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cached_other > mask) return false;
+        }
+        slots[tail & mask] = std::move(value);
+        producer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cached_other) {
+            consumer.cached_other = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cached_other) return false;
+        }
+        out = std::move(slots[head & mask]);
+        consumer.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value) {
+        Backoff backoff;
+        while (!try_push(value)) backoff.pause();
+    }
+
+    bool pop(T& out) {
+        Backoff backoff;
+        while (!try_pop(out)) {
+            if (closed.load(std::memory_order_acquire)) return try_pop(out);
+            backoff.pause();
+        }
+        return true;
+    }
+
+    void close() { closed.store(true, std::memory_order_release); }
+
+    // Cerrada y sin elementos: el consumidor ya no va a recibir nada
+    bool finished() const {
+        return closed.load(std::memory_order_acquire) &&
+               consumer.index.load(std::memory_order_acquire) == producer.index.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    struct alignas(queue_detail::CACHE_LINE) Side {
+        std::atomic<size_t> index{0};
+        size_t cached_other = 0;
+    };
+
+    std::vector<T> slots;
+    size_t mask;
+    Side producer;
+    Side consumer;
+    std::atomic<bool> closed{false};
+};
+
+// Varios productores y consumidores (la cola acotada de Vyukov): cada casilla
+// lleva un número de secuencia que dice si está libre para la vuelta actual
+// del productor o lista para la del consumidor, así que cada lado solo compite
+// por su propio índice con un compare-exchange.
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity)
+        : cells(queue_detail::round_capacity(capacity)), mask(cells.size() - 1) {
+        for (size_t i = 0; i < cells.size(); ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    bool try_push(T& value) {
+        size_t position = tail.value.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (diff == 0) {
+                if (tail.value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // llena
+            } else {
+                position = tail.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        size_t position = head.value.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (diff == 0) {
+                if (head.value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // vacía
+            } else {
+                position = head.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(T value) {
+        Backoff backoff;
+        while (!try_push(value)) backoff.pause();
+    }
+
+    // Con varios productores, close() va después de que terminen todos
+    bool pop(T& out) {
+        Backoff backoff;
+        while (!try_pop(out)) {
+            if (closed.load(std::memory_order_acquire)) return try_pop(out);
+            backoff.pause();
+        }
+        return true;
+    }
+
+    void close() { closed.store(true, std::memory_order_release); }
+    bool is_closed() const { return closed.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return cells.size(); }
+
+private:
+    struct alignas(queue_detail::CACHE_LINE) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    struct alignas(queue_detail::CACHE_LINE) Index {
+        std::atomic<size_t> value{0};
+    };
+
+    std::vector<Cell> cells;
+    size_t mask;
+    Index tail;
+    Index head;
+    std::atomic<bool> closed{false};
+};
@@ -0,0 +1,289 @@
+#pragma once
+#include "InvertedIndex.h"
+#include "IndexWriter.h"
+#include "SegmentedIndex.h"
+#include "Epoch.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+
+struct ConcurrentIndexOptions {
+    CodecType codec = CodecType::Gamma;
+    // add_document publica solo al juntar estos documentos (0 = solo con publish())
+    size_t publish_documents = 1024;
+    // Partes de un mismo nivel que se fusionan juntas; el nivel de una parte
+    // es cuántas veces entra merge_factor entre base_postings y sus postings
+    size_t merge_factor = 4;
+    size_t base_postings = size_t(1) << 16;
+    // Sin hilo de fusión, las fusiones corren dentro de la publicación con el
+    // lock de los escritores tomado: add_document espera a que terminen
+    bool background_merges = true;
+};
+
+// Índice en memoria que se consulta desde cualquier cantidad de hilos mientras
+// otro agrega documentos, sin que los lectores tomen locks. Cada publicación
+// arma una versión inmutable: la lista de partes (InvertedIndex que ya no
+// cambian) con los documentos agregados desde la anterior como parte nueva.
+// Un lector toma un Snapshot, que fija la época (ver Epoch.h) y lee el puntero
+// a la versión vigente; todo lo que consulte con él ve esa versión aunque el
+// escritor publique otras. La versión reemplazada se libera cuando ya no la
+// puede estar leyendo nadie.
+//
+// Como en SegmentedIndex, un hilo de fondo fusiona las partes por niveles para
+// que una consulta recorra pocas y publica cada fusión como otra versión.
+// Los doc IDs deben ser únicos en todo el índice y cada documento se agrega
+// una sola vez. Los documentos agregados aparecen en las consultas al
+// publicarse. Los Snapshot no deben sobrevivir al índice.
+class ConcurrentIndex {
+public:
+    // Parte inmutable de una versión; varias versiones la comparten
+    struct Part : ImmutableIndex {
+        uint64_t postings = 0;
+
+        explicit Part(CodecType codec) : ImmutableIndex(codec) {}
+    };
+
+    struct Version {
+        std::vector<std::shared_ptr<const Part>> parts;
+        uint64_t number = 0;
+        uint64_t documents = 0;
+    };
+
+    // Vista consistente de una versión; mientras vive, esa versión no se libera
+    class Snapshot {
+    public:
+        // Consulta booleana (sintaxis de QueryEngine) sobre todas las partes
+        std::vector<uint32_t> search(const std::string& query) const {
+            return SegmentedIndex::search_all(prepared_indexes(version->parts, query), query);
+        }
+
+        std::vector<ScoredDoc> top_k(const std::string& query, size_t k) const {
+            return SegmentedIndex::top_k_all(prepared_indexes(version->parts, query), query, k);
+        }
+
+        // Docs de un solo término, como InvertedIndex::search
+        std::vector<uint32_t> term_docs(const std::string& term) const {
+            std::vector<uint32_t> result;
+            for (const auto& part : version->parts) {
+                std::vector<uint32_t> docs = part->index.search(term);
+                result.insert(result.end(), docs.begin(), docs.end());
+            }
+            if (version->parts.size() > 1) std::sort(result.begin(), result.end());
+            return result;
+        }
+
+        uint64_t version_number() const { return version->number; }
+        uint64_t document_count() const { return version->documents; }
+        size_t part_count() const { return version->parts.size(); }
+
+    private:
+        friend class ConcurrentIndex;
+        EpochDomain::Guard guard;
+        const Version* version;
+
+        Snapshot(EpochDomain::Guard guard, const Version* version) : guard(std::move(guard)), version(version) {}
+    };
+
+    explicit ConcurrentIndex(const ConcurrentIndexOptions& options = {}) : options(options) {
+        if (options.merge_factor < 2) {
+            throw std::runtime_error("merge_factor debe ser al menos 2");
+        }
+        current.store(new Version(), std::memory_order_release);
+        reset_buffer();
+        if (options.background_merges) merger = std::thread([this] { merge_loop(); });
+    }
+
+    // Sin lectores vivos: libera la versión vigente (y epochs, las retiradas).
+    // Una fusión en curso termina antes.
+    ~ConcurrentIndex() {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            stopping = true;
+        }
+        merge_wakeup.notify_all();
+        if (merger.joinable()) merger.join();
+        delete current.load(std::memory_order_acquire);
+    }
+
+    ConcurrentIndex(const ConcurrentIndex&) = delete;
+    ConcurrentIndex& operator=(const ConcurrentIndex&) = delete;
+
+    // Para los lectores: no toma locks
+    Snapshot snapshot() const {
+        EpochDomain::Guard guard = epochs.pin();
+        return Snapshot(std::move(guard), current.load(std::memory_order_seq_cst));
+    }
+
+    std::vector<uint32_t> search(const std::string& query) const { return snapshot().search(query); }
+    std::vector<ScoredDoc> top_k(const std::string& query, size_t k) const { return snapshot().top_k(query, k); }
+
+    // Los escritores se turnan entre sí; nunca esperan a los lectores
+    void add_document(uint32_t doc_id, const std::vector<std::string>& terms) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        writer->add_document(doc_id, terms);
+        if (options.publish_documents > 0 && writer->pending_documents() >= options.publish_documents) {
+            publish_locked();
+        }
+    }
+
+    // 'documents' es un rango de pares (doc ID, términos); se publica al final
+    template <typename Range>
+    void add_documents(const Range& documents) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        for (const auto& document : documents) writer->add_document(document.first, document.second);
+        publish_locked();
+    }
+
+    // Hace visibles los documentos agregados hasta ahora
+    void publish() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish_locked();
+    }
+
+    // Espera a que el hilo de fondo no tenga fusiones pendientes
+    void wait_for_merges() {
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        merge_idle.wait(lock, [this] { return merge_error || (!merging && pick_merge().empty()); });
+        if (merge_error) std::rethrow_exception(merge_error);
+    }
+
+    size_t merge_count() const {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return merges;
+    }
+
+    // Versiones reemplazadas que todavía puede estar leyendo algún Snapshot
+    size_t retired_versions() const {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return epochs.pending();
+    }
+
+private:
+    ConcurrentIndexOptions options;
+
+    mutable EpochDomain epochs;
+    std::atomic<const Version*> current{nullptr};
+
+    // Lo toman los escritores y el hilo de fusión para instalar una versión
+    mutable std::mutex writer_mutex;
+    // Parte en armado: 'writer' le escribe, así que se destruye antes que ella
+    std::shared_ptr<Part> buffer;
+    std::unique_ptr<IndexWriter> writer;
+    size_t merges = 0;
+
+    std::thread merger;
+    std::condition_variable merge_wakeup;
+    std::condition_variable merge_idle;
+    bool stopping = false;
+    bool merging = false;
+    std::exception_ptr merge_error;
+
+    void reset_buffer() {
+        writer.reset();
+        buffer = std::make_shared<Part>(options.codec);
+        writer = std::make_unique<IndexWriter>(buffer->index, SIZE_MAX);
+        writer->set_auto_compact(false);
+    }
+
+    // Con 'writer_mutex' tomado
+    void publish_locked() {
+        if (merge_error) std::rethrow_exception(merge_error);
+        size_t documents = writer->pending_documents();
+        if (documents == 0) return;
+        buffer->postings = writer->pending_postings();
+        writer->flush();
+        // merge_into recorre los términos con term_cursor
+        buffer->index.flush_lexicon();
+        std::shared_ptr<const Part> part = std::move(buffer);
+        reset_buffer();
+
+        const Version& live = *current.load(std::memory_order_relaxed);
+        auto next = std::make_unique<Version>();
+        next->parts = live.parts;
+        next->parts.push_back(std::move(part));
+        next->documents = live.documents + documents;
+        install(std::move(next));
+
+        if (options.background_merges) {
+            merge_wakeup.notify_all();
+        } else {
+            for (auto inputs = pick_merge(); !inputs.empty(); inputs = pick_merge()) replace(inputs, merge(inputs));
+        }
+    }
+
+    // Reemplaza la versión vigente y retira la anterior
+    void install(std::unique_ptr<Version> next) {
+        const Version* old = current.load(std::memory_order_relaxed);
+        next->number = old->number + 1;
+        current.store(next.release(), std::memory_order_seq_cst);
+        epochs.retire([old] { delete old; });
+        epochs.reclaim();
+    }
+
+    // Con 'writer_mutex' tomado: las partes a fusionar según pick_tiered_merge
+    std::vector<std::shared_ptr<const Part>> pick_merge() const {
+        return pick_tiered_merge(current.load(std::memory_order_relaxed)->parts, options.base_postings,
+                                 options.merge_factor, [](const Part& part) { return part.postings; });
+    }
+
+    // Arma la parte fusionada; no toca la versión vigente
+    std::shared_ptr<const Part> merge(const std::vector<std::shared_ptr<const Part>>& inputs) const {
+        auto merged = std::make_shared<Part>(options.codec);
+        std::vector<const InvertedIndex*> indexes;
+        for (const auto& input : inputs) {
+            indexes.push_back(&input->index);
+            merged->postings += input->postings;
+        }
+        SegmentedIndex::merge_into(indexes, merged->index);
+        return merged;
+    }
+
+    // Con 'writer_mutex' tomado: instala una versión con 'merged' en lugar de
+    // 'inputs'. Solo las fusiones sacan partes, así que siguen todas vivas.
+    void replace(const std::vector<std::shared_ptr<const Part>>& inputs, std::shared_ptr<const Part> merged) {
+        const Version& live = *current.load(std::memory_order_relaxed);
+        auto next = std::make_unique<Version>();
+        for (const auto& part : live.parts) {
+            if (std::find(inputs.begin(), inputs.end(), part) == inputs.end()) next->parts.push_back(part);
+        }
+        next->parts.push_back(std::move(merged));
+        next->documents = live.documents;
+        install(std::move(next));
+        ++merges;
+    }
+
+    void merge_loop() {
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        while (!stopping) {
+            std::vector<std::shared_ptr<const Part>> inputs;
+            if (!merge_error) inputs = pick_merge();
+            if (inputs.empty()) {
+                merge_idle.notify_all();
+                merge_wakeup.wait(lock);
+                continue;
+            }
+            merging = true;
+            lock.unlock();
+            std::shared_ptr<const Part> merged;
+            try {
+                merged = merge(inputs);
+            } catch (...) {
+                lock.lock();
+                merge_error = std::current_exception();
+                merging = false;
+                continue;
+            }
+            lock.lock();
+            replace(inputs, std::move(merged));
+            merging = false;
+        }
+    }
+};
@@ -0,0 +1,141 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+
+// Distribución de las longitudes de documento (en términos)
+enum class LengthDistribution { Fixed, Uniform, LogNormal };
+
+struct CorpusSpec {
+    uint64_t seed = 42;
+    uint32_t vocabulary = 100000;
+    // Exponente s de Zipf: el término de rango r aparece con probabilidad ∝ 1 / r^s
+    double zipf = 1.0;
+    uint32_t documents = 10000;
+    LengthDistribution lengths = LengthDistribution::LogNormal;
+    // Longitud media; Uniform va de 1 a 2·mean - 1 y LogNormal usa length_sigma
+    double mean_length = 200;
+    double length_sigma = 0.8;
+};
+
+// Corpus sintético reproducible: la misma especificación da el mismo texto en
+// cualquier máquina. Los términos se sacan de un vocabulario con distribución
+// de Zipf y la palabra de rango r es r en base 26 biyectiva (a, b, ..., z, aa,
+// ab, ...), así que los frecuentes son cortos como en un texto real y todas
+// son de letras, que es lo que conserva el tokenizador. El azar sale de
+// mt19937_64 (su secuencia está fijada por el estándar) con las
+// transformaciones hechas acá y no con las distribuciones de <random>, que
+// cambian entre bibliotecas.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusSpec& spec) : spec(spec), rng(spec.seed) {
+        if (spec.vocabulary == 0) throw std::runtime_error("El vocabulario del corpus está vacío");
+        // Acumulada de Zipf para elegir rangos con una búsqueda binaria
+        cdf.resize(spec.vocabulary);
+        double sum = 0;
+        for (uint32_t rank = 0; rank < spec.vocabulary; ++rank) {
+            sum += 1.0 / std::pow(static_cast<double>(rank + 1), spec.zipf);
+            cdf[rank] = sum;
+        }
+        for (double& value : cdf) value /= sum;
+    }
+
+    const CorpusSpec& specification() const { return spec; }
+
+    static std::string word(uint32_t rank) {
+        std::string out;
+        uint64_t n = uint64_t(rank) + 1;
+        while (n > 0) {
+            --n;
+            out += static_cast<char>('a' + n % 26);
+            n /= 26;
+        }
+        std::reverse(out.begin(), out.end());
+        return out;
+    }
+
+    // Rango (0 = el más frecuente) de un término al azar
+    uint32_t next_rank() {
+        double u = uniform();
+        return static_cast<uint32_t>(std::lower_bound(cdf.begin(), cdf.end() - 1, u) - cdf.begin());
+    }
+
+    uint32_t next_length() {
+        double length = spec.mean_length;
+        switch (spec.lengths) {
+            case LengthDistribution::Fixed:
+                break;
+            case LengthDistribution::Uniform:
+                length = 1 + uniform() * (2 * spec.mean_length - 1);
+                break;
+            case LengthDistribution::LogNormal: {
+                // Media mean_length: mu = ln(mean) - sigma² / 2
+                double sigma = spec.length_sigma;
+                double mu = std::log(spec.mean_length) - sigma * sigma / 2;
+                length = std::exp(mu + sigma * normal());
+                break;
+            }
+        }
+        return static_cast<uint32_t>(std::max(1.0, std::floor(length)));
+    }
+
+    // Rangos de los términos del próximo documento
+    void next_document(std::vector<uint32_t>& ranks) {
+        ranks.resize(next_length());
+        for (uint32_t& rank : ranks) rank = next_rank();
+    }
+
+    // Escribe spec.documents documentos, uno por línea, repartidos en 'files'
+    // archivos <prefix>NNNN.txt; devuelve las rutas
+    std::vector<std::string> write_files(const std::string& prefix, size_t files) {
+        files = std::max<size_t>(files, 1);
+        std::vector<std::string> paths;
+        std::vector<std::string> words(spec.vocabulary);
+        for (uint32_t rank = 0; rank < spec.vocabulary; ++rank) words[rank] = word(rank);
+
+        std::vector<uint32_t> ranks;
+        std::string line;
+        uint32_t doc = 0;
+        for (size_t f = 0; f < files; ++f) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%04zu.txt", f);
+            paths.push_back(prefix + name);
+            std::ofstream out(paths.back(), std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("No se pudo escribir el archivo: " + paths.back());
+            uint32_t until = static_cast<uint32_t>(uint64_t(spec.documents) * (f + 1) / files);
+            for (; doc < until; ++doc) {
+                next_document(ranks);
+                line.clear();
+                for (size_t i = 0; i < ranks.size(); ++i) {
+                    if (i > 0) line += ' ';
+                    line += words[ranks[i]];
+                }
+                line += '\n';
+                out.write(line.data(), static_cast<std::streamsize>(line.size()));
+            }
+            if (!out) throw std::runtime_error("No se pudo escribir el archivo: " + paths.back());
+        }
+        return paths;
+    }
+
+private:
+    CorpusSpec spec;
+    std::mt19937_64 rng;
+    std::vector<double> cdf;
+
+    // [0, 1) con 53 bits
+    double uniform() { return static_cast<double>(rng() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Normal estándar (Box-Muller)
+    double normal() {
+        double u1 = 1.0 - uniform(); // (0, 1]
+        double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+};
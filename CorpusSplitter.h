@@ -0,0 +1,247 @@
+#pragma once
+#include "Tokenizer.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Qué es un documento del corpus. Con File, cada archivo es un documento y su
+// doc ID es su índice en la lista. Con Delimiter, cada archivo se parte en
+// documentos en cada aparición de 'delimiter' (que no se indexa) y los doc IDs
+// son correlativos en el orden de los archivos: el documento k de un archivo
+// es el k-ésimo tramo, aunque esté vacío. Un archivo que termina con el
+// delimitador no agrega un documento vacío al final.
+struct DocumentModel {
+    enum class Kind { File, Delimiter };
+
+    Kind kind = Kind::File;
+    std::string delimiter;
+
+    static DocumentModel per_file() { return {}; }
+    static DocumentModel per_line() { return per_delimiter("\n"); }
+    static DocumentModel per_delimiter(const std::string& delimiter) {
+        if (delimiter.empty()) throw std::runtime_error("El delimitador de documentos está vacío");
+        return {Kind::Delimiter, delimiter};
+    }
+};
+
+// Tramo [begin, end) de un archivo; 'first_doc' es el doc ID de su primer byte
+struct CorpusChunk {
+    size_t file;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t first_doc;
+};
+
+// Reparte un conjunto de archivos en tramos de unos chunk_bytes para indexar
+// un mismo archivo con todos los hilos. Los cortes caen en un espacio, así que
+// ninguna palabra queda partida, ni tampoco una aparición del delimitador. Con
+// documentos por delimitador se hace antes una pasada en paralelo que cuenta
+// los delimitadores de cada tramo para saber el doc ID con que empieza.
+// Cada hilo lee sus tramos con pread a un buffer propio, que el tokenizador
+// modifica en su lugar.
+class CorpusSplitter {
+public:
+    static constexpr size_t DEFAULT_CHUNK = size_t(16) << 20;
+
+    CorpusSplitter(std::vector<std::string> files, DocumentModel model, size_t chunk_bytes = DEFAULT_CHUNK)
+        : files(std::move(files)), model(std::move(model)), chunk_bytes(std::max<size_t>(chunk_bytes, 4096)) {}
+
+    // Llama a sink(hilo, término, doc) por cada término del corpus, repartiendo
+    // los tramos en 'pool'. Las llamadas de un mismo hilo no se solapan; un
+    // documento partido en varios tramos puede llegar por varios hilos.
+    // Devuelve la cantidad de documentos.
+    template <typename Sink>
+    uint32_t tokenize(ThreadPool& pool, Sink&& sink) {
+        std::vector<CorpusChunk> chunks = split(pool);
+        std::vector<std::vector<char>> buffers(pool.size());
+        for (const CorpusChunk& chunk : chunks) {
+            pool.submit([this, &chunk, &buffers, &sink](size_t worker) {
+                char* data = read_chunk(chunk, buffers[worker]);
+                tokenize_chunk(chunk, data, [&sink, worker](std::string_view term, uint32_t doc) {
+                    sink(worker, term, doc);
+                });
+            });
+        }
+        pool.wait();
+        return doc_count;
+    }
+
+    // Llama a emit(término, doc) por cada término del tramo, ya leído en 'data'
+    // (que se modifica)
+    template <typename Emit>
+    void tokenize_chunk(const CorpusChunk& chunk, char* data, Emit&& emit) const {
+        size_t size = chunk.end - chunk.begin;
+        uint32_t doc = chunk.first_doc;
+        auto term = [&emit, &doc](std::string_view word) { emit(word, doc); };
+        if (model.kind == DocumentModel::Kind::File) {
+            tokenize_in_place(data, data + size, term);
+            return;
+        }
+        std::string_view text(data, size);
+        size_t start = 0;
+        for (size_t at = text.find(model.delimiter); at != std::string_view::npos;
+             at = text.find(model.delimiter, start)) {
+            tokenize_in_place(data + start, data + at, term);
+            start = at + model.delimiter.size();
+            ++doc;
+        }
+        tokenize_in_place(data + start, data + size, term);
+    }
+
+    // Pide al sistema que empiece a leer el tramo en segundo plano
+    void prefetch(const CorpusChunk& chunk) const {
+        File file(files[chunk.file]);
+        ::posix_fadvise(file.fd, static_cast<off_t>(chunk.begin), static_cast<off_t>(chunk.end - chunk.begin),
+                        POSIX_FADV_WILLNEED);
+    }
+
+    // Lee el tramo a 'buffer' (que crece si hace falta) y devuelve sus datos
+    char* read_chunk(const CorpusChunk& chunk, std::vector<char>& buffer) const {
+        size_t size = chunk.end - chunk.begin;
+        if (buffer.size() < size) buffer.resize(size);
+        File file(files[chunk.file]);
+        if (file.read(buffer.data(), size, chunk.begin) != size) {
+            throw std::runtime_error("El archivo cambió mientras se indexaba: " + files[chunk.file]);
+        }
+        return buffer.data();
+    }
+
+    // Tramos de todos los archivos, en orden, con su primer doc ID
+    std::vector<CorpusChunk> split(ThreadPool& pool) {
+        std::vector<CorpusChunk> chunks;
+        for (size_t f = 0; f < files.size(); ++f) {
+            File file(files[f]);
+            uint64_t begin = 0;
+            while (begin < file.size) {
+                uint64_t end = cut_after(file, begin, begin + chunk_bytes);
+                chunks.push_back({f, begin, end, static_cast<uint32_t>(f)});
+                begin = end;
+            }
+        }
+        doc_count = static_cast<uint32_t>(files.size());
+        if (model.kind == DocumentModel::Kind::File) return chunks;
+
+        // Delimitadores de cada tramo y si queda algo después del último
+        std::vector<uint32_t> counts(chunks.size());
+        std::vector<char> trailing(chunks.size());
+        std::vector<std::vector<char>> buffers(pool.size());
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            pool.submit([this, c, &chunks, &counts, &trailing, &buffers](size_t worker) {
+                char* data = read_chunk(chunks[c], buffers[worker]);
+                std::string_view text(data, chunks[c].end - chunks[c].begin);
+                uint32_t count = 0;
+                size_t start = 0;
+                for (size_t at = text.find(model.delimiter); at != std::string_view::npos;
+                     at = text.find(model.delimiter, start)) {
+                    ++count;
+                    start = at + model.delimiter.size();
+                }
+                counts[c] = count;
+                trailing[c] = start < text.size();
+            });
+        }
+        pool.wait();
+
+        // Documentos por archivo: uno por delimitador más el tramo final si no está vacío
+        uint32_t next = 0;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            chunks[c].first_doc = next;
+            next += counts[c];
+            bool last_of_file = c + 1 == chunks.size() || chunks[c + 1].file != chunks[c].file;
+            if (last_of_file && trailing[c]) ++next;
+        }
+        doc_count = next;
+        return chunks;
+    }
+
+    uint32_t document_count() const { return doc_count; }
+
+private:
+    std::vector<std::string> files;
+    DocumentModel model;
+    size_t chunk_bytes;
+    uint32_t doc_count = 0;
+
+    struct File {
+        int fd;
+        uint64_t size;
+
+        explicit File(const std::string& path) {
+            fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st) != 0) {
+                if (fd >= 0) ::close(fd);
+                throw std::runtime_error("No se pudo abrir el archivo: " + path);
+            }
+            size = static_cast<uint64_t>(st.st_size);
+        }
+        ~File() { ::close(fd); }
+
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        // Lee [offset, offset + n) completo (menos si el archivo termina antes)
+        size_t read(char* out, size_t n, uint64_t offset) const {
+            size_t done = 0;
+            while (done < n) {
+                ssize_t got = ::pread(fd, out + done, n - done, static_cast<off_t>(offset + done));
+                if (got < 0) throw std::runtime_error("Error al leer el archivo");
+                if (got == 0) break;
+                done += static_cast<size_t>(got);
+            }
+            return done;
+        }
+    };
+
+    static bool is_space(char c) {
+        return c == ' ' || static_cast<uint8_t>(c - '\t') <= '\r' - '\t';
+    }
+
+    // Fin del tramo que empieza en 'begin': el primer espacio desde 'target'
+    // (si no hay espacios en chunk_bytes se corta en 'target' igual). Con un
+    // delimitador de varios bytes el corte retrocede hasta que ninguna aparición
+    // lo cruce; así la búsqueda en cada tramo encuentra las mismas apariciones
+    // que en el archivo entero, aun con delimitadores que se solapan ("\n\n").
+    uint64_t cut_after(const File& file, uint64_t begin, uint64_t target) const {
+        if (target >= file.size) return file.size;
+        const size_t window = 64 << 10;
+        std::vector<char> buffer(window + model.delimiter.size());
+        uint64_t cut = target;
+        for (uint64_t at = target; at < target + chunk_bytes && at < file.size; at += window) {
+            size_t n = file.read(buffer.data(), window, at);
+            auto space = std::find_if(buffer.begin(), buffer.begin() + n, is_space);
+            if (space != buffer.begin() + n) {
+                cut = at + (space - buffer.begin());
+                break;
+            }
+        }
+        size_t d = model.delimiter.size();
+        if (model.kind != DocumentModel::Kind::Delimiter || d == 1) return cut;
+
+        for (;;) {
+            uint64_t from = cut - begin > window ? cut - window : begin;
+            size_t n = file.read(buffer.data(), static_cast<size_t>(cut - from) + d - 1, from);
+            std::string_view text(buffer.data(), n);
+            size_t pos = static_cast<size_t>(cut - from);
+            // Las apariciones que cruzan pos empiezan en [pos - d + 1, pos)
+            while (pos >= d - 1 || from == begin) {
+                size_t at = text.find(model.delimiter, pos >= d - 1 ? pos - (d - 1) : 0);
+                if (at >= pos) {
+                    // Si no queda ningún corte válido, el resto del archivo va en un tramo
+                    return from + pos > begin ? from + pos : file.size;
+                }
+                pos = at;
+            }
+            cut = from + pos;
+        }
+    }
+};
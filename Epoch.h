@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+// Liberación diferida por épocas, para estructuras que se leen sin locks. Un
+// lector fija la época actual en una casilla (pin) mientras usa punteros
+// publicados; el escritor, después de reemplazar un puntero, retira el objeto
+// viejo con la época del momento y avanza la época. El objeto se libera
+// cuando ninguna casilla quedó fijada en esa época o antes: quien fijó una
+// posterior ya solo puede ver el puntero nuevo.
+//
+// Fijar es un compare-exchange sobre una casilla que casi siempre es la misma
+// para cada hilo y está en su propia línea de caché, así que los lectores no
+// comparten nada que se escriba. retire y reclaim los llama un solo hilo a
+// la vez (el escritor). Si hay más de MAX_READERS lectores a la vez, los
+// demás esperan una casilla libre.
+class EpochDomain {
+public:
+    static constexpr size_t MAX_READERS = 128;
+
+    // Mantiene fijada la época mientras vive
+    class Guard {
+    public:
+        Guard() = default;
+        Guard(Guard&& other) noexcept : domain(other.domain), slot(other.slot) { other.domain = nullptr; }
+        Guard& operator=(Guard&& other) noexcept {
+            if (this != &other) {
+                release();
+                domain = other.domain;
+                slot = other.slot;
+                other.domain = nullptr;
+            }
+            return *this;
+        }
+        ~Guard() { release(); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        friend class EpochDomain;
+        const EpochDomain* domain = nullptr;
+        size_t slot = 0;
+
+        Guard(const EpochDomain* domain, size_t slot) : domain(domain), slot(slot) {}
+
+        void release() {
+            if (domain) domain->slots[slot].epoch.store(FREE, std::memory_order_release);
+            domain = nullptr;
+        }
+    };
+
+    EpochDomain() = default;
+
+    // Libera todo lo retirado: para entonces no puede quedar ningún lector
+    ~EpochDomain() {
+        for (auto& item : retired) item.deleter();
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    Guard pin() const {
+        size_t& hint = slot_hint();
+        for (size_t attempt = 0;; ++attempt) {
+            size_t slot = (hint + attempt) % MAX_READERS;
+            std::atomic<uint64_t>& cell = slots[slot].epoch;
+            uint64_t expected = FREE;
+            // Si la época avanza entre la lectura y el compare-exchange queda
+            // fijada una anterior, lo que solo demora liberaciones
+            uint64_t now = epoch.load(std::memory_order_seq_cst);
+            if (cell.load(std::memory_order_relaxed) == FREE &&
+                cell.compare_exchange_strong(expected, now, std::memory_order_seq_cst)) {
+                hint = slot;
+                return Guard(this, slot);
+            }
+            if ((attempt + 1) % MAX_READERS == 0) std::this_thread::yield();
+        }
+    }
+
+    // 'deleter' libera un objeto que ya no es alcanzable desde lo publicado
+    void retire(std::function<void()> deleter) {
+        uint64_t at = epoch.fetch_add(1, std::memory_order_seq_cst);
+        retired.push_back({at, std::move(deleter)});
+    }
+
+    // Libera lo retirado que ningún lector puede estar usando; devuelve cuántos
+    size_t reclaim() {
+        uint64_t oldest = UINT64_MAX;
+        for (const Slot& slot : slots) {
+            uint64_t pinned = slot.epoch.load(std::memory_order_seq_cst);
+            if (pinned != FREE && pinned < oldest) oldest = pinned;
+        }
+        size_t freed = 0;
+        std::vector<Retired> keep;
+        for (auto& item : retired) {
+            if (item.epoch < oldest) {
+                item.deleter();
+                ++freed;
+            } else {
+                keep.push_back(std::move(item));
+            }
+        }
+        retired.swap(keep);
+        return freed;
+    }
+
+    size_t pending() const { return retired.size(); }
+
+private:
+    static constexpr uint64_t FREE = 0;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{FREE};
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    mutable Slot slots[MAX_READERS];
+    std::atomic<uint64_t> epoch{1};
+    std::vector<Retired> retired;
+
+    // Casilla que usó por última vez este hilo (en cualquier dominio)
+    static size_t& slot_hint() {
+        thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_READERS;
+        return hint;
+    }
+};
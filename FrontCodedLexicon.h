@@ -1,158 +1,500 @@
 #pragma once
+#include "PostingCodecs.h"
+#include "MappedFile.h"
+
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
 #include <algorithm>
 #include <cstdint>
+#include <stdexcept>
 #include <unordered_map>
+#include <memory>
+#include <cstring>
 
 
-// Clase para manejar la compresión Front Coding del léxico
+// Léxico ordenado con Front Coding por bloques.
+// Los términos se guardan en orden alfabético en bloques de 'block_size'. Cada
+// entrada es [varint prefijo común con la anterior][varint largo del sufijo]
+// [sufijo][varint ID]; la primera de cada bloque tiene prefijo 0, así que su
+// término se lee directo y es la cabeza del bloque. La búsqueda binaria se hace
+// sobre un arreglo con los primeros 8 bytes de cada cabeza (contiguo, cabe en
+// caché) y solo compara cabezas completas cuando esos bytes empatan.
+// Buscar cuesta O(log bloques + block_size) y no hay otra copia de los términos.
+//
+// Los IDs son densos (0..size()-1) y estables: se asignan en orden de alta.
+// Los términos nuevos esperan en una cola pequeña que se fusiona con los bloques
+// cuando crece en proporción al léxico, así que el costo amortizado es constante.
+//
+// En disco cada arreglo es una sección alineada; al cargar se mapea el archivo
+// y se consulta en su lugar, sin copiar ni reconstruir nada.
 class FrontCodeLexicon {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
 private:
-    std::string concatenated_terms;
-    std::unordered_map<std::string, size_t> term_to_offset;
+    static constexpr uint32_t LEXICON_MAGIC = 0x58454C47; // "GLEX"
+    static constexpr uint32_t LEXICON_VERSION = 2;
+    static constexpr size_t MIN_PENDING = 1024;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t block_size;
+        uint32_t count;
+        uint32_t reserved;
+        FileSection terms;
+        FileSection block_offsets;
+        FileSection head_keys;
+        FileSection id_to_rank;
+    };
+
+    MappedArray<char, std::string> concatenated_terms;
+    MappedArray<size_t> block_offsets;
+    MappedArray<uint64_t> head_keys; // primeros 8 bytes de cada cabeza, big-endian
+    MappedArray<uint32_t> id_to_rank; // lugar en orden alfabético de cada término en bloques
     size_t block_size;
-    
-    std::string compress_term(const std::string& term, const std::string& last_term) {
-        if (last_term.empty()) return term;
-        
-        size_t common_prefix = 0;
-        while (common_prefix < term.size() && 
-               common_prefix < last_term.size() && 
-               term[common_prefix] == last_term[common_prefix]) {
-            common_prefix++;
+    std::shared_ptr<const MappedFile> mapping;
+
+    // Términos todavía fuera de los bloques; sus IDs son los últimos
+    std::unordered_map<std::string, uint32_t> pending;
+    std::vector<std::string> pending_terms;
+
+    uint32_t frozen_count() const { return static_cast<uint32_t>(id_to_rank.size()); }
+
+    struct Entry {
+        size_t shared;
+        const char* suffix;
+        size_t suffix_size;
+        uint32_t id;
+    };
+
+    static Entry read_entry(const char*& p, const char* end) {
+        uint64_t shared, suffix, value;
+        if (!read_varint(p, end, shared) || !read_varint(p, end, suffix) ||
+            suffix > static_cast<uint64_t>(end - p)) {
+            throw std::runtime_error("Léxico corrupto");
+        }
+        Entry entry{static_cast<size_t>(shared), p, static_cast<size_t>(suffix), 0};
+        p += suffix;
+        if (!read_varint(p, end, value)) {
+            throw std::runtime_error("Léxico corrupto");
         }
-        
-        return std::to_string(common_prefix) + term.substr(common_prefix);
+        entry.id = static_cast<uint32_t>(value);
+        return entry;
     }
 
-public:
-    FrontCodeLexicon(size_t block_size = 100) : block_size(block_size) {}
-    
-    void add_terms(const std::vector<std::string>& terms) {
-        if (terms.empty()) return;
-        
-        std::string block_data;
-        std::string last_term_in_block;
-        
-        for (const auto& term : terms) {
-            if (term_to_offset.find(term) != term_to_offset.end()) {
-                continue; // Término ya existe
+    // Lee la entrada en 'p'; 'term' trae el término anterior del bloque
+    static void read_entry(const char*& p, const char* end, std::string& term, uint32_t& id) {
+        Entry entry = read_entry(p, end);
+        if (entry.shared > term.size()) {
+            throw std::runtime_error("Léxico corrupto");
+        }
+        term.resize(entry.shared);
+        term.append(entry.suffix, entry.suffix_size);
+        id = entry.id;
+    }
+
+    const char* block_end(size_t block) const {
+        size_t end = block + 1 < block_offsets.size() ? block_offsets[block + 1] : concatenated_terms.size();
+        return concatenated_terms.data() + end;
+    }
+
+    std::string_view block_head(size_t block) const {
+        const char* p = concatenated_terms.data() + block_offsets[block];
+        const char* end = block_end(block);
+        uint64_t shared, suffix;
+        if (!read_varint(p, end, shared) || !read_varint(p, end, suffix) ||
+            shared != 0 || suffix > static_cast<uint64_t>(end - p)) {
+            throw std::runtime_error("Léxico corrupto");
+        }
+        return std::string_view(p, suffix);
+    }
+
+    // El orden de las claves coincide con el de los términos (bytes sin signo,
+    // relleno con ceros), salvo empates entre términos que comparten 8 bytes
+    static uint64_t key_of(std::string_view term) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            key = (key << 8) | (i < term.size() ? static_cast<unsigned char>(term[i]) : 0);
+        }
+        return key;
+    }
+
+    void rebuild_head_keys() {
+        std::vector<uint64_t>& keys = head_keys.reset();
+        keys.resize(block_offsets.size());
+        for (size_t b = 0; b < block_offsets.size(); ++b) keys[b] = key_of(block_head(b));
+    }
+
+    uint32_t find_frozen(const std::string& term) const {
+        if (block_offsets.empty()) return NOT_FOUND;
+
+        // Último bloque cuya cabeza es <= term: las claves acotan el rango y
+        // solo las cabezas con la misma clave se comparan completas
+        uint64_t key = key_of(term);
+        size_t lo = std::lower_bound(head_keys.begin(), head_keys.end(), key) - head_keys.begin();
+        size_t hi = std::upper_bound(head_keys.begin() + lo, head_keys.end(), key) - head_keys.begin();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (block_head(mid) <= term) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == 0) return NOT_FOUND;
+        --lo;
+
+        // Recorrido sin reconstruir términos: 'matched' es el prefijo común entre
+        // la entrada anterior (menor que 'term') y 'term'. Si la siguiente comparte
+        // más que eso con la anterior, también es menor; si comparte menos, ya es mayor.
+        const char* p = concatenated_terms.data() + block_offsets[lo];
+        const char* end = block_end(lo);
+        size_t matched = 0;
+        while (p < end) {
+            Entry entry = read_entry(p, end);
+            if (entry.shared > matched) continue;
+            if (entry.shared < matched) break;
+
+            size_t i = 0;
+            while (i < entry.suffix_size && matched + i < term.size() &&
+                   entry.suffix[i] == term[matched + i]) {
+                ++i;
             }
-            
-            std::string compressed = compress_term(term, last_term_in_block);
-            term_to_offset[term] = concatenated_terms.size() + block_data.size();
-            block_data += compressed + '\0'; // Separador nulo
-            
-            last_term_in_block = term;
-            
-            if (term_to_offset.size() % block_size == 0) {
-                concatenated_terms += block_data;
-                block_data.clear();
-                last_term_in_block.clear();
+            if (i == entry.suffix_size) {
+                if (matched + i == term.size()) return entry.id;
+            } else if (matched + i == term.size() ||
+                       static_cast<unsigned char>(entry.suffix[i]) > static_cast<unsigned char>(term[matched + i])) {
+                break;
             }
+            matched += i;
         }
-        
-        if (!block_data.empty()) {
-            concatenated_terms += block_data;
+        return NOT_FOUND;
+    }
+
+    // Reescribe los bloques con 'entries' (término, ID), ya ordenados
+    void rebuild(const std::vector<std::pair<std::string, uint32_t>>& entries) {
+        std::string& terms = concatenated_terms.reset();
+        std::vector<size_t>& offsets = block_offsets.reset();
+        std::vector<uint32_t>& ranks = id_to_rank.reset();
+        ranks.assign(entries.size(), 0);
+        mapping.reset();
+
+        const std::string* previous = nullptr;
+        for (size_t rank = 0; rank < entries.size(); ++rank) {
+            const std::string& term = entries[rank].first;
+            size_t shared = 0;
+            if (rank % block_size == 0) {
+                offsets.push_back(terms.size());
+            } else {
+                size_t limit = std::min(term.size(), previous->size());
+                while (shared < limit && term[shared] == (*previous)[shared]) ++shared;
+            }
+            write_varint(terms, shared);
+            write_varint(terms, term.size() - shared);
+            terms.append(term, shared, std::string::npos);
+            write_varint(terms, entries[rank].second);
+
+            if (entries[rank].second >= entries.size()) {
+                throw std::runtime_error("IDs de términos no densos");
+            }
+            ranks[entries[rank].second] = static_cast<uint32_t>(rank);
+            previous = &term;
         }
+        terms.shrink_to_fit();
+        rebuild_head_keys();
+
+        pending.clear();
+        pending_terms.clear();
+    }
+
+    // Fusiona la cola con los bloques
+    void flush() {
+        if (pending_terms.empty()) return;
+        rebuild(merged_entries());
     }
-    
-    size_t get_term_offset(const std::string& term) const {
-        auto it = term_to_offset.find(term);
-        if (it != term_to_offset.end()) {
-            return it->second;
+
+    // Todos los términos, ordenados, con los de la cola ya en su lugar
+    std::vector<std::pair<std::string, uint32_t>> merged_entries() const {
+        std::vector<std::pair<std::string, uint32_t>> added;
+        added.reserve(pending_terms.size());
+        for (size_t i = 0; i < pending_terms.size(); ++i) {
+            added.emplace_back(pending_terms[i], frozen_count() + static_cast<uint32_t>(i));
         }
-        return static_cast<size_t>(-1);
+        std::sort(added.begin(), added.end());
+
+        std::vector<std::pair<std::string, uint32_t>> entries;
+        entries.reserve(size());
+        auto next_added = added.begin();
+        for_each_frozen([&](const std::string& term, uint32_t id) {
+            while (next_added != added.end() && next_added->first < term) entries.push_back(std::move(*next_added++));
+            entries.emplace_back(term, id);
+        });
+        while (next_added != added.end()) entries.push_back(std::move(*next_added++));
+        return entries;
     }
-    
-    std::string get_term_at_offset(size_t offset) const {
-        if (offset >= concatenated_terms.size()) return "";
-        
-        size_t block_start = (offset / block_size) * block_size;
-        if (block_start >= concatenated_terms.size()) block_start = 0;
-        
-        std::string term;
-        size_t current_offset = block_start;
-        
-        while (current_offset <= offset) {
-            if (current_offset >= concatenated_terms.size()) break;
-            
-            size_t term_end = concatenated_terms.find('\0', current_offset);
-            if (term_end == std::string::npos) break;
-            
-            std::string compressed = concatenated_terms.substr(current_offset, term_end - current_offset);
-            
-            if (current_offset == block_start) {
-                term = compressed;
-            } else {
-                size_t prefix_len = 0;
-                size_t i = 0;
-                while (i < compressed.size() && isdigit(compressed[i])) {
-                    prefix_len = prefix_len * 10 + (compressed[i] - '0');
-                    i++;
-                }
-                
-                if (prefix_len > term.size()) {
-                    return "";
-                }
-                
-                term = term.substr(0, prefix_len) + compressed.substr(i);
+
+    template <typename Callback>
+    void for_each_frozen(Callback&& callback) const {
+        for (size_t b = 0; b < block_offsets.size(); ++b) {
+            const char* p = concatenated_terms.data() + block_offsets[b];
+            const char* end = block_end(b);
+            std::string term;
+            while (p < end) {
+                uint32_t id;
+                read_entry(p, end, term, id);
+                callback(term, id);
             }
-            
-            current_offset = term_end + 1;
         }
-        
-        return term;
     }
-    
-    void save_to_file(const std::string& filename) const {
-        std::ofstream out(filename, std::ios::binary);
-        out.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
-        
-        size_t concat_size = concatenated_terms.size();
-        out.write(reinterpret_cast<const char*>(&concat_size), sizeof(concat_size));
-        out.write(concatenated_terms.data(), concat_size);
-        
-        size_t map_size = term_to_offset.size();
-        out.write(reinterpret_cast<const char*>(&map_size), sizeof(map_size));
-        
-        for (const auto& entry : term_to_offset) {
-            size_t term_size = entry.first.size();
-            out.write(reinterpret_cast<const char*>(&term_size), sizeof(term_size));
-            out.write(entry.first.data(), term_size);
-            
-            out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
-        }
-    }
-    
-    void load_from_file(const std::string& filename) {
-        std::ifstream in(filename, std::ios::binary);
-        if (!in) return;
-        
-        in.read(reinterpret_cast<char*>(&block_size), sizeof(block_size));
-        
-        size_t concat_size;
+
+    // Formato anterior: [block_size][blob][n][(largo, término, offset) x n].
+    // Los IDs siguen el orden de los offsets antiguos.
+    void load_legacy(std::ifstream& in, std::unordered_map<size_t, uint32_t>* legacy_ids) {
+        size_t old_block_size, concat_size;
+        in.read(reinterpret_cast<char*>(&old_block_size), sizeof(old_block_size));
         in.read(reinterpret_cast<char*>(&concat_size), sizeof(concat_size));
-        concatenated_terms.resize(concat_size);
-        in.read(&concatenated_terms[0], concat_size);
-        
-        size_t map_size;
+        in.seekg(static_cast<std::streamoff>(concat_size), std::ios::cur);
+
+        size_t map_size = 0;
         in.read(reinterpret_cast<char*>(&map_size), sizeof(map_size));
-        
-        term_to_offset.clear();
-        for (size_t i = 0; i < map_size; ++i) {
+
+        std::vector<std::pair<size_t, std::string>> by_offset;
+        for (size_t i = 0; i < map_size && in; ++i) {
             size_t term_size;
             in.read(reinterpret_cast<char*>(&term_size), sizeof(term_size));
-            
             std::string term(term_size, '\0');
             in.read(&term[0], term_size);
-            
             size_t offset;
             in.read(reinterpret_cast<char*>(&offset), sizeof(offset));
-            
-            term_to_offset[term] = offset;
+            by_offset.emplace_back(offset, std::move(term));
+        }
+        if (!in) {
+            throw std::runtime_error("Léxico antiguo truncado");
         }
+        std::sort(by_offset.begin(), by_offset.end());
+
+        std::vector<std::pair<std::string, uint32_t>> entries;
+        entries.reserve(by_offset.size());
+        for (size_t i = 0; i < by_offset.size(); ++i) {
+            if (legacy_ids) (*legacy_ids)[by_offset[i].first] = static_cast<uint32_t>(i);
+            entries.emplace_back(std::move(by_offset[i].second), static_cast<uint32_t>(i));
+        }
+        std::sort(entries.begin(), entries.end());
+        rebuild(entries);
+    }
+
+public:
+    FrontCodeLexicon(size_t block_size = 16) : block_size(std::max<size_t>(block_size, 1)) {}
+
+    uint32_t size() const { return frozen_count() + static_cast<uint32_t>(pending_terms.size()); }
+
+    // ID del término, dándolo de alta si no existe
+    uint32_t add_term(const std::string& term) {
+        uint32_t id = get_term_id(term);
+        if (id != NOT_FOUND) return id;
+
+        id = size();
+        pending.emplace(term, id);
+        pending_terms.push_back(term);
+        if (pending_terms.size() >= std::max<size_t>(MIN_PENDING, frozen_count() / 8)) flush();
+        return id;
+    }
+
+    void add_terms(const std::vector<std::string>& terms) {
+        for (const auto& term : terms) add_term(term);
+    }
+
+    // Pasa la cola a los bloques; Cursor solo recorre los bloques
+    void freeze() { flush(); }
+
+    // Alta de un término mayor que todos los del léxico, como al cargar en
+    // orden alfabético: va directo al final del último bloque, sin pasar por la
+    // cola ni reconstruir los bloques. Su ID es también su lugar en el orden.
+    uint32_t append_sorted(const std::string& term) {
+        flush();
+        uint32_t id = frozen_count();
+        std::string previous;
+        if (id > 0) {
+            const char* p = concatenated_terms.data() + block_offsets[block_offsets.size() - 1];
+            const char* end = concatenated_terms.data() + concatenated_terms.size();
+            uint32_t previous_id;
+            while (p < end) read_entry(p, end, previous, previous_id);
+            if (term <= previous) {
+                throw std::runtime_error("Término fuera de orden: " + term);
+            }
+        }
+
+        std::string& terms = concatenated_terms.mutate();
+        size_t shared = 0;
+        if (id % block_size == 0) {
+            block_offsets.mutate().push_back(terms.size());
+            head_keys.mutate().push_back(key_of(term));
+        } else {
+            size_t limit = std::min(term.size(), previous.size());
+            while (shared < limit && term[shared] == previous[shared]) ++shared;
+        }
+        write_varint(terms, shared);
+        write_varint(terms, term.size() - shared);
+        terms.append(term, shared, std::string::npos);
+        write_varint(terms, id);
+        id_to_rank.mutate().push_back(id);
+        return id;
+    }
+
+    uint32_t get_term_id(const std::string& term) const {
+        auto it = pending.find(term);
+        if (it != pending.end()) return it->second;
+        return find_frozen(term);
+    }
+
+    // Término con ese ID; vacío si no existe
+    std::string term_at(uint32_t id) const {
+        if (id >= frozen_count()) {
+            size_t index = id - size_t(frozen_count());
+            return index < pending_terms.size() ? pending_terms[index] : std::string();
+        }
+
+        uint32_t rank = id_to_rank[id];
+        size_t block = rank / block_size;
+        const char* p = concatenated_terms.data() + block_offsets[block];
+        const char* end = block_end(block);
+        std::string term;
+        for (size_t i = 0; i <= rank % block_size; ++i) {
+            uint32_t entry_id;
+            read_entry(p, end, term, entry_id);
+        }
+        return term;
+    }
+
+    // Recorre de a uno, en orden alfabético, los términos en bloques (no los de
+    // la cola, que en un léxico cargado de archivo o después de freeze() está
+    // vacía). Sirve para fusionar varios léxicos en streaming.
+    class Cursor {
+    public:
+        explicit Cursor(const FrontCodeLexicon& lexicon) : lexicon(&lexicon) { next(); }
+
+        bool at_end() const { return done; }
+        const std::string& term() const { return current; }
+        uint32_t id() const { return current_id; }
+
+        void next() {
+            while (p == end) {
+                if (block == lexicon->block_offsets.size()) {
+                    done = true;
+                    return;
+                }
+                p = lexicon->concatenated_terms.data() + lexicon->block_offsets[block];
+                end = lexicon->block_end(block);
+                current.clear();
+                ++block;
+            }
+            read_entry(p, end, current, current_id);
+        }
+
+    private:
+        const FrontCodeLexicon* lexicon;
+        size_t block = 0;
+        const char* p = nullptr;
+        const char* end = nullptr;
+        std::string current;
+        uint32_t current_id = NOT_FOUND;
+        bool done = false;
+    };
+
+    // Recorre todos los términos con su ID: primero los de los bloques, en orden
+    // alfabético, y después los de la cola, en orden de alta
+    template <typename Callback>
+    void for_each_term(Callback&& callback) const {
+        for_each_frozen(callback);
+        for (size_t i = 0; i < pending_terms.size(); ++i) {
+            callback(pending_terms[i], frozen_count() + static_cast<uint32_t>(i));
+        }
+    }
+
+    // Bytes en memoria de los bloques y los índices (sin la cola)
+    size_t memory_bytes() const {
+        return concatenated_terms.size() + block_offsets.size() * (sizeof(size_t) + sizeof(uint64_t)) +
+               id_to_rank.size() * sizeof(uint32_t);
+    }
+
+    void save_to_file(const std::string& filename) const {
+        replace_file(filename, [this](std::ofstream& out) { write_to(out); });
+    }
+
+    // Cabecera con la tabla de secciones y después cada arreglo alineado:
+    // términos, offsets de bloque, claves de cabeza e ID -> lugar. 'out' tiene
+    // que estar al principio de un archivo nuevo.
+    void write_to(std::ofstream& out) const {
+        if (!pending_terms.empty()) {
+            FrontCodeLexicon merged(block_size);
+            merged.rebuild(merged_entries());
+            merged.write_to(out);
+            return;
+        }
+
+        Header header{};
+        header.magic = LEXICON_MAGIC;
+        header.version = LEXICON_VERSION;
+        header.block_size = block_size;
+        header.count = frozen_count();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        header.terms = write_section(out, concatenated_terms.data(), concatenated_terms.size());
+        header.block_offsets = write_section(out, block_offsets.data(), block_offsets.size() * sizeof(size_t));
+        header.head_keys = write_section(out, head_keys.data(), head_keys.size() * sizeof(uint64_t));
+        header.id_to_rank = write_section(out, id_to_rank.data(), id_to_rank.size() * sizeof(uint32_t));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    // Si el archivo tiene el formato antiguo y 'legacy_ids' no es nulo, se
+    // llena con offset antiguo -> ID para traducir las listas guardadas.
+    // Se carga en un léxico aparte que reemplaza a este solo si todo salió bien.
+    void load_from_file(const std::string& filename,
+                        std::unordered_map<size_t, uint32_t>* legacy_ids = nullptr) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) return;
+
+        FrontCodeLexicon loaded(block_size);
+        uint32_t magic = 0, version = 0;
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (magic != LEXICON_MAGIC) {
+            in.clear();
+            in.seekg(0);
+            loaded.load_legacy(in, legacy_ids);
+        } else if (version == LEXICON_VERSION) {
+            in.close();
+            loaded.map_file(filename);
+        } else {
+            throw std::runtime_error("Versión de léxico no soportada: " + std::to_string(version));
+        }
+        *this = std::move(loaded);
+    }
+
+private:
+    void map_file(const std::string& filename) {
+        auto file = std::make_shared<const MappedFile>(filename);
+        Header header;
+        if (file->size() < sizeof(header)) {
+            throw std::runtime_error("Léxico truncado: " + filename);
+        }
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (header.block_size == 0 || header.id_to_rank.bytes != uint64_t(header.count) * sizeof(uint32_t) ||
+            header.head_keys.bytes / sizeof(uint64_t) != header.block_offsets.bytes / sizeof(size_t)) {
+            throw std::runtime_error("Léxico corrupto: " + filename);
+        }
+
+        block_size = header.block_size;
+        concatenated_terms.map(file->section<char>(header.terms), header.terms.bytes);
+        block_offsets.map(file->section<size_t>(header.block_offsets), header.block_offsets.bytes / sizeof(size_t));
+        head_keys.map(file->section<uint64_t>(header.head_keys), header.head_keys.bytes / sizeof(uint64_t));
+        id_to_rank.map(file->section<uint32_t>(header.id_to_rank), header.count);
+
+        // La búsqueda binaria toca las claves al azar: conviene tenerlas ya;
+        // de los términos se leen solo los bloques encontrados
+        file->advise(header.head_keys, MappedFile::Access::WillNeed);
+        file->advise(header.block_offsets, MappedFile::Access::WillNeed);
+        file->advise(header.terms, MappedFile::Access::Random);
+        mapping = std::move(file);
     }
-};
\ No newline at end of file
+};
@@ -1,79 +1,222 @@
 #pragma once
 #include <vector>
-#include <cmath>
-#include <bitset>
-#include <sstream>
+#include <string>
+#include <cstring>
 #include <cstdint>
 
+// Escritor de bits MSB-first que acumula en palabras de 64 bits.
+class BitWriter {
+private:
+    std::vector<uint64_t> words;
+    uint64_t current = 0;
+    unsigned used = 0; // bits ocupados en 'current'
+
+public:
+    // Escribe los 'nbits' menos significativos de 'value' (nbits <= 64)
+    void write(uint64_t value, unsigned nbits) {
+        if (nbits == 0) return;
+        if (nbits < 64) value &= (uint64_t(1) << nbits) - 1;
+
+        unsigned free_bits = 64 - used;
+        if (nbits < free_bits) {
+            current |= value << (free_bits - nbits);
+            used += nbits;
+            return;
+        }
+
+        unsigned rest = nbits - free_bits;
+        current |= (rest == 0) ? value : (value >> rest);
+        words.push_back(current);
+        current = (rest == 0) ? 0 : (value << (64 - rest));
+        used = rest;
+    }
+
+    void write_zeros(unsigned nbits) {
+        while (nbits >= 64) {
+            write(0, 63);
+            nbits -= 63;
+        }
+        write(0, nbits);
+    }
+
+    size_t bit_size() const { return words.size() * 64 + used; }
+
+    // Vuelca los bits como bytes big-endian, rellenando con ceros hasta el byte
+    void append_to(std::string& out) const {
+        size_t nbytes = (bit_size() + 7) / 8;
+        size_t base = out.size();
+        out.resize(base + nbytes);
+        char* dst = &out[base];
+
+        size_t written = 0;
+        for (uint64_t w : words) {
+            uint64_t be = __builtin_bswap64(w);
+            std::memcpy(dst + written, &be, 8);
+            written += 8;
+        }
+        uint64_t be = __builtin_bswap64(current);
+        std::memcpy(dst + written, &be, nbytes - written);
+    }
+
+    std::string to_bytes() const {
+        std::string out;
+        append_to(out);
+        return out;
+    }
+};
+
+// Lector de bits MSB-first sobre un buffer de bytes; lee ventanas de 64 bits
+class BitReader {
+private:
+    const unsigned char* data;
+    size_t size_bytes;
+    size_t size_bits;
+    size_t pos = 0;
+
+public:
+    BitReader(const char* data, size_t size_bytes)
+        : data(reinterpret_cast<const unsigned char*>(data)),
+          size_bytes(size_bytes), size_bits(size_bytes * 8) {}
+
+    size_t position() const { return pos; }
+    size_t remaining() const { return size_bits - pos; }
+    void skip(size_t nbits) { pos += nbits; }
+
+    // Devuelve los próximos 64 bits alineados a la izquierda (ceros tras el final)
+    uint64_t peek64() const {
+        size_t byte = pos >> 3;
+        unsigned shift = pos & 7;
+        uint64_t window;
+        unsigned char extra = 0;
+
+        if (byte + 9 <= size_bytes) {
+            std::memcpy(&window, data + byte, 8);
+            window = __builtin_bswap64(window);
+            extra = data[byte + 8];
+        } else {
+            window = 0;
+            for (size_t i = 0; i < 8 && byte + i < size_bytes; ++i) {
+                window |= uint64_t(data[byte + i]) << (56 - 8 * i);
+            }
+            if (byte + 8 < size_bytes) extra = data[byte + 8];
+        }
+
+        if (shift == 0) return window;
+        return (window << shift) | (uint64_t(extra) >> (8 - shift));
+    }
+
+    // Lee 'nbits' (<= 64) como entero sin signo
+    uint64_t read(unsigned nbits) {
+        if (nbits == 0) return 0;
+        uint64_t value = peek64() >> (64 - nbits);
+        pos += nbits;
+        return value;
+    }
+};
+
+// Códigos gamma de Elias empaquetados en bits.
+// Se codifican los huecos entre doc IDs estrictamente crecientes:
+//   g0 = d0, gi = di - d(i-1) - 1, y se escribe gamma(g + 1).
 class GammaEncoder {
 public:
-    static std::string encode(const std::vector<uint32_t>& numbers) {
-        if (numbers.empty()) return "";
-        
-        std::string result;
+    static void encode_value(BitWriter& writer, uint64_t value) {
+        // value >= 1: N ceros seguidos de value en N+1 bits
+        unsigned n = 63 - __builtin_clzll(value);
+        if (2 * n + 1 <= 64) {
+            writer.write(value, 2 * n + 1);
+        } else {
+            writer.write_zeros(n);
+            writer.write(value, n + 1);
+        }
+    }
+
+    // Devuelve false al llegar al final del flujo (o ante datos corruptos)
+    static bool decode_value(BitReader& reader, uint64_t& value) {
+        uint64_t window = reader.peek64();
+        if (window == 0) return false;
+
+        unsigned n = __builtin_clzll(window);
+        size_t len = 2 * size_t(n) + 1;
+        if (len > reader.remaining()) return false;
+
+        if (len <= 64) {
+            value = window >> (64 - len);
+            reader.skip(len);
+        } else {
+            reader.skip(n);
+            value = reader.read(n + 1);
+        }
+        return true;
+    }
+
+    static void encode(const std::vector<uint32_t>& numbers, BitWriter& writer) {
+        bool first = true;
         uint32_t prev = 0;
-        
+
         for (uint32_t num : numbers) {
-            uint32_t diff = num - prev;
+            if (!first && num <= prev) continue; // No debería ocurrir con doc IDs únicos
+            uint64_t gap = first ? num : uint64_t(num) - prev - 1;
+            encode_value(writer, gap + 1); // gamma no puede codificar 0
             prev = num;
-            
-            if (diff == 0) continue; // No debería ocurrir con doc IDs únicos
-            
-            // Codificar gamma de la diferencia
-            diff++; // Porque gamma no puede codificar 0
-            
-            std::string binary = std::bitset<32>(diff).to_string();
-            size_t first_one = binary.find('1');
-            if (first_one == std::string::npos) {
-                continue; // No debería ocurrir
-            }
-            
-            binary = binary.substr(first_one);
-            std::string unary = std::string(binary.length() - 1, '0') + '1';
-            std::string offset = binary.substr(1);
-            
-            result += unary + offset;
+            first = false;
+        }
+    }
+
+    static std::string encode(const std::vector<uint32_t>& numbers) {
+        if (numbers.empty()) return "";
+        BitWriter writer;
+        encode(numbers, writer);
+        return writer.to_bytes();
+    }
+
+    // Decodifica hasta agotar el buffer o hasta 'max_count' valores
+    static void decode(const char* data, size_t size, std::vector<uint32_t>& result,
+                       size_t max_count = static_cast<size_t>(-1)) {
+        BitReader reader(data, size);
+        bool first = true;
+        uint64_t prev = 0;
+        uint64_t value;
+
+        while (max_count > 0 && decode_value(reader, value)) {
+            prev = first ? value - 1 : prev + value;
+            first = false;
+            result.push_back(static_cast<uint32_t>(prev));
+            --max_count;
         }
-        
-        return result;
     }
-    
+
     static std::vector<uint32_t> decode(const std::string& str) {
         std::vector<uint32_t> result;
-        if (str.empty()) return result;
-        
+        decode(str.data(), str.size(), result);
+        return result;
+    }
+
+    // Decodifica el formato antiguo: un char '0'/'1' por bit y gamma(d - prev + 1)
+    static std::vector<uint32_t> decode_legacy(const char* str, size_t length) {
+        std::vector<uint32_t> result;
         size_t pos = 0;
         uint32_t prev = 0;
-        
-        while (pos < str.length()) {
-            // Leer parte unaria (longitud)
+
+        while (pos < length) {
             size_t len = 0;
-            while (pos < str.length() && str[pos] == '0') {
+            while (pos < length && str[pos] == '0') {
                 len++;
                 pos++;
             }
-            
-            if (pos >= str.length() || str[pos] != '1') {
-                break; // Error
-            }
-            
+            if (pos >= length || str[pos] != '1' || len > 32) break;
             pos++; // Saltar el '1'
-            
-            // Leer parte offset (bits restantes)
-            if (pos + len > str.length()) {
-                break; // Error
+            if (pos + len > length) break;
+
+            uint64_t diff = 1;
+            for (size_t i = 0; i < len; ++i) {
+                diff = (diff << 1) | (str[pos + i] == '1' ? 1 : 0);
             }
-            
-            std::string offset = "1" + str.substr(pos, len);
             pos += len;
-            
-            uint32_t diff = std::bitset<32>(offset).to_ulong();
-            diff--; // Deshacer el +1 de la codificación
-            
-            prev += diff;
+
+            prev += static_cast<uint32_t>(diff - 1);
             result.push_back(prev);
         }
-        
+
         return result;
     }
-};
\ No newline at end of file
+};
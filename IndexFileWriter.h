@@ -0,0 +1,295 @@
+#pragma once
+#include "InvertedIndex.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+
+// Escribe un índice en el formato de InvertedIndex::save_to_files sin armarlo
+// en memoria. Los términos llegan en orden alfabético y los postings de cada
+// uno en orden de doc; cada lista se codifica por bloques y va al archivo al
+// cerrar su término. En memoria quedan el léxico, las tablas de offsets, las
+// longitudes de los documentos y la lista comprimida en curso.
+//
+// Con 'positional' cada posting trae sus posiciones. Se codifican por bloques
+// junto con los de la lista y van a un temporal aparte, que finish() copia a
+// su sección.
+//
+// Los archivos se escriben como temporales y reemplazan a los finales en
+// finish(); si el writer se destruye antes, se borran.
+class IndexFileWriter {
+public:
+    // 'doc_lengths' indexado por doc ID (0 = desconocida), para las cotas de BM25
+    IndexFileWriter(const std::string& lexicon_file, const std::string& docids_file, CodecType codec,
+                    std::vector<uint32_t> doc_lengths, bool positional = false)
+        : lexicon_file(lexicon_file), docids_file(docids_file), codec(codec), positional(positional),
+          doc_lengths(std::move(doc_lengths)) {
+        out.rdbuf()->pubsetbuf(write_buffer.data(), static_cast<std::streamsize>(write_buffer.size()));
+        out.open(temp_path(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("No se pudo escribir el archivo: " + docids_file);
+        }
+        if (positional) {
+            positions_out.open(positions_path(), std::ios::binary | std::ios::trunc);
+            if (!positions_out) {
+                throw std::runtime_error("No se pudo escribir el archivo: " + positions_path());
+            }
+        }
+        InvertedIndex::DocidsHeader header{};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        header.doclists = write_section(out, nullptr, 0);
+        doclists_start = header.doclists.offset;
+    }
+
+    ~IndexFileWriter() {
+        if (!finished) {
+            out.close();
+            std::remove(temp_path().c_str());
+        }
+        if (positional) {
+            positions_out.close();
+            std::remove(positions_path().c_str());
+        }
+    }
+
+    IndexFileWriter(const IndexFileWriter&) = delete;
+    IndexFileWriter& operator=(const IndexFileWriter&) = delete;
+
+    // Empieza la lista de 'term', que debe ser mayor que todos los anteriores
+    void begin_term(const std::string& term) {
+        if (in_term) end_term();
+        lexicon.append_sorted(term);
+        last_term = term;
+        in_term = true;
+    }
+
+    // En un writer posicional 'positions' trae las tf posiciones crecientes del doc
+    void add_posting(uint32_t doc, uint32_t tf, const uint32_t* positions = nullptr) {
+        if (pending > 0 && doc <= docs[pending - 1]) {
+            throw std::runtime_error("Doc IDs fuera de orden en la lista de " + last_term);
+        }
+        if (pending == 0 && count > 0 && doc <= last_doc) {
+            throw std::runtime_error("Doc IDs fuera de orden en la lista de " + last_term);
+        }
+        if (positional) {
+            if (!positions) throw std::runtime_error("Faltan las posiciones en la lista de " + last_term);
+            block_positions.insert(block_positions.end(), positions, positions + std::max<uint32_t>(tf, 1));
+        }
+        docs[pending] = doc;
+        tfs[pending] = tf;
+        if (++pending == POSTING_BLOCK) flush_block();
+    }
+
+    // Cierra la lista del término actual y la agrega al archivo
+    void end_term() {
+        if (!in_term) return;
+        if (pending > 0) flush_block();
+        in_term = false;
+        if (count == 0) {
+            offsets.push_back(InvertedIndex::NO_LIST);
+            if (positional) positions_offsets.push_back(InvertedIndex::NO_LIST);
+            return;
+        }
+        // Una lista de un solo bloque no lleva tabla de saltos y sus doc IDs son absolutos
+        if (nblocks == 1) {
+            blocks.clear();
+            PostingListView::encode_block(codec, first_docs, first_tfs, first_lengths, count, false, blocks);
+            skips.clear();
+        }
+        list.clear();
+        PostingListView::assemble(count, max_tf, min_ratio, skips, blocks, list);
+        offsets.push_back(static_cast<size_t>(doclists_bytes));
+        out.write(list.data(), static_cast<std::streamsize>(list.size()));
+        doclists_bytes += list.size();
+        postings += count;
+        if (positional) end_positions();
+
+        skips.clear();
+        blocks.clear();
+        count = 0;
+        nblocks = 0;
+        max_tf = 0;
+        min_ratio = UINT32_MAX;
+    }
+
+    // Agrega 'term' con su lista ya codificada por PostingListView::encode (con
+    // este mismo códec y las longitudes de documento del writer), para que las
+    // listas se puedan codificar en paralelo y escribirse acá en orden. Solo
+    // en un writer no posicional.
+    void add_list(const std::string& term, const char* list, size_t size, size_t count) {
+        if (positional) throw std::runtime_error("add_list no lleva posiciones: " + term);
+        if (in_term) end_term();
+        lexicon.append_sorted(term);
+        last_term = term;
+        if (count == 0) {
+            offsets.push_back(InvertedIndex::NO_LIST);
+            return;
+        }
+        offsets.push_back(static_cast<size_t>(doclists_bytes));
+        out.write(list, static_cast<std::streamsize>(size));
+        doclists_bytes += size;
+        postings += count;
+    }
+
+    // Escribe las tablas, la cabecera y el léxico, y deja los archivos en su lugar
+    void finish() {
+        end_term();
+        InvertedIndex::DocidsHeader header{};
+        header.magic = InvertedIndex::DOCIDS_MAGIC;
+        header.version = InvertedIndex::DOCIDS_VERSION;
+        header.codec = static_cast<uint32_t>(codec);
+        header.flags = positional ? 1 : 0;
+        for (uint32_t length : doc_lengths) {
+            header.total_doc_length += length;
+            if (length > 0) ++header.num_docs;
+        }
+        header.doclists = {doclists_start, doclists_bytes};
+        header.doclist_offsets = write_section(out, offsets.data(), offsets.size() * sizeof(size_t));
+        header.doc_lengths = write_section(out, doc_lengths.data(), doc_lengths.size() * sizeof(uint32_t));
+        if (positional) {
+            positions_out.close();
+            if (!positions_out) throw std::runtime_error("No se pudo escribir el archivo: " + positions_path());
+            {
+                MappedFile positions(positions_path());
+                positions.advise({0, positions.size()}, MappedFile::Access::Sequential);
+                header.positions = write_section(out, positions.data(), positions.size());
+            }
+            std::remove(positions_path().c_str());
+            header.positions_offsets = write_section(out, positions_offsets.data(),
+                                                     positions_offsets.size() * sizeof(size_t));
+        }
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out) {
+            std::remove(temp_path().c_str());
+            throw std::runtime_error("No se pudo escribir el archivo: " + docids_file);
+        }
+
+        // Los dos temporales completos antes de reemplazar ninguno de los finales
+        std::string lexicon_temp = lexicon_file + ".tmp";
+        bool written;
+        {
+            std::ofstream lexicon_out(lexicon_temp, std::ios::binary | std::ios::trunc);
+            lexicon.write_to(lexicon_out);
+            lexicon_out.flush();
+            written = static_cast<bool>(lexicon_out);
+        }
+        if (!written || std::rename(temp_path().c_str(), docids_file.c_str()) != 0 ||
+            std::rename(lexicon_temp.c_str(), lexicon_file.c_str()) != 0) {
+            std::remove(temp_path().c_str());
+            std::remove(lexicon_temp.c_str());
+            throw std::runtime_error("No se pudo escribir el archivo: " + (written ? docids_file : lexicon_file));
+        }
+        finished = true;
+    }
+
+    size_t term_count() const { return offsets.size(); }
+    uint64_t posting_count() const { return postings; }
+    uint64_t doclist_bytes() const { return doclists_bytes; }
+
+    IndexStatistics statistics() const {
+        IndexStatistics out;
+        out.terms = term_count();
+        out.postings = postings;
+        out.doclist_bytes = doclists_bytes;
+        return out;
+    }
+
+private:
+    static constexpr size_t WRITE_BUFFER = size_t(1) << 20;
+
+    std::string lexicon_file;
+    std::string docids_file;
+    CodecType codec;
+    bool positional;
+    std::vector<uint32_t> doc_lengths;
+
+    std::vector<char> write_buffer = std::vector<char>(WRITE_BUFFER);
+    std::ofstream out;
+    uint64_t doclists_start = 0;
+    uint64_t doclists_bytes = 0;
+    bool finished = false;
+
+    FrontCodeLexicon lexicon;
+    std::vector<size_t> offsets; // por term ID, que es el orden de llegada
+    std::string last_term;
+    bool in_term = false;
+
+    // Lista en curso: bloques ya codificados y el bloque que se está llenando.
+    // El primer bloque se guarda también sin codificar por si la lista termina
+    // ahí (se codifica de nuevo con IDs absolutos).
+    uint32_t docs[POSTING_BLOCK];
+    uint32_t tfs[POSTING_BLOCK];
+    uint32_t first_docs[POSTING_BLOCK];
+    uint32_t first_tfs[POSTING_BLOCK];
+    uint32_t first_lengths[POSTING_BLOCK];
+    size_t pending = 0;
+    size_t count = 0;
+    size_t nblocks = 0;
+    uint32_t last_doc = 0;
+    uint32_t max_tf = 0;
+    uint32_t min_ratio = UINT32_MAX;
+    std::string skips;
+    std::string blocks;
+    std::string list;
+    uint64_t postings = 0;
+
+    // Posiciones: las del bloque que se está llenando, concatenadas por doc, y
+    // las de la lista en curso ya codificadas con su tabla de offsets por bloque
+    std::ofstream positions_out;
+    std::vector<size_t> positions_offsets;
+    uint64_t positions_bytes = 0;
+    std::vector<uint32_t> block_positions;
+    std::string position_table;
+    std::string position_blocks;
+
+    std::string temp_path() const { return docids_file + ".tmp"; }
+    std::string positions_path() const { return docids_file + ".pos.tmp"; }
+
+    // Escribe las posiciones de la lista recién cerrada (ver PositionListView)
+    void end_positions() {
+        list.clear();
+        if (nblocks == 1) position_table.clear();
+        write_varint(list, position_table.size() + position_blocks.size());
+        list += position_table;
+        list += position_blocks;
+        positions_offsets.push_back(static_cast<size_t>(positions_bytes));
+        positions_out.write(list.data(), static_cast<std::streamsize>(list.size()));
+        positions_bytes += list.size();
+        position_table.clear();
+        position_blocks.clear();
+    }
+
+    void flush_block() {
+        uint32_t lengths[POSTING_BLOCK];
+        for (size_t i = 0; i < pending; ++i) {
+            lengths[i] = docs[i] < doc_lengths.size() ? doc_lengths[docs[i]] : 0;
+        }
+        if (nblocks == 0) {
+            std::copy(docs, docs + pending, first_docs);
+            std::copy(tfs, tfs + pending, first_tfs);
+            std::copy(lengths, lengths + pending, first_lengths);
+        }
+        uint32_t offset = static_cast<uint32_t>(blocks.size());
+        SkipEntry entry = PostingListView::encode_block(codec, docs, tfs, lengths, pending, true, blocks);
+        entry.offset = offset;
+        skips.append(reinterpret_cast<const char*>(&entry), PostingListView::SKIP_ENTRY_SIZE);
+        if (positional) {
+            uint32_t position_offset = static_cast<uint32_t>(position_blocks.size());
+            position_table.append(reinterpret_cast<const char*>(&position_offset), sizeof(position_offset));
+            PositionListView::encode_block(codec, tfs, pending, block_positions.data(), block_positions.size(),
+                                           position_blocks);
+            block_positions.clear();
+        }
+        max_tf = std::max(max_tf, entry.max_tf);
+        min_ratio = std::min(min_ratio, entry.min_ratio);
+        last_doc = docs[pending - 1];
+        count += pending;
+        ++nblocks;
+        pending = 0;
+    }
+};
@@ -0,0 +1,356 @@
+#pragma once
+#include "CorpusSplitter.h"
+#include "TermAccumulator.h"
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+#include "Metrics.h"
+
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <exception>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+struct PipelineOptions {
+    size_t readers = 1;
+    size_t tokenizers = 1;
+    size_t indexers = 1;
+    // Buffers de lectura en circulación: el texto en memoria es a lo sumo
+    // buffers × tamaño de tramo
+    size_t buffers = 8;
+    // Lotes de términos entre cada tokenizador y cada indexador
+    size_t batch_bytes = size_t(64) << 10;
+    size_t queued_batches = 8;
+    // Particiones de cada acumulador (0 = 4 por indexador)
+    size_t partitions = 0;
+};
+
+// Segundos de cada etapa sumados entre sus hilos: trabajando y esperando a la
+// etapa anterior (datos) o a la siguiente (lugar en la cola). Por hilo está
+// además su tiempo de CPU y lo que procesó: bytes leídos los lectores, tokens
+// los tokenizadores y los indexadores.
+struct PipelineStats {
+    double read_busy = 0, read_wait = 0;
+    double tokenize_busy = 0, tokenize_wait = 0;
+    double index_busy = 0, index_wait = 0;
+    size_t chunks = 0;
+    uint64_t bytes = 0;
+    uint64_t tokens = 0;
+    double seconds = 0;
+    std::vector<ThreadMetrics> readers, tokenizers, indexers;
+};
+
+// Indexa un corpus en tres etapas con hilos propios, para que la lectura del
+// disco y el trabajo de CPU se solapen:
+//
+//   lectores --(MpmcQueue de tramos leídos)--> tokenizadores
+//   tokenizadores --(una SpscQueue por par)--> indexadores
+//
+// Los lectores toman los tramos en orden, piden el siguiente por adelantado
+// (posix_fadvise) y leen con pread a uno de 'buffers' buffers fijos que los
+// tokenizadores devuelven al terminar: si no hay buffer libre, la lectura
+// espera. Cada tokenizador arma por indexador lotes de (doc, hash, término);
+// un término va siempre al indexador dueño de su partición, así que cada
+// partición queda en un solo acumulador. Los lotes vacíos vuelven al
+// tokenizador por otra SpscQueue para no reservar memoria en cada uno. Los
+// tokenizadores cuentan además los términos de cada documento (4 bytes por
+// documento y tokenizador) para las longitudes que usa BM25.
+//
+// Si una etapa falla, las demás terminan y run() relanza el error.
+class IndexPipeline {
+public:
+    IndexPipeline(CorpusSplitter& corpus, const PipelineOptions& options) : corpus(corpus), options(options) {
+        this->options.readers = std::max<size_t>(options.readers, 1);
+        this->options.tokenizers = std::max<size_t>(options.tokenizers, 1);
+        this->options.indexers = std::max<size_t>(options.indexers, 1);
+        this->options.buffers = std::max<size_t>(options.buffers, 1);
+        this->options.queued_batches = std::max<size_t>(options.queued_batches, 1);
+        if (this->options.partitions == 0) this->options.partitions = 4 * this->options.indexers;
+    }
+
+    // Indexa el corpus; 'pool' se usa para partirlo. Devuelve la cantidad de documentos.
+    uint32_t run(ThreadPool& pool) {
+        chunks = corpus.split(pool);
+        stats = {};
+        failed = false;
+        error = nullptr;
+        next_chunk = 0;
+        active_readers = options.readers;
+
+        size_t T = options.tokenizers, I = options.indexers;
+        buffers.assign(options.buffers, {});
+        free_buffers = std::make_unique<MpmcQueue<uint32_t>>(options.buffers);
+        for (uint32_t b = 0; b < options.buffers; ++b) free_buffers->try_push(b);
+        ready = std::make_unique<MpmcQueue<ReadChunk>>(options.buffers);
+        links.clear();
+        for (size_t i = 0; i < T * I; ++i) links.push_back(std::make_unique<Link>(options.queued_batches));
+        accumulators.clear();
+        for (size_t i = 0; i < I; ++i) accumulators.push_back(std::make_unique<TermAccumulator>(options.partitions));
+        std::vector<std::vector<uint32_t>> lengths(T);
+
+        auto start = Clock::now();
+        std::vector<StageTime> times(options.readers + T + I);
+        std::vector<std::thread> threads;
+        for (size_t r = 0; r < options.readers; ++r) {
+            threads.emplace_back([this, &times, r] { guarded(times[r], [&] { read_stage(times[r]); }); });
+        }
+        for (size_t t = 0; t < T; ++t) {
+            StageTime& time = times[options.readers + t];
+            threads.emplace_back([this, &time, &lengths, t] {
+                guarded(time, [&] { tokenize_stage(t, time, lengths[t]); });
+            });
+        }
+        for (size_t i = 0; i < I; ++i) {
+            StageTime& time = times[options.readers + T + i];
+            threads.emplace_back([this, &time, i] { guarded(time, [&] { index_stage(i, time); }); });
+        }
+        for (auto& thread : threads) thread.join();
+
+        doc_lengths.assign(corpus.document_count(), 0);
+        for (const auto& own : lengths) {
+            for (size_t doc = 0; doc < own.size(); ++doc) doc_lengths[doc] += own[doc];
+        }
+
+        for (size_t t = 0; t < T; ++t) {
+            for (uint32_t length : lengths[t]) times[options.readers + t].items += length;
+        }
+        for (size_t i = 0; i < I; ++i) times[options.readers + T + i].items = accumulators[i]->token_count();
+
+        for (size_t k = 0; k < times.size(); ++k) {
+            ThreadMetrics thread;
+            thread.busy = times[k].total - times[k].wait;
+            thread.wait = times[k].wait;
+            thread.cpu = times[k].cpu;
+            thread.items = times[k].items;
+            if (k < options.readers) {
+                stats.read_busy += thread.busy;
+                stats.read_wait += thread.wait;
+                stats.readers.push_back(thread);
+            } else if (k < options.readers + T) {
+                stats.tokenize_busy += thread.busy;
+                stats.tokenize_wait += thread.wait;
+                stats.tokenizers.push_back(thread);
+            } else {
+                stats.index_busy += thread.busy;
+                stats.index_wait += thread.wait;
+                stats.indexers.push_back(thread);
+                stats.tokens += thread.items;
+            }
+        }
+        stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        stats.chunks = chunks.size();
+        for (const CorpusChunk& chunk : chunks) stats.bytes += chunk.end - chunk.begin;
+        buffers.clear();
+        links.clear();
+        if (error) std::rethrow_exception(error);
+        return corpus.document_count();
+    }
+
+    // Un acumulador por indexador, con options.partitions particiones cada uno
+    std::vector<const TermAccumulator*> sources() const {
+        std::vector<const TermAccumulator*> out;
+        for (const auto& accumulator : accumulators) out.push_back(accumulator.get());
+        return out;
+    }
+
+    // Términos de cada documento, por doc ID
+    const std::vector<uint32_t>& document_lengths() const { return doc_lengths; }
+
+    const PipelineStats& statistics() const { return stats; }
+    const PipelineOptions& settings() const { return options; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    // Entrada de un lote: doc, hash y largo (uint32_t cada uno) y el término
+    static constexpr size_t ENTRY_HEADER = 3 * sizeof(uint32_t);
+
+    struct ReadChunk {
+        uint32_t chunk;
+        uint32_t buffer;
+    };
+
+    struct Link {
+        SpscQueue<std::vector<char>> filled;
+        SpscQueue<std::vector<char>> empty;
+
+        explicit Link(size_t batches) : filled(batches), empty(batches) {}
+    };
+
+    struct StageTime {
+        double total = 0;
+        double wait = 0;
+        double cpu = 0;
+        uint64_t items = 0;
+    };
+
+    CorpusSplitter& corpus;
+    PipelineOptions options;
+    std::vector<CorpusChunk> chunks;
+    std::vector<std::vector<char>> buffers;
+    std::unique_ptr<MpmcQueue<uint32_t>> free_buffers;
+    std::unique_ptr<MpmcQueue<ReadChunk>> ready;
+    std::vector<std::unique_ptr<Link>> links; // tokenizador t, indexador i: t * indexers + i
+    std::vector<std::unique_ptr<TermAccumulator>> accumulators;
+    std::vector<uint32_t> doc_lengths;
+    PipelineStats stats;
+
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> active_readers{0};
+    std::atomic<bool> failed{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    Link& link(size_t tokenizer, size_t indexer) { return *links[tokenizer * options.indexers + indexer]; }
+
+    template <typename Body>
+    void guarded(StageTime& time, Body&& body) {
+        auto start = Clock::now();
+        double cpu_start = ResourceUsage::thread_cpu_seconds();
+        try {
+            body();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            failed = true;
+        }
+        time.total = std::chrono::duration<double>(Clock::now() - start).count();
+        time.cpu = ResourceUsage::thread_cpu_seconds() - cpu_start;
+    }
+
+    // Reintenta 'attempt' hasta que funcione; false si otra etapa falló mientras tanto
+    template <typename Attempt>
+    bool wait_for(StageTime& time, Attempt&& attempt) {
+        if (attempt()) return true;
+        auto start = Clock::now();
+        Backoff backoff;
+        bool done;
+        while (!(done = attempt()) && !failed.load(std::memory_order_relaxed)) backoff.pause();
+        time.wait += std::chrono::duration<double>(Clock::now() - start).count();
+        return done;
+    }
+
+    void read_stage(StageTime& time) {
+        struct Finish {
+            IndexPipeline* pipeline;
+            ~Finish() {
+                if (--pipeline->active_readers == 0) pipeline->ready->close();
+            }
+        } finish{this};
+
+        for (size_t c = next_chunk++; c < chunks.size() && !failed; c = next_chunk++) {
+            if (c + options.readers < chunks.size()) corpus.prefetch(chunks[c + options.readers]);
+            uint32_t buffer;
+            if (!wait_for(time, [&] { return free_buffers->try_pop(buffer); })) return;
+            corpus.read_chunk(chunks[c], buffers[buffer]);
+            time.items += chunks[c].end - chunks[c].begin;
+            ReadChunk item{static_cast<uint32_t>(c), buffer};
+            if (!wait_for(time, [&] { return ready->try_push(item); })) return;
+        }
+    }
+
+    void tokenize_stage(size_t t, StageTime& time, std::vector<uint32_t>& lengths) {
+        size_t I = options.indexers;
+        lengths.assign(corpus.document_count(), 0);
+        std::vector<std::vector<char>> batches(I);
+        auto send = [&](size_t i) {
+            Link& to = link(t, i);
+            if (!wait_for(time, [&] { return to.filled.try_push(batches[i]); })) return false;
+            if (!to.empty.try_pop(batches[i])) batches[i] = {};
+            batches[i].clear();
+            return true;
+        };
+        struct Finish {
+            IndexPipeline* pipeline;
+            size_t t;
+            ~Finish() {
+                for (size_t i = 0; i < pipeline->options.indexers; ++i) pipeline->link(t, i).filled.close();
+            }
+        } finish{this, t};
+
+        for (;;) {
+            ReadChunk item{};
+            bool done = false;
+            bool got = wait_for(time, [&] {
+                if (ready->try_pop(item)) return true;
+                // Cerrada por el último lector: lo que quede ya está en la cola
+                if (ready->is_closed()) done = !ready->try_pop(item);
+                return ready->is_closed();
+            });
+            if (!got || done) break;
+
+            bool ok = true;
+            corpus.tokenize_chunk(chunks[item.chunk], buffers[item.buffer].data(),
+                                  [&](std::string_view term, uint32_t doc) {
+                if (!ok) return;
+                ++lengths[doc];
+                uint32_t hash = TermAccumulator::hash_term(term);
+                size_t i = TermAccumulator::partition_of(hash, options.partitions) % I;
+                std::vector<char>& batch = batches[i];
+                uint32_t header[3] = {doc, hash, static_cast<uint32_t>(term.size())};
+                size_t at = batch.size();
+                batch.resize(at + ENTRY_HEADER + term.size());
+                std::memcpy(batch.data() + at, header, ENTRY_HEADER);
+                std::memcpy(batch.data() + at + ENTRY_HEADER, term.data(), term.size());
+                if (batch.size() >= options.batch_bytes) ok = send(i);
+            });
+            free_buffers->try_push(item.buffer); // siempre hay lugar: hay tantos lugares como buffers
+            if (!ok) return;
+        }
+        for (size_t i = 0; i < I; ++i) {
+            if (!batches[i].empty() && !send(i)) return;
+        }
+    }
+
+    void index_stage(size_t i, StageTime& time) {
+        TermAccumulator& terms = *accumulators[i];
+        std::vector<char> batch;
+        size_t T = options.tokenizers;
+        Backoff backoff;
+        bool idle = false;
+        Clock::time_point idle_since;
+        auto stop_waiting = [&] {
+            if (idle) time.wait += std::chrono::duration<double>(Clock::now() - idle_since).count();
+            idle = false;
+        };
+        for (;;) {
+            bool any = false;
+            bool all_finished = true;
+            for (size_t t = 0; t < T; ++t) {
+                Link& from = link(t, i);
+                if (!from.filled.try_pop(batch)) {
+                    all_finished &= from.filled.finished();
+                    continue;
+                }
+                any = true;
+                all_finished = false;
+                for (size_t at = 0; at < batch.size();) {
+                    uint32_t header[3];
+                    std::memcpy(header, batch.data() + at, ENTRY_HEADER);
+                    terms.add(std::string_view(batch.data() + at + ENTRY_HEADER, header[2]), header[1], header[0]);
+                    at += ENTRY_HEADER + header[2];
+                }
+                from.empty.try_push(batch);
+            }
+            if (any) {
+                stop_waiting();
+                backoff = Backoff();
+                continue;
+            }
+            if (all_finished || failed) {
+                stop_waiting();
+                return;
+            }
+            if (!idle) {
+                idle = true;
+                idle_since = Clock::now();
+            }
+            backoff.pause();
+        }
+    }
+};
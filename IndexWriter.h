@@ -0,0 +1,70 @@
+#pragma once
+#include "InvertedIndex.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Carga incremental por lotes sobre un InvertedIndex. Los documentos se
+// acumulan en memoria agrupados por term ID y las listas se reescriben recién
+// al hacer flush (a mano, al llenarse el buffer o al destruir el writer): cada
+// término paga una fusión y una codificación por flush, no una por documento.
+// Hasta el flush los documentos agregados no aparecen en las búsquedas.
+// Después de cada flush, si más de la mitad de los blobs quedó sin uso por
+// listas reemplazadas, se compacta el índice.
+class IndexWriter {
+public:
+    // Postings acumulados (pares término-doc) antes de un flush automático
+    static constexpr size_t DEFAULT_BUFFER_POSTINGS = size_t(1) << 22;
+
+    explicit IndexWriter(InvertedIndex& index, size_t max_buffered_postings = DEFAULT_BUFFER_POSTINGS)
+        : index(index), max_buffered_postings(max_buffered_postings) {}
+
+    // Hace el último flush. Un error ahí no puede salir del destructor y esos
+    // documentos se pierden: para enterarse, llamar a flush() antes.
+    ~IndexWriter() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    IndexWriter(const IndexWriter&) = delete;
+    IndexWriter& operator=(const IndexWriter&) = delete;
+
+    // La posición de cada término es su índice en 'terms'
+    void add_document(uint32_t doc_id, const std::vector<std::string>& terms) {
+        index.buffer_document(buffer, doc_id, terms);
+        ++buffered_docs;
+        if (buffer.postings >= max_buffered_postings) flush();
+    }
+
+    void flush() {
+        if (buffer.by_term.empty()) return;
+        index.flush_buffer(buffer);
+        buffered_docs = 0;
+        ++flushes;
+        if (auto_compact && index.garbage_bytes() * 2 > index.storage_bytes()) {
+            reclaimed += index.compact();
+            ++compactions;
+        }
+    }
+
+    void set_auto_compact(bool on) { auto_compact = on; }
+
+    size_t pending_documents() const { return buffered_docs; }
+    size_t pending_postings() const { return buffer.postings; }
+    size_t flush_count() const { return flushes; }
+    size_t compaction_count() const { return compactions; }
+    size_t reclaimed_bytes() const { return reclaimed; }
+
+private:
+    InvertedIndex& index;
+    InvertedIndex::PostingBuffer buffer;
+    size_t max_buffered_postings;
+    size_t buffered_docs = 0;
+    size_t flushes = 0;
+    bool auto_compact = true;
+    size_t compactions = 0;
+    size_t reclaimed = 0;
+};
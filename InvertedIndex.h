@@ -1,6 +1,13 @@
 #pragma once
 #include "FrontCodedLexicon.h"
 #include "GammaEncoder.h"
+#include "PostingCodecs.h"
+#include "PostingList.h"
+#include "PositionList.h"
+#include "TermTrie.h"
+#include "MappedFile.h"
+#include "Metrics.h"
+#include "SearchCache.h"
 
 #include <unordered_map>
 #include <vector>
@@ -9,141 +16,882 @@
 #include <set>
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <memory>
+#include <cstring>
 
 
 class InvertedIndex {
 private:
+    static constexpr uint32_t DOCIDS_MAGIC = 0x58444947; // "GIDX"
+    static constexpr uint32_t DOCIDS_VERSION = 10;
+    static constexpr size_t NO_LIST = static_cast<size_t>(-1);
+    // Bit alto de un offset de las tablas: la lista es un directorio por trozos
+    // (ver ChunkedHeader en PostingList.h y append_postings)
+    static constexpr size_t CHUNKED = size_t(1) << 63;
+    
+    using Blob = MappedArray<char, std::string>;
+    using Offsets = MappedArray<size_t>;
+    
+    // Cabecera fija con la tabla de secciones; cada sección empieza alineada y
+    // se usa en su lugar desde el archivo mapeado. Al final, los bytes de las
+    // listas que ya no se usan (ver garbage_bytes).
+    struct DocidsHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t codec;
+        uint32_t flags;
+        uint64_t total_doc_length;
+        uint32_t num_docs;
+        uint32_t reserved;
+        FileSection doclists;
+        FileSection doclist_offsets;
+        FileSection doc_lengths;
+        FileSection positions;
+        FileSection positions_offsets;
+        uint64_t garbage;
+    };
+    
     FrontCodeLexicon lexicon;
-    std::string concatenated_doc_ids;
-    std::unordered_map<size_t, size_t> term_offset_to_doclist_offset;
+    CodecType codec;
+    Blob concatenated_doc_ids;
+    // Offset de la lista de cada término en el blob, indexado por ID (NO_LIST si no tiene)
+    Offsets doclist_offsets;
+    
+    // Capa posicional opcional, en un blob aparte (ver PositionList.h)
+    bool positional;
+    Blob concatenated_positions;
+    Offsets positions_offsets;
+    
+    // Longitud (en términos) de cada documento, indexada por doc ID; 0 = desconocida
+    MappedArray<uint32_t> doc_lengths;
+    uint64_t total_doc_length = 0;
+    uint32_t num_docs = 0;
+    
+    // Archivo de docids mapeado del que leen las secciones anteriores (si se cargó así).
+    // Al modificar el índice cada sección se copia a memoria propia.
+    std::shared_ptr<const MappedFile> docids_mapping;
+    
+    // Bytes de los blobs que ya no usa ninguna lista (versiones reemplazadas);
+    // compact() los recupera
+    uint64_t garbage = 0;
+    
+    // Si está activo, add_document imprime cada término con su doc
+    bool verbose = false;
+    
+    // Registro de métricas opcional (ver set_metrics) y el histograma de search()
+    Metrics* metrics = nullptr;
+    LatencyHistogram* search_latency = nullptr;
+    
+    // Caché opcional de listas decodificadas (ver set_cache)
+    SearchCache* cache = nullptr;
+    
+    // Postings pendientes de una carga por lotes, agrupados por term ID. Cada
+    // flush hace un solo update_doclist por término en lugar de uno por doc.
+    struct PostingBuffer {
+        struct Postings {
+            std::vector<uint32_t> docs;
+            std::vector<uint32_t> tfs;
+            std::vector<uint32_t> positions;
+        };
+        std::unordered_map<uint32_t, Postings> by_term;
+        size_t postings = 0;
+    };
+    friend class IndexWriter;
+    friend class IndexFileWriter;
     
-    void update_doclist(size_t term_offset, const std::vector<uint32_t>& new_docs) {
-        std::vector<uint32_t> existing_docs;
+    // Tries para expandir comodines y errores de tipeo; se arman al primer uso
+    // y se rehacen si cambió el léxico
+    mutable TermDictionary dictionary;
+    mutable uint32_t dictionary_terms = 0;
+    mutable bool dictionary_built = false;
+    
+    // 'new_tfs' vacío equivale a tf = 1. Un doc ya presente toma la nueva frecuencia.
+    // En un índice posicional 'new_positions' trae las posiciones de cada doc nuevo,
+    // concatenadas (tf posiciones crecientes por doc).
+    void update_doclist(uint32_t term_id, const std::vector<uint32_t>& new_docs,
+                        const std::vector<uint32_t>& new_tfs = {},
+                        const std::vector<uint32_t>& new_positions = {}) {
+        if (cache) cache->invalidate_term(term_id);
+        std::vector<uint32_t> existing_docs, existing_tfs, existing_positions;
+        
+        if (positional) {
+            size_t total = 0;
+            for (uint32_t tf : new_tfs) {
+                if (tf == 0) throw std::runtime_error("El índice es posicional: tf 0 sin posiciones");
+                total += tf;
+            }
+            if (new_positions.size() != (new_tfs.empty() ? new_docs.size() : total)) {
+                throw std::runtime_error("El índice es posicional: faltan posiciones");
+            }
+        }
+        
+        // Lo habitual al indexar: docs nuevos posteriores a todos los de la lista
+        size_t list_offset = offset_of(doclist_offsets, term_id);
+        if (list_offset != NO_LIST && new_docs.empty()) return;
+        if (list_offset != NO_LIST && appends_to_tail(list_offset, new_docs)) {
+            append_postings(term_id, list_offset, new_docs, new_tfs, new_positions);
+            return;
+        }
         
         // Obtener docs existentes si hay
-        auto it = term_offset_to_doclist_offset.find(term_offset);
-        if (it != term_offset_to_doclist_offset.end()) {
-            std::string encoded = concatenated_doc_ids.substr(it->second);
-            existing_docs = GammaEncoder::decode(encoded);
+        size_t old_size = 0;
+        if (list_offset != NO_LIST) {
+            old_size = decode_list(list_offset, existing_docs, &existing_tfs);
         }
         
-        // Fusionar y ordenar
-        std::vector<uint32_t> merged_docs(existing_docs);
-        merged_docs.insert(merged_docs.end(), new_docs.begin(), new_docs.end());
-        std::sort(merged_docs.begin(), merged_docs.end());
-        merged_docs.erase(std::unique(merged_docs.begin(), merged_docs.end()), merged_docs.end());
+        size_t old_positions_size = 0;
+        std::vector<size_t> existing_starts, incoming_starts;
+        if (positional) {
+            size_t positions_offset = offset_of(positions_offsets, term_id);
+            if (positions_offset != NO_LIST) {
+                old_positions_size = decode_positions(positions_offset, list_at(list_offset), existing_positions);
+            }
+            existing_starts = position_starts(existing_tfs);
+            incoming_starts = position_starts(new_tfs.empty() ? std::vector<uint32_t>(new_docs.size(), 1) : new_tfs);
+        }
         
-        // Codificar la nueva lista
-        std::string encoded = GammaEncoder::encode(merged_docs);
-        
-        // Actualizar o agregar
-        if (it != term_offset_to_doclist_offset.end()) {
-            // Intentar reutilizar el espacio si es suficiente
-            size_t old_offset = it->second;
-            std::string old_encoded = concatenated_doc_ids.substr(old_offset);
-            if (encoded.size() <= old_encoded.size()) {
-                for (size_t i = 0; i < encoded.size(); ++i) {
-                    concatenated_doc_ids[old_offset + i] = encoded[i];
+        // Fusionar y ordenar: (doc, tf, índice en new_docs)
+        std::vector<std::tuple<uint32_t, uint32_t, size_t>> incoming;
+        incoming.reserve(new_docs.size());
+        for (size_t i = 0; i < new_docs.size(); ++i) {
+            incoming.emplace_back(new_docs[i], new_tfs.empty() ? 1 : new_tfs[i], i);
+        }
+        std::stable_sort(incoming.begin(), incoming.end(),
+                         [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); });
+        
+        std::vector<uint32_t> merged_docs, merged_tfs, merged_positions;
+        merged_docs.reserve(existing_docs.size() + incoming.size());
+        merged_tfs.reserve(existing_docs.size() + incoming.size());
+        size_t i = 0, j = 0;
+        while (i < existing_docs.size() || j < incoming.size()) {
+            if (j == incoming.size() || (i < existing_docs.size() && existing_docs[i] < std::get<0>(incoming[j]))) {
+                merged_docs.push_back(existing_docs[i]);
+                merged_tfs.push_back(existing_tfs[i]);
+                if (positional) {
+                    merged_positions.insert(merged_positions.end(), existing_positions.begin() + existing_starts[i],
+                                            existing_positions.begin() + existing_starts[i + 1]);
                 }
-                return;
+                ++i;
+                continue;
+            }
+            uint32_t doc = std::get<0>(incoming[j]);
+            if (i < existing_docs.size() && existing_docs[i] == doc) ++i;
+            while (j + 1 < incoming.size() && std::get<0>(incoming[j + 1]) == doc) ++j;
+            merged_docs.push_back(doc);
+            merged_tfs.push_back(std::get<1>(incoming[j]));
+            if (positional) {
+                size_t k = std::get<2>(incoming[j]);
+                merged_positions.insert(merged_positions.end(), new_positions.begin() + incoming_starts[k],
+                                        new_positions.begin() + incoming_starts[k + 1]);
             }
+            ++j;
         }
         
-        // Agregar al final
-        term_offset_to_doclist_offset[term_offset] = concatenated_doc_ids.size();
-        concatenated_doc_ids += encoded;
+        // Codificar la nueva lista
+        store_list(concatenated_doc_ids, doclist_offsets, term_id,
+                   encode_list(merged_docs, merged_tfs), old_size);
+        
+        if (positional) {
+            std::string encoded;
+            PositionListView::encode(codec, merged_tfs, merged_docs.size(), merged_positions, encoded);
+            store_list(concatenated_positions, positions_offsets, term_id,
+                       encoded, old_positions_size);
+        }
     }
     
-public:
-    InvertedIndex() : lexicon(100) {}
+    // Registra el documento en el léxico, sus longitudes y 'buffer'; no toca las listas
+    void buffer_document(PostingBuffer& buffer, uint32_t doc_id, const std::vector<std::string>& terms) {
+        std::unordered_map<std::string, std::vector<uint32_t>> term_positions;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            term_positions[terms[i]].push_back(static_cast<uint32_t>(i));
+        }
+        set_doc_length(doc_id, static_cast<uint32_t>(terms.size()));
+        
+        for (const auto& entry : term_positions) {
+            PostingBuffer::Postings& postings = buffer.by_term[lexicon.add_term(entry.first)];
+            postings.docs.push_back(doc_id);
+            postings.tfs.push_back(static_cast<uint32_t>(entry.second.size()));
+            if (positional) {
+                postings.positions.insert(postings.positions.end(), entry.second.begin(), entry.second.end());
+            }
+            if (verbose) {
+                std::cout << "Term: " << entry.first << " -> Doc: " << doc_id << std::endl;
+            }
+        }
+        buffer.postings += term_positions.size();
+    }
     
-    void add_document(uint32_t doc_id, const std::vector<std::string>& terms) {
-        std::unordered_map<std::string, std::vector<uint32_t>> term_doc_map;
+    // Una fusión y una codificación por término, en orden de ID
+    void flush_buffer(PostingBuffer& buffer) {
+        std::vector<uint32_t> term_ids;
+        term_ids.reserve(buffer.by_term.size());
+        for (const auto& entry : buffer.by_term) term_ids.push_back(entry.first);
+        std::sort(term_ids.begin(), term_ids.end());
         
-        for (const auto& term : terms) {
-            term_doc_map[term].push_back(doc_id);
+        for (uint32_t term_id : term_ids) {
+            const PostingBuffer::Postings& postings = buffer.by_term[term_id];
+            update_doclist(term_id, postings.docs, postings.tfs, postings.positions);
         }
-
-        // Imprimir el term_doc_map
-        std::cout << "Term -> Documents:\n";
-        for (const auto& entry : term_doc_map) {
-            const std::string& term = entry.first;
-            const std::vector<uint32_t>& doc_list = entry.second;
-            
-            std::cout << "Term: " << term << " -> Docs: ";
-            for (uint32_t doc : doc_list) {
-                std::cout << doc << " ";
+        buffer.by_term.clear();
+        buffer.postings = 0;
+    }
+    
+    // Reutiliza el espacio de la lista anterior si alcanza; si no, agrega al final.
+    // 'old_size' son los bytes que ocupaba la lista anterior.
+    void store_list(Blob& blob, Offsets& offsets,
+                    uint32_t term_id, const std::string& encoded, size_t old_size) {
+        std::vector<size_t>& table = offsets.mutate();
+        std::string& bytes = blob.mutate();
+        if (term_id >= table.size()) table.resize(size_t(term_id) + 1, NO_LIST);
+        size_t old_offset = table[term_id];
+        if (old_offset != NO_LIST && !(old_offset & CHUNKED) && encoded.size() <= old_size) {
+            std::copy(encoded.begin(), encoded.end(), bytes.begin() + old_offset);
+            garbage += old_size - encoded.size();
+            return;
+        }
+        if (old_offset != NO_LIST) garbage += old_size;
+        table[term_id] = bytes.size();
+        bytes += encoded;
+    }
+    
+    // Si la actualización solo agrega docs posteriores al último de una lista de
+    // más de un bloque (los bloques completos se pueden conservar tal cual)
+    bool appends_to_tail(size_t list_offset, const std::vector<uint32_t>& new_docs) const {
+        PostingListView list = list_at(list_offset);
+        if (list.block_count() < 2 || new_docs.empty() || new_docs[0] <= list.last_doc()) return false;
+        for (size_t i = 1; i < new_docs.size(); ++i) {
+            if (new_docs[i] <= new_docs[i - 1]) return false;
+        }
+        return true;
+    }
+    
+    // Agrega postings al final de una lista sin reescribirla: se decodifica solo
+    // el último bloque si está incompleto, los bloques nuevos van al final del
+    // blob y el directorio recibe sus entradas. Cuando el directorio se llena
+    // (o la lista era contigua) se escribe otro con el doble de capacidad, así
+    // que el costo amortizado es proporcional a los postings nuevos.
+    void append_postings(uint32_t term_id, size_t list_offset, const std::vector<uint32_t>& new_docs,
+                         const std::vector<uint32_t>& new_tfs, const std::vector<uint32_t>& new_positions) {
+        size_t directory_size;
+        PostingListView list = list_at(list_offset, &directory_size);
+        size_t nblocks = list.block_count();
+        size_t keep = list.block_postings(nblocks - 1) == POSTING_BLOCK ? nblocks : nblocks - 1;
+        const char* doc_base = concatenated_doc_ids.data();
+        
+        // Postings del bloque incompleto seguidos de los nuevos
+        std::vector<uint32_t> docs, tfs;
+        uint32_t block_docs[POSTING_BLOCK], block_tfs[POSTING_BLOCK];
+        uint64_t dropped = 0;
+        for (size_t b = keep; b < nblocks; ++b) {
+            size_t n = list.block_postings(b);
+            list.decode_block_freqs(b, list.decode_block(b, block_docs), block_tfs);
+            docs.insert(docs.end(), block_docs, block_docs + n);
+            tfs.insert(tfs.end(), block_tfs, block_tfs + n);
+            const char *begin, *end;
+            list.block_bytes(b, begin, end);
+            dropped += end - begin;
+        }
+        docs.insert(docs.end(), new_docs.begin(), new_docs.end());
+        if (new_tfs.empty()) tfs.resize(docs.size(), 1);
+        else tfs.insert(tfs.end(), new_tfs.begin(), new_tfs.end());
+        
+        size_t total_blocks = keep + (docs.size() + POSTING_BLOCK - 1) / POSTING_BLOCK;
+        size_t capacity = list.chunked ? list.size / sizeof(ChunkEntry) : 0;
+        bool relocate = capacity < total_blocks;
+        
+        // Entradas de los bloques conservados, con offsets absolutos, si el directorio se mueve
+        std::vector<ChunkEntry> kept;
+        for (size_t b = 0; relocate && b < keep; ++b) {
+            const char *begin, *end;
+            list.block_bytes(b, begin, end);
+            SkipEntry skip = list.skip_entry(b);
+            kept.push_back({begin - doc_base, static_cast<uint32_t>(end - begin),
+                            skip.first, skip.last, skip.max_tf, skip.min_ratio, 0});
+        }
+        if (!list.chunked) directory_size -= list.blocks_size(); // la lista contigua deja su cabecera y tabla
+        
+        // Lo mismo para las posiciones, alineadas bloque a bloque
+        std::vector<uint32_t> positions;
+        std::vector<PositionChunk> kept_positions;
+        size_t positions_offset = NO_LIST, positions_directory = 0, positions_capacity = 0;
+        uint64_t dropped_positions = 0;
+        if (positional) {
+            positions_offset = offset_of(positions_offsets, term_id);
+            PositionListView view = positions_at(positions_offset, list, &positions_directory);
+            const char* base = concatenated_positions.data();
+            std::vector<uint32_t> block_positions;
+            for (size_t b = keep, t = 0; b < nblocks; t += list.block_postings(b), ++b) {
+                view.decode_block(b, tfs.data() + t, list.block_postings(b), block_positions);
+                positions.insert(positions.end(), block_positions.begin(), block_positions.end());
+                const char *begin, *end;
+                view.block_bytes(b, begin, end);
+                dropped_positions += end - begin;
+            }
+            positions.insert(positions.end(), new_positions.begin(), new_positions.end());
+            positions_capacity = view.chunked ? view.size / sizeof(PositionChunk) : 0;
+            for (size_t b = 0; positions_capacity < total_blocks && b < keep; ++b) {
+                const char *begin, *end;
+                view.block_bytes(b, begin, end);
+                kept_positions.push_back({begin - base, static_cast<uint64_t>(end - begin)});
             }
-            std::cout << std::endl;
+            if (!view.chunked) positions_directory -= view.blocks_size();
+        }
+        
+        // Bloques nuevos al final del blob (las vistas de arriba dejan de valer)
+        ChunkedHeader header{static_cast<uint32_t>(keep * POSTING_BLOCK + docs.size()), list.max_tf, list.min_ratio,
+                             static_cast<uint32_t>(relocate ? std::max<size_t>(2 * total_blocks, 4) : capacity)};
+        std::vector<ChunkEntry> added;
+        std::string& doc_bytes = concatenated_doc_ids.mutate();
+        for (size_t i = 0; i < docs.size(); i += POSTING_BLOCK) {
+            size_t n = std::min(POSTING_BLOCK, docs.size() - i);
+            uint32_t lengths[POSTING_BLOCK];
+            for (size_t j = 0; j < n; ++j) lengths[j] = doc_length(docs[i + j]);
+            size_t at = doc_bytes.size();
+            SkipEntry skip = PostingListView::encode_block(codec, docs.data() + i, tfs.data() + i, lengths, n,
+                                                           true, doc_bytes);
+            added.push_back({static_cast<int64_t>(at), static_cast<uint32_t>(doc_bytes.size() - at),
+                             skip.first, skip.last, skip.max_tf, skip.min_ratio, 0});
+            header.max_tf = std::max(header.max_tf, skip.max_tf);
+            header.min_ratio = std::min(header.min_ratio, skip.min_ratio);
+        }
+        
+        size_t directory_at = list_offset & ~CHUNKED;
+        if (relocate) {
+            directory_at = doc_bytes.size();
+            doc_bytes.resize(directory_at + sizeof(header) + size_t(header.capacity) * sizeof(ChunkEntry), '\0');
+            garbage += directory_size;
+            doclist_offsets.mutate()[term_id] = directory_at | CHUNKED;
+        }
+        std::memcpy(&doc_bytes[directory_at], &header, sizeof(header));
+        write_entries(doc_bytes, directory_at + sizeof(header), 0, kept);
+        write_entries(doc_bytes, directory_at + sizeof(header), keep, added);
+        garbage += dropped;
+        
+        if (!positional) return;
+        std::vector<PositionChunk> added_positions;
+        std::string& position_bytes = concatenated_positions.mutate();
+        size_t k = 0;
+        for (size_t i = 0; i < docs.size(); i += POSTING_BLOCK) {
+            size_t n = std::min(POSTING_BLOCK, docs.size() - i);
+            size_t at = position_bytes.size();
+            k += PositionListView::encode_block(codec, tfs.data() + i, n, positions.data() + k, positions.size() - k,
+                                                position_bytes);
+            added_positions.push_back({static_cast<int64_t>(at), position_bytes.size() - at});
+        }
+        if (k != positions.size()) {
+            throw std::runtime_error("Posiciones inválidas para la lista");
+        }
+        
+        directory_at = positions_offset & ~CHUNKED;
+        if (positions_capacity < total_blocks) {
+            uint64_t new_capacity = std::max<size_t>(2 * total_blocks, 4);
+            directory_at = position_bytes.size();
+            position_bytes.resize(directory_at + sizeof(new_capacity) + new_capacity * sizeof(PositionChunk), '\0');
+            std::memcpy(&position_bytes[directory_at], &new_capacity, sizeof(new_capacity));
+            garbage += positions_directory;
+            positions_offsets.mutate()[term_id] = directory_at | CHUNKED;
+        }
+        write_entries(position_bytes, directory_at + sizeof(uint64_t), 0, kept_positions);
+        write_entries(position_bytes, directory_at + sizeof(uint64_t), keep, added_positions);
+        garbage += dropped_positions;
+    }
+    
+    // Copia entradas de directorio con offsets absolutos a partir de la
+    // posición 'first' del directorio cuyas entradas empiezan en 'entries_at',
+    // pasando los offsets a relativos
+    template <typename Entry>
+    static void write_entries(std::string& bytes, size_t entries_at, size_t first, const std::vector<Entry>& entries) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            Entry entry = entries[i];
+            entry.offset -= static_cast<int64_t>(entries_at);
+            std::memcpy(&bytes[entries_at + (first + i) * sizeof(Entry)], &entry, sizeof(Entry));
+        }
+    }
+    
+    static size_t offset_of(const Offsets& offsets, uint32_t term_id) {
+        return term_id < offsets.size() ? offsets[term_id] : NO_LIST;
+    }
+    
+    // Índice de la primera posición de cada posting (y el total al final)
+    static std::vector<size_t> position_starts(const std::vector<uint32_t>& tfs) {
+        std::vector<size_t> starts(tfs.size() + 1, 0);
+        for (size_t i = 0; i < tfs.size(); ++i) starts[i + 1] = starts[i] + tfs[i];
+        return starts;
+    }
+    
+    std::string encode_list(const std::vector<uint32_t>& docs, const std::vector<uint32_t>& tfs) const {
+        std::vector<uint32_t> lengths(docs.size());
+        for (size_t i = 0; i < docs.size(); ++i) lengths[i] = doc_length(docs[i]);
+        std::string out;
+        PostingListView::encode(codec, docs, tfs, lengths, out);
+        return out;
+    }
+    
+    // 'offset' tal como está en la tabla (con el bit CHUNKED si corresponde)
+    PostingListView list_at(size_t offset, size_t* total_size = nullptr) const {
+        const char* end = concatenated_doc_ids.data() + concatenated_doc_ids.size();
+        if (offset & CHUNKED) {
+            return PostingListView::parse_chunked(concatenated_doc_ids.data() + (offset & ~CHUNKED), end, codec,
+                                                  total_size);
+        }
+        return PostingListView::parse(concatenated_doc_ids.data() + offset, end, codec, total_size);
+    }
+    
+    // Devuelve los bytes ocupados por la lista (en una por trozos, directorio y bloques)
+    size_t decode_list(size_t offset, std::vector<uint32_t>& docs, std::vector<uint32_t>* tfs = nullptr) const {
+        size_t total_size;
+        PostingListView list = list_at(offset, &total_size);
+        list.decode(docs, tfs);
+        for (size_t b = 0; list.chunked && b < list.block_count(); ++b) total_size += list.chunk_entry(b).bytes;
+        return total_size;
+    }
+    
+    PositionListView positions_at(size_t offset, const PostingListView& list, size_t* total_size = nullptr) const {
+        const char* end = concatenated_positions.data() + concatenated_positions.size();
+        if (offset & CHUNKED) {
+            return PositionListView::parse_chunked(concatenated_positions.data() + (offset & ~CHUNKED), end, codec,
+                                                   list.block_count(), total_size);
+        }
+        return PositionListView::parse(concatenated_positions.data() + offset, end, codec,
+                                       list.block_count(), total_size);
+    }
+    
+    // Agrega todas las posiciones de la lista; devuelve los bytes que ocupan
+    size_t decode_positions(size_t offset, const PostingListView& list, std::vector<uint32_t>& positions) const {
+        size_t total_size;
+        PositionListView view = positions_at(offset, list, &total_size);
+        std::vector<uint32_t> docs, tfs, block_positions;
+        list.decode(docs, &tfs);
+        for (size_t b = 0; b < list.block_count(); ++b) {
+            view.decode_block(b, tfs.data() + b * POSTING_BLOCK, list.block_postings(b), block_positions);
+            positions.insert(positions.end(), block_positions.begin(), block_positions.end());
+            if (view.chunked) total_size += view.chunk_entry(b).bytes;
         }
+        return total_size;
+    }
+    
+    static void read_blob(std::ifstream& in, Blob& blob) {
+        size_t size = 0;
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        std::string& bytes = blob.reset();
+        bytes.resize(size);
+        in.read(&bytes[0], size);
+    }
+    
+    // Formato original: [size_t n][(offset del término, offset de la lista) x n]
+    static void read_legacy_offsets(std::ifstream& in, const std::unordered_map<size_t, uint32_t>& legacy_ids,
+                                    Offsets& offsets) {
+        size_t map_size = 0;
+        in.read(reinterpret_cast<char*>(&map_size), sizeof(map_size));
         
-        for (const auto& entry : term_doc_map) {
-            const std::string& term = entry.first;
-            size_t term_offset = lexicon.get_term_offset(term);
+        std::vector<size_t>& table = offsets.reset();
+        table.assign(legacy_ids.size(), NO_LIST);
+        for (size_t i = 0; i < map_size && in; ++i) {
+            size_t term_offset, list_offset;
+            in.read(reinterpret_cast<char*>(&term_offset), sizeof(term_offset));
+            in.read(reinterpret_cast<char*>(&list_offset), sizeof(list_offset));
             
-            if (term_offset == static_cast<size_t>(-1)) {
-                lexicon.add_terms({term});
-                term_offset = lexicon.get_term_offset(term);
+            auto it = legacy_ids.find(term_offset);
+            if (it == legacy_ids.end()) {
+                throw std::runtime_error("El léxico no corresponde al archivo de docids");
             }
+            table[it->second] = list_offset;
+        }
+    }
+    
+    void set_doc_length(uint32_t doc_id, uint32_t length) {
+        std::vector<uint32_t>& lengths = doc_lengths.mutate();
+        if (doc_id >= lengths.size()) lengths.resize(size_t(doc_id) + 1, 0);
+        if (lengths[doc_id] == 0 && length > 0) ++num_docs;
+        total_doc_length += length;
+        total_doc_length -= lengths[doc_id];
+        lengths[doc_id] = length;
+    }
+    
+    // Reescribe el blob del formato antiguo (un char '0'/'1' por bit, sin longitud:
+    // cada lista termina donde empieza la siguiente) con el formato actual
+    void convert_legacy_doclists() {
+        std::vector<size_t>& offsets = doclist_offsets.mutate();
+        std::vector<std::pair<size_t, uint32_t>> by_offset; // (offset antiguo, ID)
+        for (uint32_t id = 0; id < offsets.size(); ++id) {
+            if (offsets[id] != NO_LIST) by_offset.emplace_back(offsets[id], id);
+        }
+        std::sort(by_offset.begin(), by_offset.end());
+        
+        std::string packed;
+        for (size_t i = 0; i < by_offset.size(); ++i) {
+            size_t begin = by_offset[i].first;
+            size_t end = (i + 1 < by_offset.size()) ? by_offset[i + 1].first : concatenated_doc_ids.size();
+            if (begin > concatenated_doc_ids.size()) begin = end = concatenated_doc_ids.size();
             
-            update_doclist(term_offset, entry.second);
+            std::vector<uint32_t> docs = GammaEncoder::decode_legacy(concatenated_doc_ids.data() + begin, end - begin);
+            offsets[by_offset[i].second] = packed.size();
+            packed += encode_list(docs, {});
         }
+        concatenated_doc_ids.reset().swap(packed);
     }
     
-    std::vector<uint32_t> search(const std::string& term) const {
-        size_t term_offset = lexicon.get_term_offset(term);
-        if (term_offset == static_cast<size_t>(-1)) {
+    void map_docids(const std::string& docids_file) {
+        auto file = std::make_shared<const MappedFile>(docids_file);
+        DocidsHeader header;
+        if (file->size() < sizeof(header)) {
+            throw std::runtime_error("Archivo de docids truncado: " + docids_file);
+        }
+        std::memcpy(&header, file->data(), sizeof(header));
+        
+        codec = static_cast<CodecType>(header.codec);
+        positional = (header.flags & 1) != 0;
+        total_doc_length = header.total_doc_length;
+        num_docs = header.num_docs;
+        garbage = header.garbage;
+        concatenated_doc_ids.map(file->section<char>(header.doclists), header.doclists.bytes);
+        doclist_offsets.map(file->section<size_t>(header.doclist_offsets), header.doclist_offsets.bytes / sizeof(size_t));
+        doc_lengths.map(file->section<uint32_t>(header.doc_lengths), header.doc_lengths.bytes / sizeof(uint32_t));
+        concatenated_positions.map(file->section<char>(header.positions), header.positions.bytes);
+        positions_offsets.map(file->section<size_t>(header.positions_offsets),
+                              header.positions_offsets.bytes / sizeof(size_t));
+        
+        // Las tablas chicas se leen en cualquier orden; las listas se leen de a
+        // una, así que leer por adelantado solo traería páginas de otros términos
+        file->advise(header.doclist_offsets, MappedFile::Access::WillNeed);
+        file->advise(header.positions_offsets, MappedFile::Access::WillNeed);
+        file->advise(header.doc_lengths, MappedFile::Access::WillNeed);
+        file->advise(header.doclists, MappedFile::Access::Random);
+        file->advise(header.positions, MappedFile::Access::Random);
+        docids_mapping = std::move(file);
+    }
+    
+    // Reemplaza el léxico y las listas por los de 'loaded' (ver load_from_files);
+    // la configuración (caché, métricas, verbose) sigue siendo la de este índice
+    void install(InvertedIndex& loaded) {
+        lexicon = std::move(loaded.lexicon);
+        codec = loaded.codec;
+        concatenated_doc_ids = std::move(loaded.concatenated_doc_ids);
+        doclist_offsets = std::move(loaded.doclist_offsets);
+        positional = loaded.positional;
+        concatenated_positions = std::move(loaded.concatenated_positions);
+        positions_offsets = std::move(loaded.positions_offsets);
+        doc_lengths = std::move(loaded.doc_lengths);
+        total_doc_length = loaded.total_doc_length;
+        num_docs = loaded.num_docs;
+        docids_mapping = std::move(loaded.docids_mapping);
+        garbage = loaded.garbage;
+        // Con otro léxico del mismo tamaño el diccionario no notaría el cambio
+        dictionary_built = false;
+        if (cache) cache->clear();
+    }
+    
+    SearchCache::DocsPointer lookup_docs(const std::string& term) const {
+        uint32_t term_id = lexicon.get_term_id(term);
+        if (term_id == FrontCodeLexicon::NOT_FOUND) return std::make_shared<const std::vector<uint32_t>>();
+        if (cache) {
+            if (auto cached = cache->find_postings(term_id)) return cached;
+        }
+        auto docs = std::make_shared<const std::vector<uint32_t>>(posting_list(term_id).decode());
+        if (cache) cache->store_postings(term_id, docs);
+        return docs;
+    }
+    
+public:
+    // Con 'positional' se guarda además la posición de cada aparición, necesaria
+    // para consultas de frase y de proximidad
+    explicit InvertedIndex(CodecType codec = CodecType::Gamma, bool positional = false)
+        : codec(codec), positional(positional) {}
+    
+    CodecType codec_type() const { return codec; }
+    bool has_positions() const { return positional; }
+    
+    // Con 'on' add_document y add_documents imprimen cada término indexado
+    void set_verbose(bool on) { verbose = on; }
+    
+    // Con un registro, add_document y add_documents suman la etapa
+    // "add_documents" (ítems = términos) y search() registra su latencia en el
+    // histograma "term_search"; QueryEngine también lo usa. nullptr lo quita.
+    void set_metrics(Metrics* registry) {
+        metrics = registry;
+        search_latency = registry ? &registry->histogram("term_search") : nullptr;
+    }
+    Metrics* metrics_registry() const { return metrics; }
+    
+    // Con una caché, search() y lookup() guardan las listas decodificadas y
+    // QueryEngine los resultados de sus consultas. Cada cambio de una lista la
+    // invalida y cargar de disco la vacía. nullptr la quita.
+    void set_cache(SearchCache* search_cache) {
+        cache = search_cache;
+        if (cache) cache->clear();
+    }
+    SearchCache* search_cache() const { return cache; }
+    
+    // La posición de cada término es su índice en 'terms'. Para muchos
+    // documentos conviene add_documents o IndexWriter: cada llamada a esta
+    // reescribe la lista completa de cada uno de sus términos.
+    void add_document(uint32_t doc_id, const std::vector<std::string>& terms) {
+        Metrics::Stage stage(metrics, "add_documents");
+        stage.add_items(terms.size());
+        PostingBuffer buffer;
+        buffer_document(buffer, doc_id, terms);
+        flush_buffer(buffer);
+    }
+    
+    // Carga por lotes: 'documents' es un rango de pares (doc ID, términos).
+    // Las listas se reescriben una vez por término y no una vez por documento.
+    template <typename Range>
+    void add_documents(const Range& documents) {
+        Metrics::Stage stage(metrics, "add_documents");
+        PostingBuffer buffer;
+        for (const auto& document : documents) {
+            buffer_document(buffer, document.first, document.second);
+            stage.add_items(document.second.size());
+        }
+        flush_buffer(buffer);
+    }
+    
+    // Vista sin copia de la lista de un término; vacía si no existe
+    PostingListView posting_list(const std::string& term) const {
+        uint32_t term_id = lexicon.get_term_id(term);
+        if (term_id == FrontCodeLexicon::NOT_FOUND) {
+            return {};
+        }
+        return posting_list(term_id);
+    }
+    
+    PostingListView posting_list(uint32_t term_id) const {
+        size_t offset = offset_of(doclist_offsets, term_id);
+        if (offset == NO_LIST) {
             return {};
         }
         
-        auto it = term_offset_to_doclist_offset.find(term_offset);
-        if (it == term_offset_to_doclist_offset.end()) {
+        return list_at(offset);
+    }
+    
+    // Cursor con next_geq sobre la lista de un término (at_end() si no existe)
+    PostingCursor cursor(const std::string& term) const {
+        return PostingCursor(posting_list(term));
+    }
+    
+    // Posiciones de un término, alineadas con su lista; vacía si no hay
+    PositionListView position_list(const std::string& term) const {
+        if (!positional) return {};
+        uint32_t term_id = lexicon.get_term_id(term);
+        if (term_id == FrontCodeLexicon::NOT_FOUND) return {};
+        return position_list(term_id);
+    }
+    
+    PositionListView position_list(uint32_t term_id) const {
+        if (!positional) return {};
+        size_t offset = offset_of(positions_offsets, term_id);
+        size_t list_offset = offset_of(doclist_offsets, term_id);
+        if (offset == NO_LIST || list_offset == NO_LIST) {
             return {};
         }
+        return positions_at(offset, list_at(list_offset));
+    }
+    
+    // Diccionario de expansión (prefijos, sufijos, distancia de edición).
+    // La primera llamada tras cambiar el léxico lo reconstruye: no llamarla
+    // desde varios hilos mientras se agregan documentos.
+    const TermDictionary& term_dictionary() const {
+        if (!dictionary_built || dictionary_terms != lexicon.size()) {
+            std::vector<std::pair<std::string, uint32_t>> entries;
+            entries.reserve(lexicon.size());
+            lexicon.for_each_term([&entries](const std::string& term, uint32_t id) {
+                entries.emplace_back(term, id);
+            });
+            dictionary.build(std::move(entries));
+            dictionary_terms = lexicon.size();
+            dictionary_built = true;
+        }
+        return dictionary;
+    }
+    
+    std::vector<uint32_t> search(const std::string& term) const {
+        Metrics::Timer timer(search_latency);
+        if (!cache) return posting_list(term).decode();
+        return *lookup_docs(term);
+    }
+    
+    // Docs de un término sin copiarlos si están en la caché; vacío si no existe
+    SearchCache::DocsPointer lookup(const std::string& term) const {
+        Metrics::Timer timer(search_latency);
+        return lookup_docs(term);
+    }
+    
+    // Cantidad de términos distintos (sus IDs son 0..term_count()-1)
+    uint32_t term_count() const { return lexicon.size(); }
+    
+    // Términos en orden alfabético con su ID (ver FrontCodeLexicon::Cursor);
+    // los agregados desde el último flush_lexicon() no aparecen
+    FrontCodeLexicon::Cursor term_cursor() const { return FrontCodeLexicon::Cursor(lexicon); }
+    
+    // Pasa los términos agregados en memoria a los bloques del léxico
+    void flush_lexicon() { lexicon.freeze(); }
+    
+    // Llama a callback(doc_id, longitud) por cada documento de longitud conocida
+    template <typename Callback>
+    void for_each_doc_length(Callback&& callback) const {
+        for (size_t doc = 0; doc < doc_lengths.size(); ++doc) {
+            if (doc_lengths[doc] > 0) callback(static_cast<uint32_t>(doc), doc_lengths[doc]);
+        }
+    }
+    
+    // Cantidad de documentos con longitud conocida y su longitud promedio
+    uint32_t doc_count() const { return num_docs; }
+    double avg_doc_length() const {
+        return num_docs == 0 ? 0.0 : static_cast<double>(total_doc_length) / num_docs;
+    }
+    uint32_t doc_length(uint32_t doc_id) const {
+        return doc_id < doc_lengths.size() ? doc_lengths[doc_id] : 0;
+    }
+
+    // Inserta directamente la lista de un término (usado al importar índices).
+    // 'tfs' vacío equivale a tf = 1. Un índice posicional exige 'positions'
+    // (las de cada doc, concatenadas).
+    void add_term_postings(const std::string& term, const std::vector<uint32_t>& docs,
+                           const std::vector<uint32_t>& tfs = {},
+                           const std::vector<uint32_t>& positions = {}) {
+        update_doclist(lexicon.add_term(term), docs, tfs, positions);
+    }
+    
+    // Registra la longitud de un documento indexado con add_term_postings
+    void add_document_length(uint32_t doc_id, uint32_t length) {
+        set_doc_length(doc_id, length);
+    }
+    
+    // Bytes de los blobs de listas y posiciones, y cuántos de ellos quedaron
+    // sin uso por listas reemplazadas
+    size_t storage_bytes() const { return concatenated_doc_ids.size() + concatenated_positions.size(); }
+    uint64_t garbage_bytes() const { return garbage; }
+    
+    // Términos, postings y bytes del índice (recorre la cabecera de cada lista)
+    IndexStatistics statistics() const {
+        IndexStatistics out;
+        out.terms = lexicon.size();
+        for (size_t id = 0; id < doclist_offsets.size(); ++id) {
+            if (doclist_offsets[id] != NO_LIST) out.postings += list_at(doclist_offsets[id]).count;
+        }
+        out.doclist_bytes = concatenated_doc_ids.size();
+        out.position_bytes = concatenated_positions.size();
+        out.garbage_bytes = garbage;
+        return out;
+    }
+    
+    // Reescribe todas las listas una tras otra en blobs nuevos, en orden de ID;
+    // las listas por trozos vuelven al formato contiguo. Los bloques se copian
+    // sin decodificar. Devuelve los bytes recuperados.
+    size_t compact() {
+        size_t before = storage_bytes();
+        std::string doc_bytes, position_bytes;
+        std::vector<size_t> doc_table(doclist_offsets.size(), NO_LIST);
+        std::vector<size_t> position_table(positions_offsets.size(), NO_LIST);
+        
+        for (uint32_t id = 0; id < doclist_offsets.size(); ++id) {
+            if (doclist_offsets[id] == NO_LIST) continue;
+            PostingListView list = list_at(doclist_offsets[id]);
+            doc_table[id] = doc_bytes.size();
+            list.write_compact(doc_bytes);
+            
+            size_t positions_offset = offset_of(positions_offsets, id);
+            if (positional && positions_offset != NO_LIST) {
+                position_table[id] = position_bytes.size();
+                positions_at(positions_offset, list).write_compact(position_bytes);
+            }
+        }
         
-        std::string encoded = concatenated_doc_ids.substr(it->second);
-        return GammaEncoder::decode(encoded);
+        concatenated_doc_ids.reset().swap(doc_bytes);
+        concatenated_positions.reset().swap(position_bytes);
+        doclist_offsets.reset().swap(doc_table);
+        positions_offsets.reset().swap(position_table);
+        garbage = 0;
+        return before - storage_bytes();
     }
     
     void save_to_files(const std::string& lexicon_file, const std::string& docids_file) const {
         lexicon.save_to_file(lexicon_file);
         
-        std::ofstream out(docids_file, std::ios::binary);
-        
-        size_t concat_size = concatenated_doc_ids.size();
-        out.write(reinterpret_cast<const char*>(&concat_size), sizeof(concat_size));
-        out.write(concatenated_doc_ids.data(), concat_size);
-        
-        size_t map_size = term_offset_to_doclist_offset.size();
-        out.write(reinterpret_cast<const char*>(&map_size), sizeof(map_size));
-        
-        for (const auto& entry : term_offset_to_doclist_offset) {
-            out.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
-            out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
-        }
+        DocidsHeader header{};
+        header.magic = DOCIDS_MAGIC;
+        header.version = DOCIDS_VERSION;
+        header.codec = static_cast<uint32_t>(codec);
+        header.flags = positional ? 1 : 0;
+        header.total_doc_length = total_doc_length;
+        header.num_docs = num_docs;
+        header.garbage = garbage;
+        replace_file(docids_file, [&](std::ofstream& out) {
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            header.doclists = write_section(out, concatenated_doc_ids.data(), concatenated_doc_ids.size());
+            header.doclist_offsets = write_section(out, doclist_offsets.data(),
+                                                   doclist_offsets.size() * sizeof(size_t));
+            header.doc_lengths = write_section(out, doc_lengths.data(), doc_lengths.size() * sizeof(uint32_t));
+            if (positional) {
+                header.positions = write_section(out, concatenated_positions.data(), concatenated_positions.size());
+                header.positions_offsets = write_section(out, positions_offsets.data(),
+                                                         positions_offsets.size() * sizeof(size_t));
+            }
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        });
     }
     
+    // Un archivo de la versión actual se mapea y se consulta en su lugar: abrir
+    // cuesta lo mismo con cualquier tamaño y las páginas se leen al usarlas.
+    // El formato original se convierte a memoria propia. Todo se carga en un
+    // índice aparte y se instala al final: si algo falla, este queda como estaba.
     void load_from_files(const std::string& lexicon_file, const std::string& docids_file) {
-        lexicon.load_from_file(lexicon_file);
-        
         std::ifstream in(docids_file, std::ios::binary);
         if (!in) return;
         
-        size_t concat_size;
-        in.read(reinterpret_cast<char*>(&concat_size), sizeof(concat_size));
-        concatenated_doc_ids.resize(concat_size);
-        in.read(&concatenated_doc_ids[0], concat_size);
+        InvertedIndex loaded(codec);
+        // El formato original indexa las listas por el offset del término en el
+        // léxico de entonces; el léxico da su traducción a IDs
+        std::unordered_map<size_t, uint32_t> legacy_ids;
+        loaded.lexicon.load_from_file(lexicon_file, &legacy_ids);
         
-        size_t map_size;
-        in.read(reinterpret_cast<char*>(&map_size), sizeof(map_size));
+        // El formato original empieza directamente con el tamaño del blob
+        uint32_t magic = 0, version = 0;
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (magic == DOCIDS_MAGIC) {
+            if (version != DOCIDS_VERSION) {
+                throw std::runtime_error("Versión de docids no soportada: " + std::to_string(version));
+            }
+            in.close();
+            loaded.map_docids(docids_file);
+        } else {
+            in.seekg(0);
+            read_blob(in, loaded.concatenated_doc_ids);
+            read_legacy_offsets(in, legacy_ids, loaded.doclist_offsets);
+            loaded.convert_legacy_doclists();
+        }
+        install(loaded);
+    }
+    
+    // Importa el volcado binario crudo de la versión anterior (invertedIndex.dat):
+    // por término [size_t len][term][size_t n][int32 doc_id x n]
+    void import_raw_index(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("No se pudo abrir el archivo: " + filename);
+        }
         
-        term_offset_to_doclist_offset.clear();
-        for (size_t i = 0; i < map_size; ++i) {
-            size_t term_offset, doclist_offset;
-            in.read(reinterpret_cast<char*>(&term_offset), sizeof(term_offset));
-            in.read(reinterpret_cast<char*>(&doclist_offset), sizeof(doclist_offset));
+        size_t term_size;
+        while (in.read(reinterpret_cast<char*>(&term_size), sizeof(term_size))) {
+            std::string term(term_size, '\0');
+            in.read(&term[0], term_size);
+            
+            size_t doc_count;
+            in.read(reinterpret_cast<char*>(&doc_count), sizeof(doc_count));
+            std::vector<int32_t> raw(doc_count);
+            in.read(reinterpret_cast<char*>(raw.data()), doc_count * sizeof(int32_t));
+            if (!in) {
+                throw std::runtime_error("Archivo truncado: " + filename);
+            }
             
-            term_offset_to_doclist_offset[term_offset] = doclist_offset;
+            std::vector<uint32_t> docs(raw.begin(), raw.end());
+            std::sort(docs.begin(), docs.end());
+            add_term_postings(term, docs);
         }
     }
 };
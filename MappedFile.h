@@ -0,0 +1,169 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <cstdio>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Tramo de un archivo con secciones: desplazamiento desde el inicio y bytes
+struct FileSection {
+    uint64_t offset = 0;
+    uint64_t bytes = 0;
+};
+
+// Las secciones empiezan en múltiplos de una línea de caché, así que se pueden
+// usar en su lugar como arreglos de cualquier tipo básico
+constexpr size_t SECTION_ALIGN = 64;
+
+// Escribe 'bytes' en 'out' rellenando antes con ceros hasta SECTION_ALIGN
+inline FileSection write_section(std::ofstream& out, const void* data, size_t bytes) {
+    static const char zeros[SECTION_ALIGN] = {};
+    uint64_t pos = static_cast<uint64_t>(out.tellp());
+    uint64_t aligned = (pos + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+    out.write(zeros, static_cast<std::streamsize>(aligned - pos));
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    return {aligned, bytes};
+}
+
+// Escribe el archivo completo con write(out) en un temporal y lo renombra sobre
+// 'path'. Quien tenga mapeada la versión anterior la sigue viendo entera (el
+// inodo viejo vive hasta el munmap), incluso si es el mismo índice que guarda.
+template <typename Writer>
+void replace_file(const std::string& path, Writer&& write) {
+    std::string tmp = path + ".tmp";
+    bool ok;
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        write(out);
+        out.flush();
+        ok = static_cast<bool>(out);
+    }
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("No se pudo escribir el archivo: " + path);
+    }
+}
+
+// Archivo mapeado en memoria de solo lectura. Las páginas se cargan al tocarlas
+// y se comparten por el page cache entre todos los que mapean el mismo archivo.
+class MappedFile {
+public:
+    enum class Access { Normal, Random, Sequential, WillNeed };
+
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("No se pudo abrir el archivo: " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("No se pudo leer el tamaño de: " + path);
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void* p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("No se pudo mapear el archivo: " + path);
+            }
+            base = static_cast<const char*>(p);
+        }
+        // El mapeo sigue siendo válido después de cerrar el descriptor
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (base) ::munmap(const_cast<char*>(base), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+    // Sugerencia al kernel sobre cómo se va a leer el tramo (se extiende a páginas)
+    void advise(const FileSection& section, Access access) const {
+        if (!base || section.bytes == 0) return;
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t begin = section.offset / page * page;
+        size_t end = std::min<size_t>(section.offset + section.bytes, length);
+        int advice = access == Access::Random       ? MADV_RANDOM
+                     : access == Access::Sequential ? MADV_SEQUENTIAL
+                     : access == Access::WillNeed   ? MADV_WILLNEED
+                                                    : MADV_NORMAL;
+        ::madvise(const_cast<char*>(base) + begin, end - begin, advice);
+    }
+
+    // Sección como arreglo de T, validando límites y alineación
+    template <typename T>
+    const T* section(const FileSection& s) const {
+        if (s.offset > length || s.bytes > length - s.offset || s.bytes % sizeof(T) != 0 ||
+            s.offset % alignof(T) != 0) {
+            throw std::runtime_error("Sección fuera del archivo o desalineada");
+        }
+        return reinterpret_cast<const T*>(base + s.offset);
+    }
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+};
+
+// Arreglo de solo lectura que vive en memoria propia o dentro de un archivo
+// mapeado. Al modificarlo por primera vez se copia a memoria propia
+// (copy-on-write); quien lo usa mantiene vivo el MappedFile mientras tanto.
+template <typename T, typename Container = std::vector<T>>
+class MappedArray {
+public:
+    const T* data() const { return is_mapped ? mapped : owned.data(); }
+    size_t size() const { return is_mapped ? mapped_size : owned.size(); }
+    bool empty() const { return size() == 0; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    bool mapped_from_file() const { return is_mapped; }
+
+    // Contenedor propio para modificar, copiando antes el contenido mapeado
+    Container& mutate() {
+        if (is_mapped) {
+            owned.assign(mapped, mapped + mapped_size);
+            unmap();
+        }
+        return owned;
+    }
+
+    // Contenedor propio vacío, descartando el contenido actual
+    Container& reset() {
+        unmap();
+        owned.clear();
+        return owned;
+    }
+
+    void map(const T* data, size_t count) {
+        Container().swap(owned);
+        mapped = data;
+        mapped_size = count;
+        is_mapped = true;
+    }
+
+private:
+    Container owned;
+    const T* mapped = nullptr;
+    size_t mapped_size = 0;
+    bool is_mapped = false;
+
+    void unmap() {
+        mapped = nullptr;
+        mapped_size = 0;
+        is_mapped = false;
+    }
+};
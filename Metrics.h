@@ -0,0 +1,454 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Tiempo de CPU y memoria del proceso. Está siempre disponible, aun con las
+// métricas desactivadas, porque IndexPipeline lo usa para sus estadísticas.
+struct ResourceUsage {
+    // Segundos de CPU del hilo que llama
+    static double thread_cpu_seconds() { return clock_seconds(CLOCK_THREAD_CPUTIME_ID); }
+
+    // Segundos de CPU de todos los hilos del proceso
+    static double process_cpu_seconds() { return clock_seconds(CLOCK_PROCESS_CPUTIME_ID); }
+
+    // Máximo de memoria residente desde que arrancó el proceso
+    static uint64_t peak_rss_bytes() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+        return static_cast<uint64_t>(usage.ru_maxrss) << 10; // Linux lo da en KB
+    }
+
+    // Memoria residente ahora (0 si no hay /proc)
+    static uint64_t rss_bytes() {
+        std::FILE* file = std::fopen("/proc/self/statm", "r");
+        if (!file) return 0;
+        unsigned long long size = 0, resident = 0;
+        int read = std::fscanf(file, "%llu %llu", &size, &resident);
+        std::fclose(file);
+        return read == 2 ? resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+    }
+
+private:
+    static double clock_seconds(clockid_t clock) {
+        struct timespec now;
+        if (clock_gettime(clock, &now) != 0) return 0;
+        return now.tv_sec + now.tv_nsec * 1e-9;
+    }
+};
+
+// Resumen de un índice para las métricas: términos, postings, bytes de las
+// listas y de las posiciones, y bytes de los blobs que ya no usa ninguna
+// lista (ver InvertedIndex::compact)
+struct IndexStatistics {
+    uint64_t terms = 0;
+    uint64_t postings = 0;
+    uint64_t doclist_bytes = 0;
+    uint64_t position_bytes = 0;
+    uint64_t garbage_bytes = 0;
+};
+
+// Un hilo de una etapa: segundos trabajando, esperando a otra etapa y de CPU,
+// y lo que procesó (bytes o tokens, según la etapa)
+struct ThreadMetrics {
+    double busy = 0;
+    double wait = 0;
+    double cpu = 0;
+    uint64_t items = 0;
+};
+
+// Una etapa medida; las mediciones con el mismo nombre se suman
+struct StageMetrics {
+    uint64_t calls = 0;
+    double wall = 0;
+    double cpu = 0;
+    uint64_t bytes = 0;
+    uint64_t items = 0;
+    uint64_t rss_after = 0;
+    std::vector<ThreadMetrics> threads;
+};
+
+// Con -DNO_METRICS las clases de abajo quedan vacías: los temporizadores no
+// leen el reloj, los histogramas no cuentan y Metrics no escribe nada, así que
+// el compilador elimina toda la instrumentación.
+#ifndef NO_METRICS
+
+// Histograma de latencias con cubetas fijas: la cubeta i cuenta lo que tardó
+// hasta 2^(i/2) µs, de 1 µs a ~46 s, más una final para lo que exceda. Los
+// contadores son atómicos para que registren varios hilos sin lock; los
+// percentiles se estiman con el límite superior de su cubeta.
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 52;
+
+    void record(double seconds) {
+        double micros = seconds * 1e6;
+        size_t bucket = micros <= 1 ? 0 : static_cast<size_t>(std::ceil(2 * std::log2(micros)));
+        if (bucket > BUCKETS) bucket = BUCKETS;
+        counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        uint64_t nanos = static_cast<uint64_t>(seconds * 1e9);
+        total_nanos.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t previous = max_nanos.load(std::memory_order_relaxed);
+        while (nanos > previous && !max_nanos.compare_exchange_weak(previous, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Límite superior de la cubeta i en segundos (infinito para la última)
+    static double upper_bound(size_t bucket) {
+        return bucket >= BUCKETS ? INFINITY : std::exp2(bucket / 2.0) * 1e-6;
+    }
+
+    uint64_t bucket_count(size_t bucket) const { return counts[bucket].load(std::memory_order_relaxed); }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (size_t b = 0; b <= BUCKETS; ++b) total += bucket_count(b);
+        return total;
+    }
+
+    double sum() const { return total_nanos.load(std::memory_order_relaxed) * 1e-9; }
+    double max() const { return max_nanos.load(std::memory_order_relaxed) * 1e-9; }
+
+    // Cota superior del percentil q (0..1); el máximo si cae en la última cubeta
+    double quantile(double q) const {
+        uint64_t total = count();
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            seen += bucket_count(b);
+            if (seen >= rank && seen > 0) return std::min(upper_bound(b), max());
+        }
+        return max();
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS + 1] = {};
+    std::atomic<uint64_t> total_nanos{0};
+    std::atomic<uint64_t> max_nanos{0};
+};
+
+// Registro de métricas de un programa: etapas (reloj, CPU, bytes e ítems por
+// segundo y reparto entre hilos), valores sueltos e histogramas de latencia.
+// Se exporta como JSON o como texto de Prometheus. Registrar una etapa o un
+// valor toma un mutex, así que va por etapa y no por ítem; los histogramas se
+// piden una vez por nombre y después se actualizan sin lock.
+class Metrics {
+public:
+    static constexpr bool enabled = true;
+
+    enum class Format { Json, Prometheus };
+
+    // Mide una etapa desde su construcción hasta finish() o su destrucción
+    class Stage {
+    public:
+        Stage(Metrics* metrics, std::string name) : metrics(metrics), name(std::move(name)) {
+            if (!metrics) return;
+            start = std::chrono::steady_clock::now();
+            cpu_start = ResourceUsage::process_cpu_seconds();
+        }
+
+        ~Stage() { finish(); }
+
+        Stage(const Stage&) = delete;
+        Stage& operator=(const Stage&) = delete;
+
+        void add_bytes(uint64_t bytes) { record.bytes += bytes; }
+        void add_items(uint64_t items) { record.items += items; }
+        void add_thread(const ThreadMetrics& thread) { record.threads.push_back(thread); }
+
+        void finish() {
+            if (!metrics) return;
+            record.calls = 1;
+            record.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            record.cpu = ResourceUsage::process_cpu_seconds() - cpu_start;
+            metrics->add_stage(name, record);
+            metrics = nullptr;
+        }
+
+    private:
+        Metrics* metrics;
+        std::string name;
+        StageMetrics record;
+        std::chrono::steady_clock::time_point start;
+        double cpu_start = 0;
+    };
+
+    // Registra en 'histogram' (si no es nulo) lo que vive el objeto
+    class Timer {
+    public:
+        explicit Timer(LatencyHistogram* histogram) : histogram(histogram) {
+            if (histogram) start = std::chrono::steady_clock::now();
+        }
+
+        ~Timer() {
+            if (histogram) histogram->record(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        LatencyHistogram* histogram;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    Metrics() : created(std::chrono::steady_clock::now()) {}
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // Suma una etapa medida afuera (por ejemplo, las de IndexPipeline)
+    void add_stage(const std::string& name, const StageMetrics& record) {
+        uint64_t rss = ResourceUsage::rss_bytes();
+        std::lock_guard<std::mutex> lock(mutex);
+        StageMetrics& stage = stage_entry(name);
+        stage.calls += record.calls;
+        stage.wall += record.wall;
+        stage.cpu += record.cpu;
+        stage.bytes += record.bytes;
+        stage.items += record.items;
+        stage.rss_after = rss;
+        if (stage.threads.size() < record.threads.size()) stage.threads.resize(record.threads.size());
+        for (size_t t = 0; t < record.threads.size(); ++t) {
+            stage.threads[t].busy += record.threads[t].busy;
+            stage.threads[t].wait += record.threads[t].wait;
+            stage.threads[t].cpu += record.threads[t].cpu;
+            stage.threads[t].items += record.threads[t].items;
+        }
+    }
+
+    void set(const std::string& name, double value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        gauges[name] = value;
+    }
+
+    void record_index(const IndexStatistics& index) {
+        set("terms", static_cast<double>(index.terms));
+        set("postings", static_cast<double>(index.postings));
+        set("doclist_bytes", static_cast<double>(index.doclist_bytes));
+        set("position_bytes", static_cast<double>(index.position_bytes));
+        set("garbage_bytes", static_cast<double>(index.garbage_bytes));
+        set("bytes_per_posting", index.postings == 0 ? 0.0 : static_cast<double>(index.doclist_bytes) / index.postings);
+    }
+
+    // El histograma 'name', creado al pedirlo por primera vez; la referencia
+    // vale mientras viva el registro
+    LatencyHistogram& histogram(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& slot = histograms[name];
+        if (!slot) slot = std::make_unique<LatencyHistogram>();
+        return *slot;
+    }
+
+    void write_json(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        PrecisionGuard precision(out);
+        out << "{\n  \"process\": {\"wall_seconds\": " << elapsed()
+            << ", \"cpu_seconds\": " << ResourceUsage::process_cpu_seconds()
+            << ", \"rss_bytes\": " << ResourceUsage::rss_bytes()
+            << ", \"peak_rss_bytes\": " << ResourceUsage::peak_rss_bytes() << "},\n  \"stages\": [";
+        for (size_t s = 0; s < order.size(); ++s) {
+            const StageMetrics& stage = stages.at(order[s]);
+            out << (s ? "," : "") << "\n    {\"name\": \"" << order[s] << "\", \"calls\": " << stage.calls
+                << ", \"wall_seconds\": " << stage.wall << ", \"cpu_seconds\": " << stage.cpu
+                << ", \"bytes\": " << stage.bytes << ", \"bytes_per_second\": " << per_second(stage.bytes, stage.wall)
+                << ", \"items\": " << stage.items << ", \"items_per_second\": " << per_second(stage.items, stage.wall)
+                << ", \"rss_after_bytes\": " << stage.rss_after;
+            if (!stage.threads.empty()) {
+                out << ", \"imbalance\": " << imbalance(stage) << ", \"threads\": [";
+                for (size_t t = 0; t < stage.threads.size(); ++t) {
+                    const ThreadMetrics& thread = stage.threads[t];
+                    out << (t ? ", " : "") << "{\"busy_seconds\": " << thread.busy << ", \"wait_seconds\": "
+                        << thread.wait << ", \"cpu_seconds\": " << thread.cpu << ", \"items\": " << thread.items << "}";
+                }
+                out << "]";
+            }
+            out << "}";
+        }
+        out << "\n  ],\n  \"values\": {";
+        bool first = true;
+        for (const auto& gauge : gauges) {
+            out << (first ? "" : ",") << "\n    \"" << gauge.first << "\": " << gauge.second;
+            first = false;
+        }
+        out << "\n  },\n  \"histograms\": {";
+        first = true;
+        for (const auto& entry : histograms) {
+            const LatencyHistogram& histogram = *entry.second;
+            out << (first ? "" : ",") << "\n    \"" << entry.first << "\": {\"count\": " << histogram.count()
+                << ", \"sum_seconds\": " << histogram.sum() << ", \"p50\": " << histogram.quantile(0.5)
+                << ", \"p90\": " << histogram.quantile(0.9) << ", \"p99\": " << histogram.quantile(0.99)
+                << ", \"max\": " << histogram.max() << "}";
+            first = false;
+        }
+        out << "\n  }\n}\n";
+    }
+
+    // Formato de exposición de texto de Prometheus; todo lleva el prefijo index_
+    void write_prometheus(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        PrecisionGuard precision(out);
+        out << "# TYPE index_process_cpu_seconds gauge\nindex_process_cpu_seconds "
+            << ResourceUsage::process_cpu_seconds() << "\n";
+        out << "# TYPE index_process_wall_seconds gauge\nindex_process_wall_seconds " << elapsed() << "\n";
+        out << "# TYPE index_process_rss_bytes gauge\nindex_process_rss_bytes " << ResourceUsage::rss_bytes() << "\n";
+        out << "# TYPE index_process_peak_rss_bytes gauge\nindex_process_peak_rss_bytes "
+            << ResourceUsage::peak_rss_bytes() << "\n";
+
+        auto stage_series = [&](const char* metric, auto value) {
+            out << "# TYPE index_stage_" << metric << " gauge\n";
+            for (const std::string& name : order) {
+                out << "index_stage_" << metric << "{stage=\"" << name << "\"} " << value(stages.at(name)) << "\n";
+            }
+        };
+        stage_series("calls", [](const StageMetrics& s) { return s.calls; });
+        stage_series("wall_seconds", [](const StageMetrics& s) { return s.wall; });
+        stage_series("cpu_seconds", [](const StageMetrics& s) { return s.cpu; });
+        stage_series("bytes", [](const StageMetrics& s) { return s.bytes; });
+        stage_series("items", [](const StageMetrics& s) { return s.items; });
+        stage_series("rss_after_bytes", [](const StageMetrics& s) { return s.rss_after; });
+
+        auto thread_series = [&](const char* metric, auto value) {
+            out << "# TYPE index_stage_thread_" << metric << " gauge\n";
+            for (const std::string& name : order) {
+                const StageMetrics& stage = stages.at(name);
+                for (size_t t = 0; t < stage.threads.size(); ++t) {
+                    out << "index_stage_thread_" << metric << "{stage=\"" << name << "\",thread=\"" << t << "\"} "
+                        << value(stage.threads[t]) << "\n";
+                }
+            }
+        };
+        thread_series("busy_seconds", [](const ThreadMetrics& t) { return t.busy; });
+        thread_series("wait_seconds", [](const ThreadMetrics& t) { return t.wait; });
+        thread_series("cpu_seconds", [](const ThreadMetrics& t) { return t.cpu; });
+        thread_series("items", [](const ThreadMetrics& t) { return t.items; });
+
+        for (const auto& gauge : gauges) {
+            out << "# TYPE index_" << gauge.first << " gauge\nindex_" << gauge.first << " " << gauge.second << "\n";
+        }
+
+        for (const auto& entry : histograms) {
+            const LatencyHistogram& histogram = *entry.second;
+            std::string name = "index_" + entry.first + "_seconds";
+            out << "# TYPE " << name << " histogram\n";
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b <= LatencyHistogram::BUCKETS; ++b) {
+                cumulative += histogram.bucket_count(b);
+                out << name << "_bucket{le=\"";
+                if (b == LatencyHistogram::BUCKETS) out << "+Inf";
+                else out << LatencyHistogram::upper_bound(b);
+                out << "\"} " << cumulative << "\n";
+            }
+            out << name << "_sum " << histogram.sum() << "\n" << name << "_count " << cumulative << "\n";
+        }
+    }
+
+    void save(const std::string& filename, Format format) const {
+        std::ofstream out(filename, std::ios::trunc);
+        if (!out) throw std::runtime_error("No se pudo escribir el archivo: " + filename);
+        if (format == Format::Json) write_json(out);
+        else write_prometheus(out);
+        if (!out) throw std::runtime_error("No se pudo escribir el archivo: " + filename);
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::chrono::steady_clock::time_point created;
+    std::map<std::string, StageMetrics> stages;
+    std::vector<std::string> order; // etapas en el orden en que aparecieron
+    std::map<std::string, double> gauges;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+
+    // Suficientes dígitos para que los contadores grandes salgan enteros
+    struct PrecisionGuard {
+        std::ostream& out;
+        std::streamsize saved;
+        explicit PrecisionGuard(std::ostream& out) : out(out), saved(out.precision(15)) {}
+        ~PrecisionGuard() { out.precision(saved); }
+    };
+
+    StageMetrics& stage_entry(const std::string& name) {
+        auto it = stages.find(name);
+        if (it != stages.end()) return it->second;
+        order.push_back(name);
+        return stages[name];
+    }
+
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - created).count();
+    }
+
+    static double per_second(uint64_t count, double seconds) { return seconds > 0 ? count / seconds : 0.0; }
+
+    // Hilo más ocupado sobre el promedio (1 = reparto parejo); por ítems si
+    // la etapa no midió el tiempo de cada hilo
+    static double imbalance(const StageMetrics& stage) {
+        bool timed = false;
+        for (const ThreadMetrics& thread : stage.threads) timed |= thread.busy > 0;
+        double most = 0, total = 0;
+        for (const ThreadMetrics& thread : stage.threads) {
+            double load = timed ? thread.busy : static_cast<double>(thread.items);
+            most = std::max(most, load);
+            total += load;
+        }
+        return total > 0 ? most * stage.threads.size() / total : 1.0;
+    }
+};
+
+#else
+
+class LatencyHistogram {
+public:
+    void record(double) {}
+};
+
+class Metrics {
+public:
+    static constexpr bool enabled = false;
+
+    enum class Format { Json, Prometheus };
+
+    class Stage {
+    public:
+        Stage(Metrics*, const char*) {}
+        Stage(Metrics*, const std::string&) {}
+        void add_bytes(uint64_t) {}
+        void add_items(uint64_t) {}
+        void add_thread(const ThreadMetrics&) {}
+        void finish() {}
+    };
+
+    class Timer {
+    public:
+        explicit Timer(LatencyHistogram*) {}
+    };
+
+    void add_stage(const std::string&, const StageMetrics&) {}
+    void set(const std::string&, double) {}
+    void record_index(const IndexStatistics&) {}
+    LatencyHistogram& histogram(const std::string&) { return none; }
+    void write_json(std::ostream&) const {}
+    void write_prometheus(std::ostream&) const {}
+    void save(const std::string&, Format) const {}
+
+private:
+    LatencyHistogram none;
+};
+
+#endif
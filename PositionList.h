@@ -0,0 +1,238 @@
+#pragma once
+#include "PostingCodecs.h"
+#include "PostingList.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+// Posiciones de un término, en un blob aparte del de doc IDs para que las
+// consultas sin frase no las lean nunca. Van alineadas con los bloques de la
+// lista de postings del mismo término:
+//   [varint bytes del cuerpo][cuerpo]
+//   cuerpo = [offset u32 por bloque si hay más de uno][posiciones de cada bloque]
+// Las posiciones de un bloque se codifican juntas con el códec del índice: cada
+// doc aporta tf valores g (la primera posición y luego hueco - 1 con la anterior)
+// y se escribe la secuencia estrictamente creciente s_k = s_(k-1) + g_k + 1.
+// La cantidad de posiciones de cada doc es su tf, que está en la lista de postings.
+// Si la lista de postings va por trozos, sus posiciones también:
+//   [uint64 capacity][PositionChunk x capacity], una entrada por bloque.
+struct PositionChunk {
+    int64_t offset; // del bloque, relativo a la primera entrada (puede ser negativo)
+    uint64_t bytes;
+};
+
+struct PositionListView {
+    const char* data = nullptr; // cuerpo, o el directorio si 'chunked'
+    size_t size = 0;
+    size_t nblocks = 0;
+    CodecType codec = CodecType::Gamma;
+    bool chunked = false;
+
+    bool empty() const { return nblocks == 0; }
+
+    const char* blocks() const { return nblocks > 1 ? data + nblocks * sizeof(uint32_t) : data; }
+    size_t blocks_size() const { return size - (blocks() - data); }
+
+    uint32_t block_offset(size_t block) const {
+        if (nblocks == 1) return 0;
+        uint32_t offset;
+        std::memcpy(&offset, data + block * sizeof(uint32_t), sizeof(offset));
+        return offset;
+    }
+
+    PositionChunk chunk_entry(size_t block) const {
+        PositionChunk entry;
+        std::memcpy(&entry, data + block * sizeof(PositionChunk), sizeof(entry));
+        return entry;
+    }
+
+    // Rango de bytes [begin, end) del bloque
+    void block_bytes(size_t block, const char*& begin, const char*& end) const {
+        if (chunked) {
+            PositionChunk entry = chunk_entry(block);
+            begin = data + entry.offset;
+            end = begin + entry.bytes;
+            return;
+        }
+        size_t from = block_offset(block);
+        size_t to = block + 1 < nblocks ? block_offset(block + 1) : blocks_size();
+        if (from > to || to > blocks_size()) {
+            throw std::runtime_error("Tabla de posiciones corrupta");
+        }
+        begin = blocks() + from;
+        end = blocks() + to;
+    }
+
+    // Decodifica las posiciones del bloque en 'positions', concatenadas por doc
+    // en el orden de la lista; 'tfs' son las frecuencias de sus 'n' postings
+    void decode_block(size_t block, const uint32_t* tfs, size_t n, std::vector<uint32_t>& positions) const {
+        const char *begin, *end;
+        block_bytes(block, begin, end);
+
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i) total += tfs[i];
+        positions.resize(total);
+        PostingCodec::decode(codec, begin, end - begin, total, positions.data());
+
+        uint32_t prev_seq = 0;
+        size_t k = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t pos = 0;
+            for (uint32_t j = 0; j < tfs[i]; ++j, ++k) {
+                uint32_t seq = positions[k];
+                uint32_t gap = (k == 0) ? seq : seq - prev_seq - 1;
+                prev_seq = seq;
+                pos = (j == 0) ? gap : pos + gap + 1;
+                positions[k] = pos;
+            }
+        }
+    }
+
+    static PositionListView parse(const char* p, const char* end, CodecType codec, size_t nblocks,
+                                  size_t* total_size = nullptr) {
+        const char* begin = p;
+        uint64_t body_size;
+        if (!read_varint(p, end, body_size) || body_size > static_cast<uint64_t>(end - p)) {
+            throw std::runtime_error("Cabecera de lista de posiciones corrupta");
+        }
+
+        PositionListView view;
+        view.data = p;
+        view.size = body_size;
+        view.nblocks = nblocks;
+        view.codec = codec;
+        if (nblocks > 1 && nblocks * sizeof(uint32_t) > body_size) {
+            throw std::runtime_error("Tabla de posiciones truncada");
+        }
+        if (total_size) *total_size = (p - begin) + body_size;
+        return view;
+    }
+
+    // Directorio de posiciones por trozos; 'total_size' cuenta solo el directorio
+    static PositionListView parse_chunked(const char* p, const char* end, CodecType codec, size_t nblocks,
+                                          size_t* total_size = nullptr) {
+        uint64_t capacity;
+        if (static_cast<size_t>(end - p) < sizeof(capacity)) {
+            throw std::runtime_error("Directorio de posiciones truncado");
+        }
+        std::memcpy(&capacity, p, sizeof(capacity));
+
+        PositionListView view;
+        view.data = p + sizeof(capacity);
+        view.nblocks = nblocks;
+        view.codec = codec;
+        view.chunked = true;
+        if (capacity < nblocks || capacity > static_cast<uint64_t>(end - view.data) / sizeof(PositionChunk)) {
+            throw std::runtime_error("Directorio de posiciones truncado");
+        }
+        view.size = capacity * sizeof(PositionChunk);
+        if (total_size) *total_size = sizeof(capacity) + view.size;
+        return view;
+    }
+
+    // Codifica las posiciones de un bloque de 'n' postings al final de 'out'.
+    // 'tfs' nulo equivale a tf = 1; 'positions' trae 'available' valores y se
+    // devuelven los usados.
+    static size_t encode_block(CodecType codec, const uint32_t* tfs, size_t n, const uint32_t* positions,
+                               size_t available, std::string& out) {
+        std::vector<uint32_t> seq;
+        uint32_t prev_seq = 0;
+        size_t k = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t tf = tfs ? std::max<uint32_t>(tfs[i], 1) : 1;
+            for (uint32_t j = 0; j < tf; ++j, ++k) {
+                if (k >= available || (j > 0 && positions[k] <= positions[k - 1])) {
+                    throw std::runtime_error("Posiciones inválidas para la lista");
+                }
+                uint32_t gap = (j == 0) ? positions[k] : positions[k] - positions[k - 1] - 1;
+                uint32_t value = seq.empty() ? gap : prev_seq + gap + 1;
+                if (!seq.empty() && value <= prev_seq) {
+                    throw std::runtime_error("Bloque de posiciones demasiado grande");
+                }
+                seq.push_back(value);
+                prev_seq = value;
+            }
+        }
+        PostingCodec::encode(codec, seq.data(), seq.size(), out);
+        return k;
+    }
+
+    // 'tfs' da la cantidad de posiciones de cada posting (vacío = 1) y
+    // 'positions' las posiciones crecientes de cada doc, concatenadas
+    static void encode(CodecType codec, const std::vector<uint32_t>& tfs, size_t count,
+                       const std::vector<uint32_t>& positions, std::string& out) {
+        size_t nblocks = (count + POSTING_BLOCK - 1) / POSTING_BLOCK;
+        std::string offsets;
+        std::string blocks;
+        size_t k = 0;
+
+        for (size_t b = 0; b < nblocks; ++b) {
+            size_t begin = b * POSTING_BLOCK;
+            size_t n = std::min(POSTING_BLOCK, count - begin);
+            uint32_t offset = static_cast<uint32_t>(blocks.size());
+            if (nblocks > 1) offsets.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+            k += encode_block(codec, tfs.empty() ? nullptr : tfs.data() + begin, n, positions.data() + k,
+                              positions.size() - k, blocks);
+        }
+        if (k != positions.size()) {
+            throw std::runtime_error("Posiciones inválidas para la lista");
+        }
+
+        write_varint(out, offsets.size() + blocks.size());
+        out += offsets;
+        out += blocks;
+    }
+
+    // Reescribe las posiciones en formato contiguo (un directorio se junta)
+    void write_compact(std::string& out) const {
+        std::string offsets;
+        std::string body;
+        for (size_t b = 0; b < nblocks; ++b) {
+            const char *begin, *end;
+            block_bytes(b, begin, end);
+            uint32_t offset = static_cast<uint32_t>(body.size());
+            if (nblocks > 1) offsets.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+            body.append(begin, end);
+        }
+        write_varint(out, offsets.size() + body.size());
+        out += offsets;
+        out += body;
+    }
+};
+
+// Lee las posiciones del posting actual de un cursor. Decodifica el bloque de
+// posiciones completo la primera vez que se pide y lo reutiliza mientras el
+// cursor siga en el mismo bloque.
+class PositionReader {
+public:
+    PositionReader() = default;
+    explicit PositionReader(const PositionListView& view) : list(view) {}
+
+    bool empty() const { return list.empty(); }
+
+    // Posiciones crecientes del doc actual de 'cursor'; 'count' es su tf
+    const uint32_t* positions(PostingCursor& cursor, size_t& count) {
+        const uint32_t* tfs = cursor.block_freqs();
+        size_t n = cursor.block_size();
+        if (cursor.block_index() != loaded_block) {
+            list.decode_block(cursor.block_index(), tfs, n, buffer);
+            starts.resize(n + 1);
+            starts[0] = 0;
+            for (size_t i = 0; i < n; ++i) starts[i + 1] = starts[i] + tfs[i];
+            loaded_block = cursor.block_index();
+        }
+        size_t i = cursor.block_pos();
+        count = starts[i + 1] - starts[i];
+        return buffer.data() + starts[i];
+    }
+
+private:
+    PositionListView list;
+    size_t loaded_block = SIZE_MAX;
+    std::vector<uint32_t> buffer;
+    std::vector<uint32_t> starts;
+};
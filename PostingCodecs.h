@@ -0,0 +1,472 @@
+#pragma once
+#include "GammaEncoder.h"
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+// Códecs de listas de postings. Todos reciben doc IDs estrictamente crecientes,
+// codifican los huecos y necesitan conocer la cantidad de valores al decodificar.
+// Las rutas SIMD se activan al compilar con -msse4.1 / -mavx2 (o -march=native).
+enum class CodecType : uint32_t {
+    Gamma = 0,
+    StreamVByte = 1,
+    PForDelta = 2,
+    BP128 = 3
+};
+
+inline const char* codec_name(CodecType type) {
+    switch (type) {
+        case CodecType::Gamma: return "gamma";
+        case CodecType::StreamVByte: return "streamvbyte";
+        case CodecType::PForDelta: return "pfordelta";
+        case CodecType::BP128: return "bp128";
+    }
+    return "desconocido";
+}
+
+inline bool parse_codec(const std::string& name, CodecType& type) {
+    for (CodecType t : {CodecType::Gamma, CodecType::StreamVByte, CodecType::PForDelta, CodecType::BP128}) {
+        if (name == codec_name(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void write_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Avanza 'p'; devuelve false si el varint queda truncado en 'end'
+inline bool read_varint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+namespace codec_detail {
+
+inline unsigned bits_needed(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+// Suma prefija de 4 huecos más el último valor decodificado
+#if defined(__SSE4_1__)
+inline __m128i prefix_sum4(__m128i gaps, __m128i prev) {
+    gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 4));
+    gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 8));
+    return _mm_add_epi32(gaps, _mm_shuffle_epi32(prev, 0xFF));
+}
+#endif
+
+// Huecos por bloque de 128 en disposición vertical (4 carriles de 32 valores),
+// como en SIMD-BP128: la palabra j de los 4 carriles ocupa 16 bytes contiguos.
+constexpr size_t BLOCK = 128;
+
+inline void pack128(const uint32_t* in, unsigned bits, std::string& out) {
+    size_t base = out.size();
+    out.resize(base + bits * 16);
+    if (bits == 0) return;
+
+    uint32_t words[4 * 32] = {0};
+    for (unsigned lane = 0; lane < 4; ++lane) {
+        unsigned word = 0, shift = 0;
+        for (unsigned slot = 0; slot < 32; ++slot) {
+            uint64_t v = in[slot * 4 + lane];
+            words[word * 4 + lane] |= static_cast<uint32_t>(v << shift);
+            if (shift + bits >= 32) {
+                ++word;
+                if (shift + bits > 32) words[word * 4 + lane] |= static_cast<uint32_t>(v >> (32 - shift));
+                shift = shift + bits - 32;
+            } else {
+                shift += bits;
+            }
+        }
+    }
+    std::memcpy(&out[base], words, bits * 16);
+}
+
+#if defined(__SSE4_1__)
+template <unsigned B>
+inline void unpack128_simd(const char* in, uint32_t* out) {
+    if constexpr (B == 0) {
+        std::memset(out, 0, BLOCK * sizeof(uint32_t));
+    } else {
+        const __m128i* src = reinterpret_cast<const __m128i*>(in);
+        const __m128i mask = _mm_set1_epi32(B == 32 ? -1 : int((1u << B) - 1));
+        __m128i word = _mm_loadu_si128(src);
+        unsigned idx = 0, shift = 0;
+
+        for (unsigned slot = 0; slot < 32; ++slot) {
+            __m128i v = _mm_srli_epi32(word, shift);
+            if (shift + B >= 32) {
+                ++idx;
+                if (idx < B) {
+                    word = _mm_loadu_si128(src + idx);
+                    if (shift + B > 32) v = _mm_or_si128(v, _mm_slli_epi32(word, 32 - shift));
+                }
+                shift = shift + B - 32;
+            } else {
+                shift += B;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + slot * 4), _mm_and_si128(v, mask));
+        }
+    }
+}
+
+template <unsigned... Bs>
+constexpr std::array<void (*)(const char*, uint32_t*), sizeof...(Bs)> make_unpackers(std::integer_sequence<unsigned, Bs...>) {
+    return {{&unpack128_simd<Bs>...}};
+}
+#endif
+
+inline void unpack128(const char* in, unsigned bits, uint32_t* out) {
+#if defined(__SSE4_1__)
+    static constexpr auto unpackers = make_unpackers(std::make_integer_sequence<unsigned, 33>{});
+    unpackers[bits](in, out);
+#else
+    uint32_t words[4 * 32];
+    std::memcpy(words, in, bits * 16);
+    const uint32_t mask = bits == 32 ? ~0u : ((1u << bits) - 1);
+    for (unsigned lane = 0; lane < 4; ++lane) {
+        unsigned word = 0, shift = 0;
+        for (unsigned slot = 0; slot < 32; ++slot) {
+            uint64_t v = bits == 0 ? 0 : (words[word * 4 + lane] >> shift);
+            if (bits != 0 && shift + bits >= 32) {
+                ++word;
+                if (shift + bits > 32) v |= uint64_t(words[word * 4 + lane]) << (32 - shift);
+                shift = shift + bits - 32;
+            } else {
+                shift += bits;
+            }
+            out[slot * 4 + lane] = static_cast<uint32_t>(v) & mask;
+        }
+    }
+#endif
+}
+
+// Convierte 128 huecos en doc IDs absolutos partiendo de 'prev'
+inline uint32_t prefix_sum128(uint32_t* values, uint32_t prev) {
+#if defined(__SSE4_1__)
+    __m128i run = _mm_set1_epi32(static_cast<int>(prev));
+    for (size_t i = 0; i < BLOCK; i += 4) {
+        __m128i* p = reinterpret_cast<__m128i*>(values + i);
+        run = prefix_sum4(_mm_loadu_si128(p), run);
+        _mm_storeu_si128(p, run);
+    }
+    return values[BLOCK - 1];
+#else
+    for (size_t i = 0; i < BLOCK; ++i) {
+        prev += values[i];
+        values[i] = prev;
+    }
+    return prev;
+#endif
+}
+
+// Cola de menos de 128 valores: huecos en varint
+inline void encode_tail(const uint32_t* gaps, size_t n, std::string& out) {
+    for (size_t i = 0; i < n; ++i) write_varint(out, gaps[i]);
+}
+
+inline const char* decode_tail(const char* p, const char* end, size_t n, uint32_t prev, uint32_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t gap;
+        if (!read_varint(p, end, gap)) throw std::runtime_error("Lista de postings truncada");
+        prev += static_cast<uint32_t>(gap);
+        out[i] = prev;
+    }
+    return p;
+}
+
+inline std::vector<uint32_t> gaps_of(const uint32_t* docs, size_t n) {
+    std::vector<uint32_t> gaps(n);
+    uint32_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        gaps[i] = docs[i] - prev;
+        prev = docs[i];
+    }
+    return gaps;
+}
+
+} // namespace codec_detail
+
+// Gamma de Elias sobre BitWriter/BitReader (compacto, decodificación con ramas)
+struct GammaCodec {
+    static void encode(const uint32_t* docs, size_t n, std::string& out) {
+        BitWriter writer;
+        GammaEncoder::encode(std::vector<uint32_t>(docs, docs + n), writer);
+        writer.append_to(out);
+    }
+
+    static size_t decode(const char* data, size_t size, size_t n, uint32_t* out) {
+        BitReader reader(data, size);
+        uint64_t prev = 0, value;
+        for (size_t i = 0; i < n; ++i) {
+            if (!GammaEncoder::decode_value(reader, value)) throw std::runtime_error("Lista gamma truncada");
+            prev = (i == 0) ? value - 1 : prev + value;
+            out[i] = static_cast<uint32_t>(prev);
+        }
+        return (reader.position() + 7) / 8;
+    }
+};
+
+// StreamVByte: un byte de control por cada 4 huecos (2 bits = longitud 1..4 bytes),
+// seguido de los bytes de datos. Decodifica con un shuffle por grupo de 4.
+struct StreamVByteCodec {
+    struct Tables {
+        uint8_t length[256];
+        alignas(16) uint8_t shuffle[256][16];
+
+        Tables() {
+            for (unsigned c = 0; c < 256; ++c) {
+                unsigned pos = 0;
+                for (unsigned k = 0; k < 4; ++k) {
+                    unsigned len = ((c >> (2 * k)) & 3) + 1;
+                    for (unsigned b = 0; b < 4; ++b) {
+                        shuffle[c][k * 4 + b] = b < len ? static_cast<uint8_t>(pos + b) : 0xFF;
+                    }
+                    pos += len;
+                }
+                length[c] = static_cast<uint8_t>(pos);
+            }
+        }
+    };
+
+    static const Tables& tables() {
+        static const Tables t;
+        return t;
+    }
+
+    static void encode(const uint32_t* docs, size_t n, std::string& out) {
+        size_t control_bytes = (n + 3) / 4;
+        size_t base = out.size();
+        out.resize(base + control_bytes);
+
+        uint32_t prev = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t gap = docs[i] - prev;
+            prev = docs[i];
+            unsigned len = gap < (1u << 8) ? 1 : gap < (1u << 16) ? 2 : gap < (1u << 24) ? 3 : 4;
+            out[base + i / 4] = static_cast<char>(static_cast<uint8_t>(out[base + i / 4]) | ((len - 1) << (2 * (i % 4))));
+            for (unsigned b = 0; b < len; ++b) out.push_back(static_cast<char>(gap >> (8 * b)));
+        }
+    }
+
+    static size_t decode(const char* data, size_t size, size_t n, uint32_t* out) {
+        const uint8_t* control = reinterpret_cast<const uint8_t*>(data);
+        const uint8_t* p = control + (n + 3) / 4;
+        const uint8_t* end = reinterpret_cast<const uint8_t*>(data) + size;
+        size_t i = 0;
+        uint32_t prev = 0;
+#if defined(__SSE4_1__)
+        const Tables& t = tables();
+#endif
+
+#if defined(__AVX2__)
+        __m256i run = _mm256_setzero_si256();
+        const __m256i last = _mm256_set1_epi32(7);
+        const __m256i third = _mm256_set1_epi32(3);
+        while (i + 8 <= n) {
+            uint8_t c0 = control[i / 4], c1 = control[i / 4 + 1];
+            const uint8_t* p1 = p + t.length[c0];
+            if (p1 + 16 > end) break;
+            __m256i bytes = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)), 1);
+            __m256i shuf = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.shuffle[c0]))),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(t.shuffle[c1])), 1);
+            __m256i gaps = _mm256_shuffle_epi8(bytes, shuf);
+            gaps = _mm256_add_epi32(gaps, _mm256_slli_si256(gaps, 4));
+            gaps = _mm256_add_epi32(gaps, _mm256_slli_si256(gaps, 8));
+            __m256i carry = _mm256_blend_epi32(_mm256_setzero_si256(), _mm256_permutevar8x32_epi32(gaps, third), 0xF0);
+            gaps = _mm256_add_epi32(_mm256_add_epi32(gaps, carry), run);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), gaps);
+            run = _mm256_permutevar8x32_epi32(gaps, last);
+            p = p1 + t.length[c1];
+            i += 8;
+        }
+        if (i > 0) prev = out[i - 1];
+#endif
+
+#if defined(__SSE4_1__)
+        __m128i run4 = _mm_set1_epi32(static_cast<int>(prev));
+        while (i + 4 <= n && p + 16 <= end) {
+            uint8_t c = control[i / 4];
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i gaps = _mm_shuffle_epi8(bytes, _mm_load_si128(reinterpret_cast<const __m128i*>(t.shuffle[c])));
+            run4 = codec_detail::prefix_sum4(gaps, run4);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), run4);
+            p += t.length[c];
+            i += 4;
+        }
+        if (i > 0) prev = out[i - 1];
+#endif
+
+        for (; i < n; ++i) {
+            unsigned len = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+            if (p + len > end) throw std::runtime_error("Lista StreamVByte truncada");
+            uint32_t gap = 0;
+            for (unsigned b = 0; b < len; ++b) gap |= uint32_t(p[b]) << (8 * b);
+            p += len;
+            prev += gap;
+            out[i] = prev;
+        }
+        return p - reinterpret_cast<const uint8_t*>(data);
+    }
+};
+
+// BP128: bloques de 128 huecos empaquetados al ancho de bit máximo del bloque
+struct BP128Codec {
+    static void encode(const uint32_t* docs, size_t n, std::string& out) {
+        using namespace codec_detail;
+        std::vector<uint32_t> gaps = gaps_of(docs, n);
+        size_t i = 0;
+        for (; i + BLOCK <= n; i += BLOCK) {
+            uint32_t acc = 0;
+            for (size_t k = 0; k < BLOCK; ++k) acc |= gaps[i + k];
+            unsigned bits = bits_needed(acc);
+            out.push_back(static_cast<char>(bits));
+            pack128(&gaps[i], bits, out);
+        }
+        encode_tail(gaps.data() + i, n - i, out);
+    }
+
+    static size_t decode(const char* data, size_t size, size_t n, uint32_t* out) {
+        using namespace codec_detail;
+        const char* p = data;
+        const char* end = data + size;
+        uint32_t prev = 0;
+        size_t i = 0;
+        for (; i + BLOCK <= n; i += BLOCK) {
+            if (p >= end) throw std::runtime_error("Lista BP128 truncada");
+            unsigned bits = static_cast<uint8_t>(*p++);
+            if (bits > 32 || p + bits * 16 > end) throw std::runtime_error("Lista BP128 corrupta");
+            unpack128(p, bits, out + i);
+            p += bits * 16;
+            prev = prefix_sum128(out + i, prev);
+        }
+        p = decode_tail(p, end, n - i, prev, out + i);
+        return p - data;
+    }
+};
+
+// PForDelta: como BP128 pero eligiendo el ancho que cubre ~90% de los huecos;
+// los bits altos de las excepciones se guardan aparte y se parchean al decodificar.
+struct PForDeltaCodec {
+    static unsigned choose_bits(const uint32_t* gaps) {
+        unsigned histogram[33] = {0};
+        for (size_t k = 0; k < codec_detail::BLOCK; ++k) histogram[codec_detail::bits_needed(gaps[k])]++;
+
+        // Coste en bits: 128*b + excepciones (~8 bits de posición + 5 bytes de varint como cota)
+        unsigned best_bits = 32;
+        size_t best_cost = static_cast<size_t>(-1);
+        size_t exceptions = 0;
+        for (int b = 32; b >= 0; --b) {
+            size_t cost = codec_detail::BLOCK * b + exceptions * (8 + 16);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_bits = b;
+            }
+            exceptions += histogram[b];
+        }
+        return best_bits;
+    }
+
+    static void encode(const uint32_t* docs, size_t n, std::string& out) {
+        using namespace codec_detail;
+        std::vector<uint32_t> gaps = gaps_of(docs, n);
+        size_t i = 0;
+        uint32_t low[BLOCK];
+        for (; i + BLOCK <= n; i += BLOCK) {
+            unsigned bits = choose_bits(&gaps[i]);
+            uint32_t mask = bits == 32 ? ~0u : ((1u << bits) - 1);
+            std::string exceptions;
+            unsigned exception_count = 0;
+            for (size_t k = 0; k < BLOCK; ++k) {
+                low[k] = gaps[i + k] & mask;
+                if (bits < 32 && (gaps[i + k] >> bits) != 0) {
+                    exceptions.push_back(static_cast<char>(k));
+                    write_varint(exceptions, gaps[i + k] >> bits);
+                    ++exception_count;
+                }
+            }
+            out.push_back(static_cast<char>(bits));
+            out.push_back(static_cast<char>(exception_count));
+            pack128(low, bits, out);
+            out += exceptions;
+        }
+        encode_tail(gaps.data() + i, n - i, out);
+    }
+
+    static size_t decode(const char* data, size_t size, size_t n, uint32_t* out) {
+        using namespace codec_detail;
+        const char* p = data;
+        const char* end = data + size;
+        uint32_t prev = 0;
+        size_t i = 0;
+        for (; i + BLOCK <= n; i += BLOCK) {
+            if (p + 2 > end) throw std::runtime_error("Lista PForDelta truncada");
+            unsigned bits = static_cast<uint8_t>(p[0]);
+            unsigned exception_count = static_cast<uint8_t>(p[1]);
+            p += 2;
+            if (bits > 32 || p + bits * 16 > end) throw std::runtime_error("Lista PForDelta corrupta");
+            unpack128(p, bits, out + i);
+            p += bits * 16;
+            for (unsigned e = 0; e < exception_count; ++e) {
+                if (p >= end) throw std::runtime_error("Lista PForDelta truncada");
+                unsigned pos = static_cast<uint8_t>(*p++);
+                uint64_t high;
+                if (pos >= BLOCK || !read_varint(p, end, high)) throw std::runtime_error("Lista PForDelta corrupta");
+                out[i + pos] |= static_cast<uint32_t>(high << bits);
+            }
+            prev = prefix_sum128(out + i, prev);
+        }
+        p = decode_tail(p, end, n - i, prev, out + i);
+        return p - data;
+    }
+};
+
+// Despacho en tiempo de ejecución según el códec elegido para el índice
+class PostingCodec {
+public:
+    static void encode(CodecType type, const uint32_t* docs, size_t n, std::string& out) {
+        switch (type) {
+            case CodecType::Gamma: GammaCodec::encode(docs, n, out); return;
+            case CodecType::StreamVByte: StreamVByteCodec::encode(docs, n, out); return;
+            case CodecType::PForDelta: PForDeltaCodec::encode(docs, n, out); return;
+            case CodecType::BP128: BP128Codec::encode(docs, n, out); return;
+        }
+        throw std::runtime_error("Códec desconocido");
+    }
+
+    // Decodifica 'n' doc IDs desde [data, data + size); devuelve los bytes consumidos
+    static size_t decode(CodecType type, const char* data, size_t size, size_t n, uint32_t* out) {
+        if (n == 0) return 0;
+        switch (type) {
+            case CodecType::Gamma: return GammaCodec::decode(data, size, n, out);
+            case CodecType::StreamVByte: return StreamVByteCodec::decode(data, size, n, out);
+            case CodecType::PForDelta: return PForDeltaCodec::decode(data, size, n, out);
+            case CodecType::BP128: return BP128Codec::decode(data, size, n, out);
+        }
+        throw std::runtime_error("Códec desconocido");
+    }
+};
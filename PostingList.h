@@ -0,0 +1,452 @@
+#pragma once
+#include "PostingCodecs.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Lista de postings con cabecera de longitud:
+//   [varint bytes del cuerpo][varint cantidad][varint tf máximo][varint razón mínima][cuerpo]
+// El cuerpo se parte en bloques de POSTING_BLOCK postings codificados por separado:
+// primero los doc IDs (relativos al primero del bloque) y luego las frecuencias,
+// ambos con el códec del índice (las frecuencias como sumas acumuladas, que son
+// estrictamente crecientes). Si hay más de un bloque, el cuerpo empieza con una
+// tabla de saltos de ancho fijo para búsqueda binaria:
+//   [primer doc][máximo doc][offset del bloque][tf máximo][razón mínima] (u32 c/u)
+// La razón es longitud del documento / tf en punto fijo (x16, redondeada hacia abajo).
+// Con el tf máximo y la razón mínima se acota el puntaje BM25 del bloque para
+// cualquier longitud promedio y parámetros k1, b (ver Bm25::upper_bound).
+constexpr size_t POSTING_BLOCK = 128;
+constexpr uint32_t RATIO_SCALE = 16;
+
+inline uint32_t length_ratio(uint32_t length, uint32_t tf) {
+    return static_cast<uint32_t>(uint64_t(length) * RATIO_SCALE / tf);
+}
+
+struct SkipEntry {
+    uint32_t first;
+    uint32_t last;
+    uint32_t offset; // relativo al inicio de los bloques
+    uint32_t max_tf;
+    uint32_t min_ratio;
+};
+
+// Lista por trozos: las que crecen por el final (ver InvertedIndex) no se
+// reescriben. Sus bloques completos quedan donde estaban en el blob y un
+// directorio con capacidad de sobra los ubica:
+//   [ChunkedHeader][ChunkEntry x capacity] (se usan las primeras block_count())
+// Todos los bloques salvo el último tienen POSTING_BLOCK postings, con los doc
+// IDs relativos al primero, igual que en una lista de varios bloques.
+struct ChunkedHeader {
+    uint32_t count;
+    uint32_t max_tf;
+    uint32_t min_ratio;
+    uint32_t capacity;
+};
+
+struct ChunkEntry {
+    int64_t offset; // del bloque, relativo a la primera entrada (puede ser negativo)
+    uint32_t bytes;
+    uint32_t first;
+    uint32_t last;
+    uint32_t max_tf;
+    uint32_t min_ratio;
+    uint32_t reserved;
+};
+
+// Vista sobre una lista dentro del blob, sin copiarla
+struct PostingListView {
+    const char* data = nullptr; // cuerpo
+    size_t size = 0;
+    uint32_t count = 0;
+    uint32_t max_tf = 0;
+    uint32_t min_ratio = 0;
+    CodecType codec = CodecType::Gamma;
+    bool chunked = false; // 'data' es el directorio de ChunkEntry
+
+    static constexpr size_t SKIP_ENTRY_SIZE = sizeof(SkipEntry);
+
+    bool empty() const { return count == 0; }
+    size_t block_count() const { return (count + POSTING_BLOCK - 1) / POSTING_BLOCK; }
+    size_t block_postings(size_t block) const {
+        return std::min(POSTING_BLOCK, count - block * POSTING_BLOCK);
+    }
+
+    const char* blocks() const {
+        return block_count() > 1 ? data + block_count() * SKIP_ENTRY_SIZE : data;
+    }
+    size_t blocks_size() const { return size - (blocks() - data); }
+
+    SkipEntry skip_entry(size_t block) const {
+        if (chunked) {
+            ChunkEntry chunk = chunk_entry(block);
+            return {chunk.first, chunk.last, 0, chunk.max_tf, chunk.min_ratio};
+        }
+        SkipEntry entry;
+        std::memcpy(&entry, data + block * SKIP_ENTRY_SIZE, SKIP_ENTRY_SIZE);
+        return entry;
+    }
+
+    ChunkEntry chunk_entry(size_t block) const {
+        ChunkEntry entry;
+        std::memcpy(&entry, data + block * sizeof(ChunkEntry), sizeof(ChunkEntry));
+        return entry;
+    }
+
+    // Último doc ID de la lista (la lista no puede estar vacía)
+    uint32_t last_doc() const {
+        if (block_count() > 1) return skip_entry(block_count() - 1).last;
+        uint32_t docs[POSTING_BLOCK];
+        decode_block(0, docs);
+        return docs[count - 1];
+    }
+
+    // Rango de bytes [begin, end) del bloque
+    void block_bytes(size_t block, const char*& begin, const char*& end) const {
+        if (chunked) {
+            ChunkEntry entry = chunk_entry(block);
+            begin = data + entry.offset;
+            end = begin + entry.bytes;
+            return;
+        }
+        if (block_count() == 1) {
+            begin = blocks();
+            end = begin + blocks_size();
+            return;
+        }
+        size_t from = skip_entry(block).offset;
+        size_t to = (block + 1 < block_count()) ? skip_entry(block + 1).offset : blocks_size();
+        if (from > to || to > blocks_size()) {
+            throw std::runtime_error("Tabla de saltos corrupta");
+        }
+        begin = blocks() + from;
+        end = blocks() + to;
+    }
+
+    // Decodifica los doc IDs de un bloque en 'docs' (espacio para POSTING_BLOCK);
+    // devuelve dónde empiezan sus frecuencias
+    const char* decode_block(size_t block, uint32_t* docs) const {
+        const char *begin, *end;
+        block_bytes(block, begin, end);
+        size_t n = block_postings(block);
+        const char* freqs = begin + PostingCodec::decode(codec, begin, end - begin, n, docs);
+        if (block_count() > 1) {
+            uint32_t first = skip_entry(block).first;
+            for (size_t i = 0; i < n; ++i) docs[i] += first;
+        }
+        return freqs;
+    }
+
+    void decode_block_freqs(size_t block, const char* freqs, uint32_t* tfs) const {
+        const char *begin, *end;
+        block_bytes(block, begin, end);
+        size_t n = block_postings(block);
+        PostingCodec::decode(codec, freqs, end - freqs, n, tfs);
+        for (size_t i = n; i-- > 1;) tfs[i] -= tfs[i - 1];
+    }
+
+    // Agrega los doc IDs (y opcionalmente las frecuencias) al final de los vectores
+    void decode(std::vector<uint32_t>& docs, std::vector<uint32_t>* tfs = nullptr) const {
+        size_t base = docs.size();
+        docs.resize(base + count);
+        size_t tf_base = 0;
+        if (tfs) {
+            tf_base = tfs->size();
+            tfs->resize(tf_base + count);
+        }
+        for (size_t b = 0; b < block_count(); ++b) {
+            const char* freqs = decode_block(b, docs.data() + base + b * POSTING_BLOCK);
+            if (tfs) decode_block_freqs(b, freqs, tfs->data() + tf_base + b * POSTING_BLOCK);
+        }
+    }
+
+    std::vector<uint32_t> decode() const {
+        std::vector<uint32_t> out;
+        decode(out);
+        return out;
+    }
+
+    // Lee la cabecera en 'p'; si 'total_size' no es nulo devuelve los bytes de
+    // cabecera + cuerpo. Nunca lee más allá de 'end'.
+    static PostingListView parse(const char* p, const char* end, CodecType codec, size_t* total_size = nullptr) {
+        const char* begin = p;
+        uint64_t body_size, count, max_tf, min_ratio;
+        if (!read_varint(p, end, body_size) || !read_varint(p, end, count) ||
+            !read_varint(p, end, max_tf) || !read_varint(p, end, min_ratio) ||
+            body_size > static_cast<uint64_t>(end - p)) {
+            throw std::runtime_error("Cabecera de lista de postings corrupta");
+        }
+
+        PostingListView view;
+        view.data = p;
+        view.size = body_size;
+        view.count = static_cast<uint32_t>(count);
+        view.max_tf = static_cast<uint32_t>(max_tf);
+        view.min_ratio = static_cast<uint32_t>(min_ratio);
+        view.codec = codec;
+        if (view.block_count() > 1 && view.block_count() * SKIP_ENTRY_SIZE > body_size) {
+            throw std::runtime_error("Tabla de saltos truncada");
+        }
+        if (total_size) *total_size = (p - begin) + body_size;
+        return view;
+    }
+
+    // Directorio de una lista por trozos; 'total_size' cuenta solo el directorio
+    static PostingListView parse_chunked(const char* p, const char* end, CodecType codec,
+                                         size_t* total_size = nullptr) {
+        ChunkedHeader header;
+        if (static_cast<size_t>(end - p) < sizeof(header)) {
+            throw std::runtime_error("Directorio de lista de postings truncado");
+        }
+        std::memcpy(&header, p, sizeof(header));
+
+        PostingListView view;
+        view.data = p + sizeof(header);
+        view.size = size_t(header.capacity) * sizeof(ChunkEntry);
+        view.count = header.count;
+        view.max_tf = header.max_tf;
+        view.min_ratio = header.min_ratio;
+        view.codec = codec;
+        view.chunked = true;
+        if (view.size > static_cast<size_t>(end - view.data) || view.block_count() > header.capacity) {
+            throw std::runtime_error("Directorio de lista de postings truncado");
+        }
+        if (total_size) *total_size = sizeof(header) + view.size;
+        return view;
+    }
+
+    // Codifica un bloque de 'n' postings al final de 'out' y devuelve su entrada
+    // de la tabla de saltos (con offset 0). 'tfs' y 'lengths' pueden ser nulos.
+    static SkipEntry encode_block(CodecType codec, const uint32_t* docs, const uint32_t* tfs,
+                                  const uint32_t* lengths, size_t n, bool relative_ids, std::string& out) {
+        uint32_t relative[POSTING_BLOCK];
+        uint32_t cumulative[POSTING_BLOCK];
+        SkipEntry entry{docs[0], docs[n - 1], 0, 0, UINT32_MAX};
+
+        uint32_t sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t tf = tfs ? std::max<uint32_t>(tfs[i], 1) : 1;
+            uint32_t length = lengths ? lengths[i] : 0;
+            entry.max_tf = std::max(entry.max_tf, tf);
+            entry.min_ratio = std::min(entry.min_ratio, length_ratio(length, tf));
+            sum += tf;
+            cumulative[i] = sum;
+            relative[i] = relative_ids ? docs[i] - entry.first : docs[i];
+        }
+        PostingCodec::encode(codec, relative, n, out);
+        PostingCodec::encode(codec, cumulative, n, out);
+        return entry;
+    }
+
+    // 'tfs' vacío equivale a tf = 1; 'lengths' (longitud del documento de cada
+    // posting) solo se usa para las cotas y puede ir vacío (cota con longitud 0)
+    static void encode(CodecType codec, const std::vector<uint32_t>& docs, const std::vector<uint32_t>& tfs,
+                       const std::vector<uint32_t>& lengths, std::string& out) {
+        size_t nblocks = (docs.size() + POSTING_BLOCK - 1) / POSTING_BLOCK;
+        std::string skips;
+        std::string blocks;
+        uint32_t list_max_tf = 0, list_min_ratio = UINT32_MAX;
+
+        for (size_t b = 0; b < nblocks; ++b) {
+            size_t begin = b * POSTING_BLOCK;
+            size_t n = std::min(POSTING_BLOCK, docs.size() - begin);
+            uint32_t offset = static_cast<uint32_t>(blocks.size());
+            SkipEntry entry = encode_block(codec, docs.data() + begin, tfs.empty() ? nullptr : tfs.data() + begin,
+                                           lengths.empty() ? nullptr : lengths.data() + begin, n, nblocks > 1,
+                                           blocks);
+            entry.offset = offset;
+            list_max_tf = std::max(list_max_tf, entry.max_tf);
+            list_min_ratio = std::min(list_min_ratio, entry.min_ratio);
+            if (nblocks > 1) skips.append(reinterpret_cast<const char*>(&entry), SKIP_ENTRY_SIZE);
+        }
+
+        assemble(docs.size(), list_max_tf, docs.empty() ? 0 : list_min_ratio, skips, blocks, out);
+    }
+
+    // Reescribe la lista en formato contiguo (una lista por trozos se junta)
+    void write_compact(std::string& out) const {
+        std::string skips;
+        std::string body;
+        for (size_t b = 0; b < block_count(); ++b) {
+            const char *begin, *end;
+            block_bytes(b, begin, end);
+            if (block_count() > 1) {
+                SkipEntry entry = skip_entry(b);
+                entry.offset = static_cast<uint32_t>(body.size());
+                skips.append(reinterpret_cast<const char*>(&entry), SKIP_ENTRY_SIZE);
+            }
+            body.append(begin, end);
+        }
+        assemble(count, max_tf, min_ratio, skips, body, out);
+    }
+
+    static void assemble(size_t count, uint32_t max_tf, uint32_t min_ratio, const std::string& skips,
+                         const std::string& blocks, std::string& out) {
+        write_varint(out, skips.size() + blocks.size());
+        write_varint(out, count);
+        write_varint(out, max_tf);
+        write_varint(out, min_ratio);
+        out += skips;
+        out += blocks;
+    }
+
+    static void encode(CodecType codec, const std::vector<uint32_t>& docs, std::string& out) {
+        encode(codec, docs, {}, {}, out);
+    }
+};
+
+// Primera posición >= target en data[pos, size): galope exponencial desde 'pos'
+// y luego búsqueda en la ventana acotada (comparación SIMD si es pequeña).
+inline size_t gallop_geq(const uint32_t* data, size_t pos, size_t size, uint32_t target) {
+    size_t lo = pos, hi = pos, step = 1;
+    while (hi < size && data[hi] < target) {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    hi = std::min(hi, size);
+
+#if defined(__AVX2__)
+    if (hi - lo <= 64) {
+        const __m256i bias = _mm256_set1_epi32(INT32_MIN);
+        const __m256i key = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(target)), bias);
+        size_t i = lo;
+        size_t less = 0;
+        for (; i + 8 <= hi; i += 8) {
+            __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), bias);
+            less += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(key, v))));
+        }
+        for (; i < hi; ++i) less += data[i] < target;
+        return lo + less;
+    }
+#endif
+    return std::lower_bound(data + lo, data + hi, target) - data;
+}
+
+// Cota de un bloque: último doc que cubre y máximos para acotar el puntaje
+struct BlockBound {
+    uint32_t last;
+    uint32_t max_tf;
+    uint32_t min_ratio;
+};
+
+// Cursor sobre una lista: avanza bloque a bloque y salta los bloques cuyo
+// máximo es menor que el objetivo sin decodificarlos. Las frecuencias del
+// bloque se decodifican solo si se piden.
+class PostingCursor {
+public:
+    static constexpr uint32_t END = UINT32_MAX;
+
+    PostingCursor() = default;
+
+    explicit PostingCursor(const PostingListView& view) : list(view) {
+        if (!list.empty()) load_block(0);
+    }
+
+    uint32_t docid() const { return current; }
+    bool at_end() const { return current == END; }
+    uint32_t size() const { return list.count; }
+    const PostingListView& view() const { return list; }
+
+    // Posición global del posting actual dentro de la lista
+    size_t position() const { return block * POSTING_BLOCK + pos; }
+
+    uint32_t freq() { return block_freqs()[pos]; }
+
+    // Bloque actual, posición dentro de él y sus frecuencias (para leer posiciones)
+    size_t block_index() const { return block; }
+    size_t block_pos() const { return pos; }
+    size_t block_size() const { return buffer_size; }
+    const uint32_t* block_freqs() {
+        if (!freqs_loaded) {
+            list.decode_block_freqs(block, freqs_data, tf_buffer);
+            freqs_loaded = true;
+        }
+        return tf_buffer;
+    }
+
+    void next() {
+        if (at_end()) return;
+        if (++pos < buffer_size) {
+            current = buffer[pos];
+        } else if (block + 1 < list.block_count()) {
+            load_block(block + 1);
+        } else {
+            current = END;
+        }
+    }
+
+    // Avanza hasta el primer doc >= target (o END)
+    void next_geq(uint32_t target) {
+        if (at_end() || current >= target) return;
+
+        if (buffer[buffer_size - 1] < target) {
+            size_t b = find_block(target);
+            if (b == list.block_count()) {
+                current = END;
+                return;
+            }
+            load_block(b);
+        }
+
+        pos = gallop_geq(buffer, pos, buffer_size, target);
+        current = buffer[pos];
+    }
+
+    // Cota del bloque actual
+    BlockBound block_bound() const { return bound_of(block); }
+
+    // Cota del bloque que contendría 'target', sin decodificar nada.
+    // last == END si ningún bloque restante llega a 'target'.
+    BlockBound block_bound_for(uint32_t target) const {
+        if (at_end()) return {END, 0, 0};
+        if (buffer[buffer_size - 1] >= target) return bound_of(block);
+        size_t b = find_block(target);
+        if (b == list.block_count()) return {END, 0, 0};
+        return bound_of(b);
+    }
+
+private:
+    PostingListView list;
+    size_t block = 0;
+    size_t pos = 0;
+    size_t buffer_size = 0;
+    uint32_t current = END;
+    const char* freqs_data = nullptr;
+    bool freqs_loaded = false;
+    uint32_t buffer[POSTING_BLOCK];
+    uint32_t tf_buffer[POSTING_BLOCK];
+
+    // Primer bloque posterior al actual cuyo máximo es >= target
+    size_t find_block(uint32_t target) const {
+        size_t lo = block + 1, hi = list.block_count();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (list.skip_entry(mid).last < target) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    BlockBound bound_of(size_t b) const {
+        if (list.block_count() == 1) return {buffer[buffer_size - 1], list.max_tf, list.min_ratio};
+        SkipEntry entry = list.skip_entry(b);
+        return {entry.last, entry.max_tf, entry.min_ratio};
+    }
+
+    void load_block(size_t b) {
+        block = b;
+        buffer_size = list.block_postings(b);
+        freqs_data = list.decode_block(b, buffer);
+        freqs_loaded = false;
+        pos = 0;
+        current = buffer[0];
+    }
+};
@@ -0,0 +1,924 @@
+#pragma once
+#include "InvertedIndex.h"
+#include "PostingList.h"
+#include "Ranking.h"
+#include "PositionList.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+// Nodo del árbol de consulta booleana.
+// And: todos los 'children' y ninguno de 'excluded'. Or: cualquiera de 'children'.
+// Phrase: los términos de 'children' seguidos y en orden. Near: todos los términos
+// a distancia <= 'window' (entre la primera y la última aparición, sin orden).
+// Wildcard: cualquier término que calce con el patrón 'term' ('*' = cualquier
+// secuencia). Fuzzy: cualquier término a 'max_edits' ediciones o menos de 'term'.
+struct QueryNode {
+    enum class Type { Term, And, Or, Phrase, Near, Wildcard, Fuzzy };
+
+    Type type = Type::Term;
+    std::string term;
+    uint32_t window = 0;
+    uint32_t max_edits = 0;
+    std::vector<std::unique_ptr<QueryNode>> children;
+    std::vector<std::unique_ptr<QueryNode>> excluded;
+    // And escrito solo por yuxtaposición (a b c, sin AND ni NOT): top_k lo
+    // puntúa como una lista de términos
+    bool juxtaposed = false;
+
+    static std::unique_ptr<QueryNode> make_term(std::string term) {
+        auto node = std::make_unique<QueryNode>();
+        node->term = std::move(term);
+        return node;
+    }
+
+    static std::unique_ptr<QueryNode> make(Type type) {
+        auto node = std::make_unique<QueryNode>();
+        node->type = type;
+        return node;
+    }
+};
+
+// Mismas reglas que el indexador: solo letras, en minúsculas
+inline std::string normalize_query_term(const std::string& word) {
+    std::string normalized;
+    normalized.reserve(word.size());
+    for (unsigned char ch : word) {
+        if (std::isalpha(ch)) normalized += static_cast<char>(std::tolower(ch));
+    }
+    return normalized;
+}
+
+// Forma canónica de una consulta, para usarla como clave de caché: los hijos
+// de AND, OR y NEAR (que no dependen del orden) se ordenan, así que
+// "b AND a" y "a b" dan la misma clave; una frase conserva su orden.
+inline std::string canonical_query(const QueryNode& node) {
+    auto joined = [](const std::vector<std::unique_ptr<QueryNode>>& nodes, bool sorted) {
+        std::vector<std::string> parts;
+        for (const auto& child : nodes) parts.push_back(canonical_query(*child));
+        if (sorted) std::sort(parts.begin(), parts.end());
+        std::string out;
+        for (const auto& part : parts) out += part + ' ';
+        return out;
+    };
+    switch (node.type) {
+        case QueryNode::Type::Term:
+            return node.term;
+        case QueryNode::Type::Wildcard:
+            return node.term; // lleva '*', no choca con un término
+        case QueryNode::Type::Fuzzy:
+            return node.term + '~' + std::to_string(node.max_edits);
+        case QueryNode::Type::And:
+            return "(& " + joined(node.children, true) + "! " + joined(node.excluded, true) + ")";
+        case QueryNode::Type::Or:
+            return "(| " + joined(node.children, true) + ")";
+        case QueryNode::Type::Phrase:
+            return "(\" " + joined(node.children, false) + ")";
+        case QueryNode::Type::Near:
+            return "(~" + std::to_string(node.window) + ' ' + joined(node.children, true) + ")";
+    }
+    return "";
+}
+
+// Analizador de consultas del tipo  a AND (b OR c) NOT "d e"
+//   expr     := and_expr ('OR' and_expr)*
+//   and_expr := operand (['AND'] ['NOT'] operand)*     (yuxtaposición = AND; ver top_k)
+//   operand  := termino | patrón | termino '~' [N] | '"' termino+ '"' ['~' N] | '(' expr ')'
+// Los operadores van en mayúsculas; "and" en minúsculas es un término.
+// Entre comillas es una frase exacta; con ~N, los términos a N palabras o menos.
+// Un patrón lleva '*' (lor*, *sum, l*m); termino~N acepta hasta N errores
+// de tipeo (1 o 2; sin N, 2).
+class QueryParser {
+public:
+    static std::unique_ptr<QueryNode> parse(const std::string& query) {
+        QueryParser parser(query);
+        auto node = parser.parse_or();
+        if (parser.pos < parser.tokens.size()) {
+            throw std::runtime_error("Consulta inválida cerca de: " + parser.tokens[parser.pos]);
+        }
+        return node;
+    }
+
+private:
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+
+    explicit QueryParser(const std::string& query) {
+        std::string current;
+        for (size_t i = 0; i < query.size(); ++i) {
+            char ch = query[i];
+            if (ch == '"') {
+                // La frase queda en un solo token, con comillas y sufijo ~N
+                if (!current.empty()) tokens.push_back(std::move(current));
+                current.clear();
+                size_t end = query.find('"', i + 1);
+                if (end == std::string::npos) throw std::runtime_error("Falta '\"' en la consulta");
+                ++end;
+                if (end < query.size() && query[end] == '~') {
+                    ++end;
+                    while (end < query.size() && std::isdigit(static_cast<unsigned char>(query[end]))) ++end;
+                }
+                tokens.push_back(query.substr(i, end - i));
+                i = end - 1;
+            } else if (ch == '(' || ch == ')' || std::isspace(static_cast<unsigned char>(ch))) {
+                if (!current.empty()) tokens.push_back(std::move(current));
+                current.clear();
+                if (ch == '(' || ch == ')') tokens.emplace_back(1, ch);
+            } else {
+                current += ch;
+            }
+        }
+        if (!current.empty()) tokens.push_back(std::move(current));
+    }
+
+    bool accept(const char* token) {
+        if (pos < tokens.size() && tokens[pos] == token) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool at_operand() const {
+        return pos < tokens.size() && tokens[pos] != ")" && tokens[pos] != "OR" &&
+               tokens[pos] != "AND" && tokens[pos] != "NOT";
+    }
+
+    std::unique_ptr<QueryNode> parse_or() {
+        auto node = parse_and();
+        if (pos >= tokens.size() || tokens[pos] != "OR") return node;
+
+        auto or_node = QueryNode::make(QueryNode::Type::Or);
+        or_node->children.push_back(std::move(node));
+        while (accept("OR")) {
+            or_node->children.push_back(parse_and());
+        }
+        return or_node;
+    }
+
+    std::unique_ptr<QueryNode> parse_and() {
+        auto and_node = QueryNode::make(QueryNode::Type::And);
+        bool first = true;
+        bool any_operator = false;
+
+        while (true) {
+            bool explicit_and = !first && accept("AND");
+            bool negated = accept("NOT");
+            if (!at_operand()) {
+                if (first || explicit_and || negated) {
+                    throw std::runtime_error("Se esperaba un término en la consulta");
+                }
+                break;
+            }
+            auto operand = parse_operand();
+            (negated ? and_node->excluded : and_node->children).push_back(std::move(operand));
+            any_operator = any_operator || explicit_and || negated;
+            first = false;
+        }
+        and_node->juxtaposed = !any_operator;
+
+        if (and_node->children.empty()) {
+            throw std::runtime_error("NOT necesita al menos un término positivo");
+        }
+        if (and_node->children.size() == 1 && and_node->excluded.empty()) {
+            return std::move(and_node->children[0]);
+        }
+        return and_node;
+    }
+
+    std::unique_ptr<QueryNode> parse_operand() {
+        if (accept("(")) {
+            auto node = parse_or();
+            if (!accept(")")) throw std::runtime_error("Falta ')' en la consulta");
+            return node;
+        }
+        const std::string& token = tokens[pos++];
+        if (token[0] == '"') return parse_phrase(token);
+        if (token.find('*') != std::string::npos) return parse_wildcard(token);
+        size_t tilde = token.find('~');
+        if (tilde != std::string::npos) return parse_fuzzy(token, tilde);
+        return QueryNode::make_term(normalize_query_term(token));
+    }
+
+    static std::unique_ptr<QueryNode> parse_wildcard(const std::string& token) {
+        // Se normaliza cada tramo entre comodines y se juntan los '*' seguidos
+        std::string pattern, part;
+        for (size_t i = 0; i <= token.size(); ++i) {
+            if (i < token.size() && token[i] != '*') {
+                part += token[i];
+                continue;
+            }
+            pattern += normalize_query_term(part);
+            part.clear();
+            if (i < token.size() && (pattern.empty() || pattern.back() != '*')) pattern += '*';
+        }
+        if (pattern.find_first_not_of('*') == std::string::npos) {
+            throw std::runtime_error("El comodín necesita letras: " + token);
+        }
+        auto node = QueryNode::make(QueryNode::Type::Wildcard);
+        node->term = pattern;
+        return node;
+    }
+
+    static std::unique_ptr<QueryNode> parse_fuzzy(const std::string& token, size_t tilde) {
+        std::string digits = token.substr(tilde + 1);
+        uint32_t edits = 2;
+        if (!digits.empty()) {
+            if (digits.size() != 1 || digits[0] < '0' || digits[0] > '2') {
+                throw std::runtime_error("Distancia de edición inválida (0 a 2): " + token);
+            }
+            edits = static_cast<uint32_t>(digits[0] - '0');
+        }
+        std::string term = normalize_query_term(token.substr(0, tilde));
+        if (term.empty()) throw std::runtime_error("Se esperaba un término antes de '~': " + token);
+        if (edits == 0) return QueryNode::make_term(term);
+
+        auto node = QueryNode::make(QueryNode::Type::Fuzzy);
+        node->term = term;
+        node->max_edits = edits;
+        return node;
+    }
+
+    static std::unique_ptr<QueryNode> parse_phrase(const std::string& token) {
+        size_t close = token.rfind('"');
+        auto node = QueryNode::make(QueryNode::Type::Phrase);
+        if (close + 1 < token.size()) {
+            std::string digits = token.substr(close + 2);
+            if (digits.empty() || digits.size() > 9) {
+                throw std::runtime_error("Distancia inválida en la consulta: " + token);
+            }
+            // ~0 es la frase exacta
+            node->window = static_cast<uint32_t>(std::stoul(digits));
+            if (node->window > 0) node->type = QueryNode::Type::Near;
+        }
+
+        std::string word;
+        for (size_t i = 1; i <= close; ++i) {
+            if (i < close && !std::isspace(static_cast<unsigned char>(token[i]))) {
+                word += token[i];
+                continue;
+            }
+            std::string normalized = normalize_query_term(word);
+            if (!normalized.empty()) node->children.push_back(QueryNode::make_term(normalized));
+            word.clear();
+        }
+
+        if (node->children.empty()) throw std::runtime_error("Frase vacía en la consulta");
+        if (node->children.size() == 1) return std::move(node->children[0]);
+        return node;
+    }
+};
+
+// Iterador de documentos en orden creciente; docid() == END al terminar
+class DocIterator {
+public:
+    static constexpr uint32_t END = PostingCursor::END;
+
+    virtual ~DocIterator() = default;
+    virtual uint32_t docid() const = 0;
+    virtual void next() = 0;
+    virtual void next_geq(uint32_t target) = 0;
+    // Estimación de documentos que puede devolver (para ordenar por df)
+    virtual uint64_t cost() const = 0;
+
+    bool at_end() const { return docid() == END; }
+};
+
+class TermIterator : public DocIterator {
+private:
+    PostingCursor cursor;
+
+public:
+    explicit TermIterator(PostingCursor cursor) : cursor(std::move(cursor)) {}
+
+    uint32_t docid() const override { return cursor.docid(); }
+    void next() override { cursor.next(); }
+    void next_geq(uint32_t target) override { cursor.next_geq(target); }
+    uint64_t cost() const override { return cursor.size(); }
+};
+
+// Recorre una lista ya decodificada, compartida entre las consultas de un lote
+// (ver QueryEngine::search_batch)
+class DecodedIterator : public DocIterator {
+private:
+    SearchCache::DocsPointer docs;
+    size_t pos = 0;
+
+public:
+    explicit DecodedIterator(SearchCache::DocsPointer docs) : docs(std::move(docs)) {}
+
+    uint32_t docid() const override { return pos < docs->size() ? (*docs)[pos] : END; }
+    void next() override { ++pos; }
+
+    // Galope desde la posición actual y búsqueda binaria en el último tramo
+    void next_geq(uint32_t target) override {
+        size_t size = docs->size();
+        if (pos >= size || (*docs)[pos] >= target) return;
+        size_t step = 1;
+        while (pos + step < size && (*docs)[pos + step] < target) step <<= 1;
+        auto begin = docs->begin();
+        pos = std::lower_bound(begin + pos + step / 2 + 1, begin + std::min(pos + step + 1, size), target) - begin;
+    }
+
+    uint64_t cost() const override { return docs->size() - std::min(pos, docs->size()); }
+};
+
+// Intersección por saltos: la lista más corta propone candidatos y el resto
+// responde con next_geq (galope dentro del bloque, saltos entre bloques)
+class AndIterator : public DocIterator {
+private:
+    std::vector<std::unique_ptr<DocIterator>> children;
+    std::vector<std::unique_ptr<DocIterator>> excluded;
+    uint32_t current = END;
+
+    bool is_excluded(uint32_t doc) {
+        for (auto& ex : excluded) {
+            ex->next_geq(doc);
+            if (ex->docid() == doc) return true;
+        }
+        return false;
+    }
+
+    void align() {
+        DocIterator& lead = *children[0];
+        while (true) {
+            uint32_t candidate = lead.docid();
+            if (candidate == END) {
+                current = END;
+                return;
+            }
+
+            bool matched = true;
+            for (size_t i = 1; i < children.size(); ++i) {
+                children[i]->next_geq(candidate);
+                uint32_t doc = children[i]->docid();
+                if (doc != candidate) {
+                    if (doc == END) {
+                        current = END;
+                        return;
+                    }
+                    lead.next_geq(doc);
+                    matched = false;
+                    break;
+                }
+            }
+
+            if (matched) {
+                if (!is_excluded(candidate)) {
+                    current = candidate;
+                    return;
+                }
+                lead.next();
+            }
+        }
+    }
+
+public:
+    AndIterator(std::vector<std::unique_ptr<DocIterator>> children,
+                std::vector<std::unique_ptr<DocIterator>> excluded)
+        : children(std::move(children)), excluded(std::move(excluded)) {
+        std::sort(this->children.begin(), this->children.end(),
+                  [](const auto& a, const auto& b) { return a->cost() < b->cost(); });
+        align();
+    }
+
+    uint32_t docid() const override { return current; }
+
+    void next() override {
+        if (current == END) return;
+        children[0]->next();
+        align();
+    }
+
+    void next_geq(uint32_t target) override {
+        if (current == END || current >= target) return;
+        children[0]->next_geq(target);
+        align();
+    }
+
+    uint64_t cost() const override { return children[0]->cost(); }
+};
+
+// Unión con un min-heap por doc ID actual
+class OrIterator : public DocIterator {
+private:
+    std::vector<std::unique_ptr<DocIterator>> children;
+    std::vector<DocIterator*> heap;
+    uint64_t total_cost = 0;
+
+    static bool greater(const DocIterator* a, const DocIterator* b) {
+        return a->docid() > b->docid();
+    }
+
+    template <typename Advance>
+    void advance_while(uint32_t bound, Advance advance) {
+        while (!heap.empty() && heap.front()->docid() < bound) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            DocIterator* child = heap.back();
+            advance(*child);
+            if (child->at_end()) {
+                heap.pop_back();
+            } else {
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        }
+    }
+
+public:
+    explicit OrIterator(std::vector<std::unique_ptr<DocIterator>> children)
+        : children(std::move(children)) {
+        for (auto& child : this->children) {
+            total_cost += child->cost();
+            if (!child->at_end()) heap.push_back(child.get());
+        }
+        std::make_heap(heap.begin(), heap.end(), greater);
+    }
+
+    uint32_t docid() const override { return heap.empty() ? END : heap.front()->docid(); }
+
+    void next() override {
+        if (heap.empty()) return;
+        uint32_t doc = docid();
+        advance_while(doc + 1, [](DocIterator& child) { child.next(); });
+    }
+
+    void next_geq(uint32_t target) override {
+        advance_while(target, [target](DocIterator& child) { child.next_geq(target); });
+    }
+
+    uint64_t cost() const override { return total_cost; }
+};
+
+// Frase exacta o proximidad: intersecta por doc igual que AndIterator y solo
+// para los docs comunes lee las posiciones, así que el costo posicional es
+// proporcional a la intersección y no a las listas.
+class PositionalIterator : public DocIterator {
+public:
+    struct Slot {
+        PostingCursor cursor;
+        PositionReader reader;
+        uint32_t offset = 0; // lugar del término en la frase
+    };
+
+    // 'window' == 0: frase exacta; si no, todos los términos dentro de 'window'
+    PositionalIterator(std::vector<Slot> slots, uint32_t window)
+        : slots(std::move(slots)), window(window), spans(this->slots.size()), counts(this->slots.size()),
+          next_index(this->slots.size()) {
+        std::sort(this->slots.begin(), this->slots.end(),
+                  [](const Slot& a, const Slot& b) { return a.cursor.size() < b.cursor.size(); });
+        align();
+    }
+
+    uint32_t docid() const override { return current; }
+
+    void next() override {
+        if (current == END) return;
+        slots[0].cursor.next();
+        align();
+    }
+
+    void next_geq(uint32_t target) override {
+        if (current == END || current >= target) return;
+        slots[0].cursor.next_geq(target);
+        align();
+    }
+
+    uint64_t cost() const override { return slots[0].cursor.size(); }
+
+private:
+    std::vector<Slot> slots;
+    uint32_t window;
+    uint32_t current = END;
+    std::vector<const uint32_t*> spans;
+    std::vector<size_t> counts;
+    std::vector<size_t> next_index;
+
+    void align() {
+        PostingCursor& lead = slots[0].cursor;
+        while (true) {
+            uint32_t candidate = lead.docid();
+            if (candidate == END) {
+                current = END;
+                return;
+            }
+
+            bool matched = true;
+            for (size_t i = 1; i < slots.size(); ++i) {
+                slots[i].cursor.next_geq(candidate);
+                uint32_t doc = slots[i].cursor.docid();
+                if (doc != candidate) {
+                    if (doc == END) {
+                        current = END;
+                        return;
+                    }
+                    lead.next_geq(doc);
+                    matched = false;
+                    break;
+                }
+            }
+
+            if (matched) {
+                if (positions_match()) {
+                    current = candidate;
+                    return;
+                }
+                lead.next();
+            }
+        }
+    }
+
+    bool positions_match() {
+        size_t anchor = 0;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            spans[i] = slots[i].reader.positions(slots[i].cursor, counts[i]);
+            if (counts[i] < counts[anchor]) anchor = i;
+        }
+        return window == 0 ? phrase_match(anchor) : near_match();
+    }
+
+    // Recorre las apariciones del término menos frecuente y busca el resto
+    // en el lugar que le corresponde a cada uno
+    bool phrase_match(size_t anchor) const {
+        uint32_t anchor_offset = slots[anchor].offset;
+        for (size_t k = 0; k < counts[anchor]; ++k) {
+            if (spans[anchor][k] < anchor_offset) continue;
+            uint32_t start = spans[anchor][k] - anchor_offset;
+            bool found = true;
+            for (size_t i = 0; i < slots.size() && found; ++i) {
+                if (i == anchor) continue;
+                found = std::binary_search(spans[i], spans[i] + counts[i], start + slots[i].offset);
+            }
+            if (found) return true;
+        }
+        return false;
+    }
+
+    // Ventana mínima con una aparición de cada término: se avanza siempre
+    // el término de menor posición
+    bool near_match() {
+        std::fill(next_index.begin(), next_index.end(), 0);
+        while (true) {
+            size_t lowest = 0;
+            uint32_t low = UINT32_MAX, high = 0;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                uint32_t p = spans[i][next_index[i]];
+                if (p < low) {
+                    low = p;
+                    lowest = i;
+                }
+                high = std::max(high, p);
+            }
+            if (high - low <= window) return true;
+            if (++next_index[lowest] == counts[lowest]) return false;
+        }
+    }
+};
+
+// Evalúa consultas booleanas directamente sobre las listas comprimidas,
+// entregando los resultados en orden sin materializar listas completas
+class QueryEngine {
+private:
+    const InvertedIndex& index;
+    // Histogramas "query" (search) y "top_k" del registro del índice, si tiene
+    LatencyHistogram* query_latency = nullptr;
+    LatencyHistogram* top_k_latency = nullptr;
+
+public:
+    // Máximo de términos en que se expande un comodín o una búsqueda aproximada
+    static constexpr size_t MAX_EXPANSIONS = 1024;
+
+    // Usa el registro de métricas que tenga el índice al construirse
+    explicit QueryEngine(const InvertedIndex& index) : index(index) {
+        if (Metrics* metrics = index.metrics_registry()) {
+            query_latency = &metrics->histogram("query");
+            top_k_latency = &metrics->histogram("top_k");
+        }
+    }
+
+    // Términos del índice que cubre un nodo Wildcard o Fuzzy
+    std::vector<TermDictionary::Match> expand(const QueryNode& node) const {
+        const TermDictionary& dictionary = index.term_dictionary();
+        if (node.type == QueryNode::Type::Wildcard) return dictionary.wildcard(node.term, MAX_EXPANSIONS);
+        if (node.type == QueryNode::Type::Fuzzy) return dictionary.fuzzy(node.term, node.max_edits, MAX_EXPANSIONS);
+        return {};
+    }
+
+    // Listas ya decodificadas por término (ver search_batch)
+    using DecodedTerms = std::unordered_map<std::string, SearchCache::DocsPointer>;
+
+    // Con 'decoded', los términos que estén ahí se recorren sobre esas listas
+    std::unique_ptr<DocIterator> compile(const QueryNode& node, const DecodedTerms* decoded = nullptr) const {
+        switch (node.type) {
+            case QueryNode::Type::Term: {
+                if (decoded) {
+                    auto it = decoded->find(node.term);
+                    if (it != decoded->end()) return std::make_unique<DecodedIterator>(it->second);
+                }
+                return std::make_unique<TermIterator>(index.cursor(node.term));
+            }
+            case QueryNode::Type::Or: {
+                std::vector<std::unique_ptr<DocIterator>> children;
+                for (const auto& child : node.children) children.push_back(compile(*child, decoded));
+                return std::make_unique<OrIterator>(std::move(children));
+            }
+            case QueryNode::Type::And: {
+                std::vector<std::unique_ptr<DocIterator>> children, excluded;
+                for (const auto& child : node.children) children.push_back(compile(*child, decoded));
+                for (const auto& child : node.excluded) excluded.push_back(compile(*child, decoded));
+                return std::make_unique<AndIterator>(std::move(children), std::move(excluded));
+            }
+            case QueryNode::Type::Wildcard:
+            case QueryNode::Type::Fuzzy: {
+                // La expansión es un OR de los términos encontrados
+                std::vector<std::unique_ptr<DocIterator>> children;
+                for (const auto& match : expand(node)) {
+                    children.push_back(std::make_unique<TermIterator>(PostingCursor(index.posting_list(match.id))));
+                }
+                return std::make_unique<OrIterator>(std::move(children));
+            }
+            case QueryNode::Type::Phrase:
+            case QueryNode::Type::Near: {
+                if (!index.has_positions()) {
+                    throw std::runtime_error("El índice no guarda posiciones: no admite frases ni proximidad");
+                }
+                std::vector<std::string> words;
+                for (const auto& child : node.children) words.push_back(child->term);
+                if (node.type == QueryNode::Type::Near) {
+                    // Sin orden, un término repetido no agrega restricciones
+                    std::sort(words.begin(), words.end());
+                    words.erase(std::unique(words.begin(), words.end()), words.end());
+                }
+                std::vector<PositionalIterator::Slot> slots(words.size());
+                for (size_t i = 0; i < words.size(); ++i) {
+                    slots[i].cursor = index.cursor(words[i]);
+                    slots[i].reader = PositionReader(index.position_list(words[i]));
+                    slots[i].offset = static_cast<uint32_t>(i);
+                }
+                uint32_t window = node.type == QueryNode::Type::Near ? node.window : 0;
+                return std::make_unique<PositionalIterator>(std::move(slots), window);
+            }
+        }
+        throw std::runtime_error("Nodo de consulta desconocido");
+    }
+
+    std::unique_ptr<DocIterator> compile(const std::string& query) const {
+        return compile(*QueryParser::parse(query));
+    }
+
+    // Llama a 'callback(doc_id)' por cada resultado; devuelve la cantidad
+    template <typename Callback>
+    size_t for_each(const std::string& query, Callback&& callback) const {
+        auto it = compile(query);
+        size_t matches = 0;
+        for (; !it->at_end(); it->next()) {
+            callback(it->docid());
+            ++matches;
+        }
+        return matches;
+    }
+
+    std::vector<uint32_t> search(const std::string& query) const {
+        if (index.search_cache()) return *cached_search(query);
+        Metrics::Timer timer(query_latency);
+        std::vector<uint32_t> result;
+        for_each(query, [&result](uint32_t doc) { result.push_back(doc); });
+        return result;
+    }
+    
+    // Como search, sin copiar el resultado. Con la caché del índice (ver
+    // InvertedIndex::set_cache) una consulta repetida, escrita igual o en otro
+    // orden (ver canonical_query), no se vuelve a evaluar mientras el índice
+    // no cambie.
+    SearchCache::DocsPointer cached_search(const std::string& query) const {
+        Metrics::Timer timer(query_latency);
+        SearchCache* cache = index.search_cache();
+        auto root = QueryParser::parse(query);
+        std::string key = cache ? canonical_query(*root) : std::string();
+        uint64_t generation = cache ? cache->generation() : 0;
+        if (cache) {
+            if (auto cached = cache->find_result(key)) return cached;
+        }
+        std::vector<uint32_t> result;
+        for (auto it = compile(*root); !it->at_end(); it->next()) result.push_back(it->docid());
+        if (!cache) return std::make_shared<const std::vector<uint32_t>>(std::move(result));
+        return cache->store_result(key, generation, std::move(result));
+    }
+    
+    // Evalúa juntas consultas ya analizadas que llegaron a la vez. Las que son
+    // iguales según canonical_query se evalúan una sola vez, y cada término
+    // suelto que aparece en más de una se decodifica una vez para todas (con
+    // la caché del índice, además, se busca y se guarda cada resultado).
+    // Devuelve un resultado por consulta, en el mismo orden.
+    std::vector<SearchCache::DocsPointer> search_batch(const std::vector<const QueryNode*>& roots) const {
+        SearchCache* cache = index.search_cache();
+        uint64_t generation = cache ? cache->generation() : 0;
+
+        std::vector<SearchCache::DocsPointer> results(roots.size());
+        std::unordered_map<std::string, size_t> first_with_key;
+        std::vector<size_t> pending; // índices de consultas distintas sin resultado
+        std::vector<size_t> same_as(roots.size());
+        for (size_t i = 0; i < roots.size(); ++i) {
+            std::string key = canonical_query(*roots[i]);
+            auto inserted = first_with_key.emplace(key, i);
+            same_as[i] = inserted.first->second;
+            if (!inserted.second) continue;
+            if (cache) results[i] = cache->find_result(key);
+            if (!results[i]) pending.push_back(i);
+        }
+
+        std::unordered_map<std::string, size_t> uses;
+        for (size_t i : pending) {
+            std::vector<std::string> terms;
+            collect_plain_terms(*roots[i], terms);
+            std::sort(terms.begin(), terms.end());
+            terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+            for (const auto& term : terms) ++uses[term];
+        }
+        DecodedTerms decoded;
+        for (const auto& use : uses) {
+            if (use.second > 1) decoded.emplace(use.first, index.lookup(use.first));
+        }
+
+        for (size_t i : pending) {
+            std::vector<uint32_t> docs;
+            for (auto it = compile(*roots[i], &decoded); !it->at_end(); it->next()) docs.push_back(it->docid());
+            if (cache) {
+                results[i] = cache->store_result(canonical_query(*roots[i]), generation, std::move(docs));
+            } else {
+                results[i] = std::make_shared<const std::vector<uint32_t>>(std::move(docs));
+            }
+        }
+        for (size_t i = 0; i < roots.size(); ++i) results[i] = results[same_as[i]];
+        return results;
+    }
+    
+    Bm25 bm25() const {
+        return Bm25(index.doc_count(), index.avg_doc_length());
+    }
+    
+    // Términos que puntúan en top_k (los positivos, con comodines expandidos)
+    std::vector<std::string> scored_terms(const std::string& query) const {
+        std::vector<std::string> words;
+        collect_terms(*QueryParser::parse(query), words);
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        return words;
+    }
+    
+    // Top-k por BM25. Una lista de términos (a b c, o un OR de términos) se
+    // evalúa con MaxScore: al rankear, la yuxtaposición no obliga a que estén
+    // todos, como en search. Una consulta con AND/NOT explícitos o con frases
+    // filtra con el árbol booleano y puntúa cada coincidencia con sus términos
+    // positivos. Con 'stats' se puntúa con
+    // las estadísticas de toda la colección en lugar de las de este índice.
+    std::vector<ScoredDoc> top_k(const std::string& query, size_t k, const CollectionStats* stats = nullptr) const {
+        return top_k(*QueryParser::parse(query), k, stats, nullptr);
+    }
+
+    // top_k de consultas ya analizadas que llegaron a la vez, como
+    // search_batch: las iguales según canonical_query, con el mismo k y que se
+    // rankean igual (ver ranks_disjunctively: "a b" no es "a AND b") se
+    // evalúan una sola vez, cada término se busca en el léxico una vez para
+    // todo el lote y los términos sueltos que filtran más de una consulta con
+    // AND/NOT se decodifican una vez para todas. El puntaje sigue leyendo las
+    // listas comprimidas, porque MaxScore salta bloques enteros con sus cotas.
+    // Devuelve un resultado por consulta, en el mismo orden.
+    std::vector<std::vector<ScoredDoc>> top_k_batch(const std::vector<const QueryNode*>& roots,
+                                                    const std::vector<size_t>& ks) const {
+        std::vector<std::vector<ScoredDoc>> results(roots.size());
+        std::unordered_map<std::string, size_t> first_with_key;
+        std::vector<size_t> pending;
+        std::vector<size_t> same_as(roots.size());
+        for (size_t i = 0; i < roots.size(); ++i) {
+            std::string key = canonical_query(*roots[i]) + (ranks_disjunctively(*roots[i]) ? "\n|" : "\n&") +
+                              std::to_string(ks[i]);
+            auto inserted = first_with_key.emplace(key, i);
+            same_as[i] = inserted.first->second;
+            if (inserted.second) pending.push_back(i);
+        }
+
+        std::unordered_map<std::string, size_t> uses;
+        for (size_t i : pending) {
+            if (ranks_disjunctively(*roots[i])) continue; // MaxScore no usa el filtro
+            std::vector<std::string> terms;
+            collect_plain_terms(*roots[i], terms);
+            std::sort(terms.begin(), terms.end());
+            terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+            for (const auto& term : terms) ++uses[term];
+        }
+        BatchLists shared;
+        for (const auto& use : uses) {
+            if (use.second > 1) shared.decoded.emplace(use.first, index.lookup(use.first));
+        }
+
+        for (size_t i : pending) results[i] = top_k(*roots[i], ks[i], nullptr, &shared);
+        for (size_t i = 0; i < roots.size(); ++i) {
+            if (same_as[i] != i) results[i] = results[same_as[i]];
+        }
+        return results;
+    }
+    
+private:
+    // Lo que top_k_batch comparte entre las consultas del lote
+    struct BatchLists {
+        std::unordered_map<std::string, PostingListView> scored; // se llena al buscarlas
+        DecodedTerms decoded;
+    };
+
+    PostingListView scored_list(const std::string& word, BatchLists* shared) const {
+        if (!shared) return index.posting_list(word);
+        auto it = shared->scored.find(word);
+        if (it == shared->scored.end()) it = shared->scored.emplace(word, index.posting_list(word)).first;
+        return it->second;
+    }
+
+    std::vector<ScoredDoc> top_k(const QueryNode& root, size_t k, const CollectionStats* stats,
+                                 BatchLists* shared) const {
+        Metrics::Timer timer(top_k_latency);
+        Bm25 scorer = stats ? Bm25(stats->num_docs, stats->avg_length) : bm25();
+        
+        std::vector<std::string> words;
+        collect_terms(root, words);
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        
+        std::vector<ScoredTerm> terms;
+        size_t postings = 0;
+        for (const auto& word : words) {
+            ScoredTerm term;
+            term.cursor = PostingCursor(scored_list(word, shared));
+            if (term.cursor.at_end()) continue;
+            const PostingListView& list = term.cursor.view();
+            term.idf = scorer.idf(stats ? stats->df_of(word, list.count) : list.count);
+            term.max_score = scorer.upper_bound(term.idf, list.max_tf, list.min_ratio);
+            postings += list.count;
+            terms.push_back(std::move(term));
+        }
+        auto length_of = [this](uint32_t doc) { return index.doc_length(doc); };
+        // k puede venir de un cliente (QueryServer): no hay más resultados que
+        // postings de los términos, y el colector reserva k lugares
+        k = std::min(k, postings);
+        
+        if (ranks_disjunctively(root)) {
+            return maxscore_top_k(terms, k, scorer, length_of);
+        }
+        
+        TopKCollector top(k);
+        for (auto it = compile(root, shared ? &shared->decoded : nullptr); !it->at_end(); it->next()) {
+            uint32_t doc = it->docid();
+            double score = 0;
+            for (auto& term : terms) {
+                term.cursor.next_geq(doc);
+                if (term.cursor.docid() == doc) {
+                    score += scorer.score(term.idf, term.cursor.freq(), length_of(doc));
+                }
+            }
+            top.push(doc, score);
+        }
+        return top.results();
+    }
+
+    // Términos sueltos bajo ANDs y ORs (también los excluidos): los que compile
+    // puede tomar de DecodedTerms; las frases y los comodines leen sus listas
+    static void collect_plain_terms(const QueryNode& node, std::vector<std::string>& terms) {
+        if (node.type == QueryNode::Type::Term) {
+            terms.push_back(node.term);
+            return;
+        }
+        if (node.type != QueryNode::Type::And && node.type != QueryNode::Type::Or) return;
+        for (const auto& child : node.children) collect_plain_terms(*child, terms);
+        for (const auto& child : node.excluded) collect_plain_terms(*child, terms);
+    }
+    
+    // Junta los términos positivos (los de las frases y los de la expansión de
+    // los comodines)
+    void collect_terms(const QueryNode& node, std::vector<std::string>& words) const {
+        if (node.type == QueryNode::Type::Term) {
+            words.push_back(node.term);
+            return;
+        }
+        if (node.type == QueryNode::Type::Wildcard || node.type == QueryNode::Type::Fuzzy) {
+            for (auto& match : expand(node)) words.push_back(std::move(match.term));
+            return;
+        }
+        for (const auto& child : node.children) collect_terms(*child, words);
+    }
+
+    // true si el árbol es solo OR o yuxtaposición de términos, lo que top_k
+    // evalúa con MaxScore (una frase cuenta como conjunción de sus términos,
+    // un comodín como su OR)
+    static bool ranks_disjunctively(const QueryNode& node) {
+        if (node.type == QueryNode::Type::Term || node.type == QueryNode::Type::Wildcard ||
+            node.type == QueryNode::Type::Fuzzy) {
+            return true;
+        }
+        bool disjunctive = node.type == QueryNode::Type::Or || (node.type == QueryNode::Type::And && node.juxtaposed);
+        for (const auto& child : node.children) disjunctive = ranks_disjunctively(*child) && disjunctive;
+        return disjunctive;
+    }
+};
@@ -0,0 +1,185 @@
+#pragma once
+#include "Ranking.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// Protocolo binario de QueryServer. Cada mensaje es un marco: largo del cuerpo
+// (u32) y el cuerpo. Los enteros van en el orden de bytes de la máquina, que
+// es la misma de los dos lados de un socket Unix.
+//
+//   pedido:    u32 id | u8 operación | u32 k | consulta (el resto del cuerpo)
+//   respuesta: u32 id | u8 estado | contenido
+//     Ok, Search: u32 n | n × u32 doc
+//     Ok, TopK:   u32 n | n × (u32 doc, f64 puntaje)
+//     Error:      mensaje (el resto del cuerpo)
+//
+// El id lo elige el cliente y vuelve en la respuesta: en una conexión puede
+// haber varios pedidos en vuelo y las respuestas llegan en cualquier orden.
+enum class QueryOp : uint8_t { Search = 1, TopK = 2 };
+enum class QueryStatus : uint8_t { Ok = 0, Error = 1 };
+
+// Cuerpo más grande que se acepta en un pedido
+constexpr uint32_t MAX_REQUEST_BYTES = 1 << 16;
+
+struct QueryRequest {
+    uint32_t id = 0;
+    QueryOp op = QueryOp::Search;
+    uint32_t k = 0; // solo TopK
+    std::string query;
+};
+
+struct QueryResponse {
+    uint32_t id = 0;
+    QueryStatus status = QueryStatus::Ok;
+    QueryOp op = QueryOp::Search; // no viaja: el cliente lo sabe por el id
+    std::vector<uint32_t> docs;
+    std::vector<ScoredDoc> scored;
+    std::string error;
+};
+
+namespace protocol_detail {
+
+template <typename T>
+void append(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read(const char*& p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+// Empieza un marco y devuelve dónde va su largo, que completa end_frame
+inline size_t begin_frame(std::string& out) {
+    size_t at = out.size();
+    append<uint32_t>(out, 0);
+    return at;
+}
+
+inline void end_frame(std::string& out, size_t at) {
+    uint32_t bytes = static_cast<uint32_t>(out.size() - at - sizeof(uint32_t));
+    std::memcpy(&out[at], &bytes, sizeof(bytes));
+}
+
+// Cuerpo del primer marco completo de [data, data + size), o false si falta.
+// 'consumed' queda en los bytes del marco entero.
+inline bool next_frame(const char* data, size_t size, uint32_t max_bytes, const char*& body, uint32_t& bytes,
+                       size_t& consumed) {
+    if (size < sizeof(uint32_t)) return false;
+    std::memcpy(&bytes, data, sizeof(bytes));
+    if (bytes > max_bytes) throw std::runtime_error("Marco demasiado grande: " + std::to_string(bytes) + " bytes");
+    if (size - sizeof(uint32_t) < bytes) return false;
+    body = data + sizeof(uint32_t);
+    consumed = sizeof(uint32_t) + bytes;
+    return true;
+}
+
+} // namespace protocol_detail
+
+inline void append_request(std::string& out, const QueryRequest& request) {
+    using namespace protocol_detail;
+    size_t at = begin_frame(out);
+    append<uint32_t>(out, request.id);
+    append<uint8_t>(out, static_cast<uint8_t>(request.op));
+    append<uint32_t>(out, request.k);
+    out += request.query;
+    end_frame(out, at);
+}
+
+// Saca el primer pedido completo de [data, data + size); devuelve los bytes
+// que ocupaba o 0 si todavía no llegó entero. Un marco inválido lanza.
+inline size_t parse_request(const char* data, size_t size, QueryRequest& request) {
+    using namespace protocol_detail;
+    const char* p;
+    uint32_t bytes;
+    size_t consumed;
+    if (!next_frame(data, size, MAX_REQUEST_BYTES, p, bytes, consumed)) return 0;
+    const size_t header = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t);
+    if (bytes < header) throw std::runtime_error("Pedido incompleto");
+    request.id = read<uint32_t>(p);
+    uint8_t op = read<uint8_t>(p);
+    if (op != static_cast<uint8_t>(QueryOp::Search) && op != static_cast<uint8_t>(QueryOp::TopK)) {
+        throw std::runtime_error("Operación desconocida: " + std::to_string(op));
+    }
+    request.op = static_cast<QueryOp>(op);
+    request.k = read<uint32_t>(p);
+    request.query.assign(p, bytes - header);
+    return consumed;
+}
+
+inline void append_docs_response(std::string& out, uint32_t id, const std::vector<uint32_t>& docs) {
+    using namespace protocol_detail;
+    size_t at = begin_frame(out);
+    append<uint32_t>(out, id);
+    append<uint8_t>(out, static_cast<uint8_t>(QueryStatus::Ok));
+    append<uint32_t>(out, static_cast<uint32_t>(docs.size()));
+    out.append(reinterpret_cast<const char*>(docs.data()), docs.size() * sizeof(uint32_t));
+    end_frame(out, at);
+}
+
+inline void append_scored_response(std::string& out, uint32_t id, const std::vector<ScoredDoc>& scored) {
+    using namespace protocol_detail;
+    size_t at = begin_frame(out);
+    append<uint32_t>(out, id);
+    append<uint8_t>(out, static_cast<uint8_t>(QueryStatus::Ok));
+    append<uint32_t>(out, static_cast<uint32_t>(scored.size()));
+    for (const auto& doc : scored) {
+        append<uint32_t>(out, doc.doc);
+        append<double>(out, doc.score);
+    }
+    end_frame(out, at);
+}
+
+inline void append_error_response(std::string& out, uint32_t id, const std::string& message) {
+    using namespace protocol_detail;
+    size_t at = begin_frame(out);
+    append<uint32_t>(out, id);
+    append<uint8_t>(out, static_cast<uint8_t>(QueryStatus::Error));
+    out += message;
+    end_frame(out, at);
+}
+
+// Como parse_request, para una respuesta a un pedido de tipo 'op'
+inline size_t parse_response(const char* data, size_t size, QueryOp op, QueryResponse& response,
+                             uint32_t max_bytes = UINT32_MAX) {
+    using namespace protocol_detail;
+    const char* p;
+    uint32_t bytes;
+    size_t consumed;
+    if (!next_frame(data, size, max_bytes, p, bytes, consumed)) return 0;
+    const char* end = p + bytes;
+    if (bytes < sizeof(uint32_t) + sizeof(uint8_t)) throw std::runtime_error("Respuesta incompleta");
+    response.id = read<uint32_t>(p);
+    response.status = static_cast<QueryStatus>(read<uint8_t>(p));
+    response.op = op;
+    response.docs.clear();
+    response.scored.clear();
+    response.error.clear();
+    if (response.status != QueryStatus::Ok) {
+        response.error.assign(p, end);
+        return consumed;
+    }
+    if (end - p < static_cast<ptrdiff_t>(sizeof(uint32_t))) throw std::runtime_error("Respuesta incompleta");
+    uint32_t count = read<uint32_t>(p);
+    size_t entry = op == QueryOp::TopK ? sizeof(uint32_t) + sizeof(double) : sizeof(uint32_t);
+    if (static_cast<size_t>(end - p) != count * entry) throw std::runtime_error("Respuesta con largo inválido");
+    if (op == QueryOp::TopK) {
+        response.scored.resize(count);
+        for (auto& doc : response.scored) {
+            doc.doc = read<uint32_t>(p);
+            doc.score = read<double>(p);
+        }
+    } else {
+        response.docs.resize(count);
+        std::memcpy(response.docs.data(), p, count * sizeof(uint32_t));
+    }
+    return consumed;
+}
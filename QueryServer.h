@@ -0,0 +1,529 @@
+#pragma once
+#include "InvertedIndex.h"
+#include "QueryEngine.h"
+#include "QueryProtocol.h"
+#include "Metrics.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+struct QueryServerOptions {
+    std::string socket_path;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    // Pedidos que un worker toma juntos como máximo
+    size_t max_batch = 64;
+    // Con más que esto por enviar a una conexión se deja de leerla
+    size_t max_pending_output = size_t(8) << 20;
+    // Lo mismo con estos pedidos sin responder de una conexión o de todas
+    // juntas; los que ya llegaron esperan en su buffer de entrada
+    size_t max_in_flight = 1024;
+    size_t max_queued = size_t(1) << 16;
+};
+
+struct QueryServerStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t batches = 0;
+    uint64_t largest_batch = 0;
+
+    double mean_batch() const { return batches == 0 ? 0.0 : static_cast<double>(requests) / batches; }
+};
+
+// Servidor de consultas sobre un InvertedIndex ya cargado (con
+// load_from_files queda mapeado, así que arranca sin leer las listas y las
+// comparte por el page cache con quien mapee los mismos archivos). Habla el
+// protocolo de QueryProtocol.h por un socket Unix.
+//
+// Un solo hilo (el que llama a run) atiende los sockets con epoll: acepta,
+// lee, separa los pedidos y los encola, y escribe las respuestas que dejan
+// los workers. Cada worker toma de una vez todos los pedidos encolados (hasta
+// max_batch) y los evalúa como un lote con QueryEngine::search_batch y
+// QueryEngine::top_k_batch; bajo carga los pedidos se acumulan mientras los
+// workers trabajan, así que los lotes crecen solos, y con poca carga un pedido
+// no espera a otros.
+//
+// El índice no debe cambiar mientras el servidor corre.
+class QueryServer {
+public:
+    QueryServer(const InvertedIndex& index, const QueryServerOptions& options)
+        : index(index), engine(index), options(options) {
+        if (options.socket_path.empty()) throw std::runtime_error("Falta la ruta del socket");
+        if (options.max_batch == 0) throw std::runtime_error("max_batch debe ser positivo");
+        if (options.max_in_flight == 0 || options.max_queued == 0) {
+            throw std::runtime_error("max_in_flight y max_queued deben ser positivos");
+        }
+        if (Metrics* metrics = index.metrics_registry()) {
+            request_latency = &metrics->histogram("server_request");
+        }
+        // Los comodines arman el diccionario la primera vez: mejor antes de
+        // que consulten varios hilos
+        index.term_dictionary();
+    }
+
+    ~QueryServer() { close_all(); }
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // Crea el socket (reemplazando uno viejo en la misma ruta), levanta los
+    // workers y atiende hasta stop()
+    void run() {
+        open_socket();
+        for (size_t i = 0; i < options.workers; ++i) workers.emplace_back([this] { work(); });
+        try {
+            loop();
+        } catch (...) {
+            stop_workers();
+            throw;
+        }
+        stop_workers();
+        close_all();
+    }
+
+    // Se puede llamar desde otro hilo o desde un manejador de señales
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        if (wake_fd >= 0) (void)!::write(wake_fd, &one, sizeof(one));
+    }
+
+    QueryServerStats statistics() const {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return stats;
+    }
+
+    // Valores server_* en el registro de métricas
+    void record(Metrics& metrics) const {
+        QueryServerStats current = statistics();
+        metrics.set("server_connections", static_cast<double>(current.connections));
+        metrics.set("server_requests", static_cast<double>(current.requests));
+        metrics.set("server_errors", static_cast<double>(current.errors));
+        metrics.set("server_batches", static_cast<double>(current.batches));
+        metrics.set("server_mean_batch", current.mean_batch());
+        metrics.set("server_largest_batch", static_cast<double>(current.largest_batch));
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Connection {
+        int fd = -1;
+        std::string in;
+        std::string out;
+        size_t out_sent = 0;
+        size_t in_flight = 0; // pedidos encolados sin respuesta entregada
+        bool reading = true;
+        bool writing = false;
+    };
+
+    // Pedido encolado; 'connection' es el número de la conexión, que no se reusa
+    struct Work {
+        uint64_t connection;
+        QueryRequest request;
+        Clock::time_point received;
+    };
+
+    struct Reply {
+        uint64_t connection;
+        std::string bytes;
+    };
+
+    const InvertedIndex& index;
+    QueryEngine engine;
+    QueryServerOptions options;
+    LatencyHistogram* request_latency = nullptr;
+
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::atomic<bool> stopping{false};
+
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t next_connection = 1;
+    size_t in_flight = 0; // de todas las conexiones, incluidas las ya cerradas
+
+    std::mutex work_mutex;
+    std::condition_variable work_ready;
+    std::deque<Work> queue;
+    bool workers_done = false;
+    std::vector<std::thread> workers;
+
+    std::mutex reply_mutex;
+    std::vector<Reply> replies;
+
+    mutable std::mutex stats_mutex;
+    QueryServerStats stats;
+
+    // En epoll los datos llevan el número de conexión; estos dos son fijos
+    static constexpr uint64_t LISTEN_TAG = 0;
+    static constexpr uint64_t WAKE_TAG = UINT64_MAX;
+
+    static std::runtime_error system_error(const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    void open_socket() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Ruta de socket demasiado larga: " + options.socket_path);
+        }
+        std::memcpy(address.sun_path, options.socket_path.c_str(), options.socket_path.size() + 1);
+
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) throw system_error("No se pudo crear el socket");
+        ::unlink(options.socket_path.c_str());
+        if (::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            throw system_error("No se pudo usar el socket " + options.socket_path);
+        }
+        if (::listen(listen_fd, SOMAXCONN) != 0) throw system_error("No se pudo escuchar en " + options.socket_path);
+
+        epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) throw system_error("No se pudo crear epoll");
+        wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0) throw system_error("No se pudo crear el eventfd");
+        watch(listen_fd, EPOLL_CTL_ADD, EPOLLIN, LISTEN_TAG);
+        watch(wake_fd, EPOLL_CTL_ADD, EPOLLIN, WAKE_TAG);
+        // Un stop() anterior a que existiera wake_fd no pudo despertar a nadie
+        if (stopping.load(std::memory_order_acquire)) stop();
+    }
+
+    void watch(int fd, int operation, uint32_t events, uint64_t tag) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = tag;
+        if (::epoll_ctl(epoll_fd, operation, fd, &event) != 0) throw system_error("epoll_ctl falló");
+    }
+
+    void loop() {
+        std::vector<epoll_event> events(256);
+        std::vector<Work> received;
+        while (!stopping.load(std::memory_order_acquire)) {
+            int ready = ::epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                throw system_error("epoll_wait falló");
+            }
+            for (int i = 0; i < ready; ++i) {
+                uint64_t tag = events[i].data.u64;
+                if (tag == LISTEN_TAG) {
+                    accept_all();
+                } else if (tag == WAKE_TAG) {
+                    uint64_t count;
+                    while (::read(wake_fd, &count, sizeof(count)) > 0) {}
+                } else {
+                    auto it = connections.find(tag);
+                    if (it == connections.end()) continue;
+                    uint32_t flags = events[i].events;
+                    bool alive = true;
+                    if (flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) alive = read_from(tag, it->second, received);
+                    if (alive && (flags & EPOLLOUT)) alive = flush(tag, it->second);
+                    if (!alive) close_connection(tag);
+                }
+            }
+            deliver_replies(received);
+            // Lo leído en esta vuelta entra de una vez, así llega junto a los workers
+            if (!received.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock(work_mutex);
+                    for (auto& work : received) queue.push_back(std::move(work));
+                }
+                if (received.size() == 1) {
+                    work_ready.notify_one();
+                } else {
+                    work_ready.notify_all();
+                }
+                received.clear();
+            }
+        }
+    }
+
+    void accept_all() {
+        for (;;) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                // EAGAIN, o sin descriptores: se reintenta en la próxima vuelta
+                return;
+            }
+            uint64_t id = next_connection++;
+            connections[id].fd = fd;
+            watch(fd, EPOLL_CTL_ADD, EPOLLIN, id);
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            ++stats.connections;
+        }
+    }
+
+    // Lee lo disponible y separa los pedidos; false si hay que cerrarla
+    bool read_from(uint64_t id, Connection& connection, std::vector<Work>& received) {
+        char buffer[1 << 16];
+        bool open = true;
+        for (;;) {
+            ssize_t n = ::read(connection.fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                connection.in.append(buffer, static_cast<size_t>(n));
+                if (static_cast<size_t>(n) < sizeof(buffer)) break;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            open = false; // fin o error
+            break;
+        }
+
+        // Si el cliente cerró, las respuestas que falten se descartan
+        return take_requests(id, connection, received) && open;
+    }
+
+    // Si la conexión tiene lugar para pedidos nuevos (ver QueryServerOptions)
+    bool accepts_requests(const Connection& connection) const {
+        return connection.out.size() - connection.out_sent <= options.max_pending_output &&
+               connection.in_flight < options.max_in_flight && in_flight < options.max_queued;
+    }
+
+    // Separa los pedidos completos del buffer de entrada mientras la conexión
+    // tenga lugar y deja de leerla si se llenó; false si hay que cerrarla
+    bool take_requests(uint64_t id, Connection& connection, std::vector<Work>& received) {
+        Clock::time_point now = Clock::now();
+        size_t offset = 0;
+        try {
+            while (accepts_requests(connection)) {
+                Work work{id, {}, now};
+                size_t used = parse_request(connection.in.data() + offset, connection.in.size() - offset, work.request);
+                if (used == 0) break;
+                offset += used;
+                received.push_back(std::move(work));
+                ++connection.in_flight;
+                ++in_flight;
+            }
+        } catch (const std::exception&) {
+            // Un marco inválido deja la conexión desalineada: se corta
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            ++stats.errors;
+            return false;
+        }
+        connection.in.erase(0, offset);
+        update_events(id, connection);
+        return true;
+    }
+
+    // Escribe lo pendiente; false si la conexión se cortó
+    bool flush(uint64_t id, Connection& connection) {
+        while (connection.out_sent < connection.out.size()) {
+            ssize_t n = ::send(connection.fd, connection.out.data() + connection.out_sent,
+                               connection.out.size() - connection.out_sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                connection.out_sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        if (connection.out_sent == connection.out.size()) {
+            connection.out.clear();
+            connection.out_sent = 0;
+        }
+        update_events(id, connection);
+        return true;
+    }
+
+    void update_events(uint64_t id, Connection& connection) {
+        bool writing = !connection.out.empty();
+        bool reading = accepts_requests(connection);
+        if (writing == connection.writing && reading == connection.reading) return;
+        connection.writing = writing;
+        connection.reading = reading;
+        watch(connection.fd, EPOLL_CTL_MOD, (reading ? EPOLLIN : 0u) | (writing ? EPOLLOUT : 0u), id);
+    }
+
+    // Pasa las respuestas de los workers a sus conexiones. Las que se habían
+    // dejado de leer por tener la cola llena toman los pedidos de su buffer.
+    void deliver_replies(std::vector<Work>& received) {
+        std::vector<Reply> ready;
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex);
+            ready.swap(replies);
+        }
+        if (ready.empty()) return;
+        bool was_full = in_flight >= options.max_queued;
+        std::vector<uint64_t> touched, paused;
+        for (auto& reply : ready) {
+            --in_flight;
+            auto it = connections.find(reply.connection);
+            if (it == connections.end()) continue; // se cerró mientras tanto
+            Connection& connection = it->second;
+            if (connection.out.empty()) touched.push_back(reply.connection);
+            if (!connection.reading) paused.push_back(reply.connection);
+            --connection.in_flight;
+            connection.out += reply.bytes;
+        }
+        // Con la cola global llena pudo quedar sin leer cualquier conexión
+        if (was_full && in_flight < options.max_queued) {
+            for (const auto& entry : connections) {
+                if (!entry.second.reading) paused.push_back(entry.first);
+            }
+        }
+        for (uint64_t id : touched) {
+            auto it = connections.find(id);
+            if (!flush(id, it->second)) close_connection(id);
+        }
+        std::sort(paused.begin(), paused.end());
+        paused.erase(std::unique(paused.begin(), paused.end()), paused.end());
+        for (uint64_t id : paused) {
+            auto it = connections.find(id);
+            if (it == connections.end()) continue;
+            if (!take_requests(id, it->second, received)) close_connection(id);
+        }
+    }
+
+    void close_connection(uint64_t id) {
+        auto it = connections.find(id);
+        if (it == connections.end()) return;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        ::close(it->second.fd);
+        connections.erase(it);
+    }
+
+    void close_all() {
+        for (auto& entry : connections) ::close(entry.second.fd);
+        connections.clear();
+        for (int* fd : {&listen_fd, &epoll_fd, &wake_fd}) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+        if (!options.socket_path.empty()) ::unlink(options.socket_path.c_str());
+    }
+
+    void stop_workers() {
+        {
+            std::lock_guard<std::mutex> lock(work_mutex);
+            workers_done = true;
+        }
+        work_ready.notify_all();
+        for (auto& worker : workers) worker.join();
+        workers.clear();
+    }
+
+    void work() {
+        std::vector<Work> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(work_mutex);
+                work_ready.wait(lock, [this] { return workers_done || !queue.empty(); });
+                if (workers_done) return;
+                size_t take = std::min(queue.size(), options.max_batch);
+                for (size_t i = 0; i < take; ++i) {
+                    batch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+            answer(batch);
+            batch.clear();
+        }
+    }
+
+    // Evalúa un lote y deja las respuestas para el hilo de epoll
+    void answer(std::vector<Work>& batch) {
+        std::vector<std::string> out(batch.size());
+        std::vector<std::unique_ptr<QueryNode>> roots(batch.size());
+        std::vector<const QueryNode*> searches, rankings;
+        std::vector<size_t> search_at, ranking_at, ks;
+        uint64_t errors = 0;
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const QueryRequest& request = batch[i].request;
+            try {
+                roots[i] = QueryParser::parse(request.query);
+                if (request.op == QueryOp::TopK) {
+                    rankings.push_back(roots[i].get());
+                    ranking_at.push_back(i);
+                    ks.push_back(request.k);
+                } else {
+                    searches.push_back(roots[i].get());
+                    search_at.push_back(i);
+                }
+            } catch (const std::exception& e) {
+                append_error_response(out[i], request.id, e.what());
+                ++errors;
+            }
+        }
+        // Una consulta que falla al evaluarse (una frase sin posiciones) no
+        // tiene que arrastrar al resto del lote: se reintentan de a una
+        if (!searches.empty()) {
+            try {
+                auto results = engine.search_batch(searches);
+                for (size_t j = 0; j < results.size(); ++j) {
+                    append_docs_response(out[search_at[j]], batch[search_at[j]].request.id, *results[j]);
+                }
+            } catch (const std::exception&) {
+                for (size_t i : search_at) {
+                    try {
+                        append_docs_response(out[i], batch[i].request.id, *engine.cached_search(batch[i].request.query));
+                    } catch (const std::exception& e) {
+                        append_error_response(out[i], batch[i].request.id, e.what());
+                        ++errors;
+                    }
+                }
+            }
+        }
+        if (!rankings.empty()) {
+            try {
+                auto results = engine.top_k_batch(rankings, ks);
+                for (size_t j = 0; j < results.size(); ++j) {
+                    append_scored_response(out[ranking_at[j]], batch[ranking_at[j]].request.id, results[j]);
+                }
+            } catch (const std::exception&) {
+                for (size_t i : ranking_at) {
+                    const QueryRequest& request = batch[i].request;
+                    try {
+                        append_scored_response(out[i], request.id, engine.top_k(request.query, request.k));
+                    } catch (const std::exception& e) {
+                        append_error_response(out[i], request.id, e.what());
+                        ++errors;
+                    }
+                }
+            }
+        }
+
+        Clock::time_point done = Clock::now();
+        if (request_latency) {
+            for (const auto& work : batch) {
+                request_latency->record(std::chrono::duration<double>(done - work.received).count());
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex);
+            for (size_t i = 0; i < batch.size(); ++i) replies.push_back({batch[i].connection, std::move(out[i])});
+        }
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.requests += batch.size();
+            stats.errors += errors;
+            ++stats.batches;
+            stats.largest_batch = std::max<uint64_t>(stats.largest_batch, batch.size());
+        }
+        uint64_t one = 1;
+        (void)!::write(wake_fd, &one, sizeof(one));
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include "PostingList.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Parámetros y fórmula de BM25. Una longitud 0 (desconocida) se puntúa como
+// un documento de longitud promedio; como cota, 0 da el puntaje máximo.
+struct Bm25 {
+    double k1 = 1.2;
+    double b = 0.75;
+    double num_docs = 1;
+    double avg_length = 1;
+
+    Bm25(double num_docs, double avg_length)
+        : num_docs(std::max(num_docs, 1.0)), avg_length(avg_length > 0 ? avg_length : 1.0) {}
+
+    double idf(uint32_t df) const {
+        return std::log(1.0 + (num_docs - df + 0.5) / (df + 0.5));
+    }
+
+    double score(double idf, uint32_t tf, uint32_t length) const {
+        double norm = k1 * (1 - b + b * (length == 0 ? avg_length : length) / avg_length);
+        return idf * tf * (k1 + 1) / (tf + norm);
+    }
+
+    // score = idf (k1+1) / (1 + k1 (1-b) / tf + k1 b (longitud / tf) / avg):
+    // decrece al bajar tf o subir longitud/tf, así que el tf máximo y la razón
+    // mínima de un bloque dan una cota válida aunque vengan de documentos distintos
+    double upper_bound(double idf, uint32_t max_tf, uint32_t min_ratio) const {
+        if (max_tf == 0) return 0;
+        double ratio = static_cast<double>(min_ratio) / RATIO_SCALE;
+        return idf * (k1 + 1) / (1 + k1 * (1 - b) / max_tf + k1 * b * ratio / avg_length);
+    }
+};
+
+// Estadísticas de una colección repartida en varios índices (segmentos,
+// shards). Puntuar cada parte con las globales hace comparables sus puntajes.
+struct CollectionStats {
+    uint32_t num_docs = 0;
+    double avg_length = 0;
+    std::unordered_map<std::string, uint32_t> df; // de los términos de la consulta
+
+    uint32_t df_of(const std::string& term, uint32_t local_df) const {
+        auto it = df.find(term);
+        return it == df.end() ? local_df : it->second;
+    }
+};
+
+struct ScoredDoc {
+    uint32_t doc;
+    double score;
+};
+
+// Min-heap con los k mejores; threshold() es el puntaje a superar
+class TopKCollector {
+private:
+    size_t k;
+    std::vector<ScoredDoc> heap;
+
+    static bool better(const ScoredDoc& a, const ScoredDoc& b) {
+        return a.score > b.score || (a.score == b.score && a.doc < b.doc);
+    }
+
+public:
+    explicit TopKCollector(size_t k) : k(k) { heap.reserve(k + 1); }
+
+    bool full() const { return heap.size() >= k; }
+    double threshold() const { return full() && k > 0 ? heap.front().score : 0.0; }
+
+    void push(uint32_t doc, double score) {
+        if (k == 0) return;
+        if (full() && score <= threshold()) return;
+        heap.push_back({doc, score});
+        std::push_heap(heap.begin(), heap.end(), better);
+        if (heap.size() > k) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.pop_back();
+        }
+    }
+
+    // Resultados de mayor a menor puntaje
+    std::vector<ScoredDoc> results() const {
+        std::vector<ScoredDoc> sorted(heap);
+        std::sort(sorted.begin(), sorted.end(), better);
+        return sorted;
+    }
+};
+
+// Término de una consulta rankeada: cursor, idf y cota global de puntaje
+struct ScoredTerm {
+    PostingCursor cursor;
+    double idf = 0;
+    double max_score = 0;
+};
+
+// Top-k disyuntivo con MaxScore y cotas por bloque.
+// Los términos se ordenan por cota; los de menor cota cuya suma no supera el
+// umbral son "no esenciales": solo se consultan para completar el puntaje de
+// candidatos que salen de los esenciales, y se descartan con la cota del bloque
+// que contendría al candidato antes de decodificarlo. Cuando la suma de las cotas
+// de los bloques actuales tampoco alcanza el umbral, se saltan bloques completos.
+template <typename LengthOf>
+std::vector<ScoredDoc> maxscore_top_k(std::vector<ScoredTerm>& terms, size_t k, const Bm25& bm25,
+                                      LengthOf doc_length) {
+    TopKCollector top(k);
+    std::sort(terms.begin(), terms.end(),
+              [](const ScoredTerm& a, const ScoredTerm& b) { return a.max_score < b.max_score; });
+
+    size_t n = terms.size();
+    std::vector<double> prefix(n);
+    for (size_t i = 0; i < n; ++i) prefix[i] = terms[i].max_score + (i ? prefix[i - 1] : 0);
+
+    auto block_score = [&](const ScoredTerm& t, const BlockBound& bb) {
+        return bm25.upper_bound(t.idf, bb.max_tf, bb.min_ratio);
+    };
+
+    size_t first_essential = 0;
+    while (first_essential < n) {
+        uint32_t candidate = PostingCursor::END;
+        for (size_t i = first_essential; i < n; ++i) candidate = std::min(candidate, terms[i].cursor.docid());
+        if (candidate == PostingCursor::END) break;
+
+        double non_essential = first_essential ? prefix[first_essential - 1] : 0;
+
+        // Cota con los bloques de los esenciales que cubren 'pivot'; mientras no
+        // alcance el umbral se avanza región por región sin decodificar bloques
+        if (top.full()) {
+            uint32_t pivot = candidate;
+            bool exhausted = false;
+            while (true) {
+                double bound = non_essential;
+                uint32_t region_end = PostingCursor::END;
+                for (size_t i = first_essential; i < n; ++i) {
+                    BlockBound bb = terms[i].cursor.block_bound_for(pivot);
+                    if (bb.last == PostingCursor::END) continue;
+                    bound += block_score(terms[i], bb);
+                    region_end = std::min(region_end, bb.last);
+                }
+                if (region_end == PostingCursor::END || (bound <= top.threshold() && region_end >= PostingCursor::END - 1)) {
+                    exhausted = true;
+                    break;
+                }
+                if (bound > top.threshold()) break;
+                pivot = region_end + 1;
+            }
+            if (exhausted) break;
+            if (pivot != candidate) {
+                for (size_t i = first_essential; i < n; ++i) terms[i].cursor.next_geq(pivot);
+                continue;
+            }
+        }
+
+        double score = 0;
+        for (size_t i = first_essential; i < n; ++i) {
+            PostingCursor& c = terms[i].cursor;
+            if (c.docid() == candidate) {
+                score += bm25.score(terms[i].idf, c.freq(), doc_length(candidate));
+                c.next();
+            }
+        }
+
+        bool pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            double rest = i ? prefix[i - 1] : 0;
+            if (top.full() && score + terms[i].max_score + rest <= top.threshold()) {
+                pruned = true;
+                break;
+            }
+            PostingCursor& c = terms[i].cursor;
+            BlockBound bb = c.block_bound_for(candidate);
+            if (bb.last == PostingCursor::END) continue;
+            if (top.full() && score + block_score(terms[i], bb) + rest <= top.threshold()) {
+                pruned = true;
+                break;
+            }
+            c.next_geq(candidate);
+            if (c.docid() == candidate) score += bm25.score(terms[i].idf, c.freq(), doc_length(candidate));
+        }
+
+        if (!pruned) top.push(candidate, score);
+        if (top.full()) {
+            while (first_essential < n && prefix[first_essential] <= top.threshold()) ++first_essential;
+        }
+    }
+
+    return top.results();
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include "Metrics.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+// Contadores de una caché; entries y bytes son lo que ocupa ahora
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+
+    double hit_rate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses); }
+};
+
+// Caché LRU con tope de bytes, partida en shards con su propio mutex para que
+// las consultas de varios hilos casi nunca compitan por el mismo. Los valores
+// se comparten (shared_ptr a const): lo que devuelve get() sigue valiendo
+// aunque la entrada se desaloje o se invalide mientras alguien la usa.
+// Cada shard tiene capacity / shards bytes; un valor más grande no se guarda.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache {
+public:
+    using Pointer = std::shared_ptr<const Value>;
+
+    // Lo que se cobra por entrada además de su valor (nodos de la lista y del mapa)
+    static constexpr size_t ENTRY_OVERHEAD = 96;
+
+    explicit ShardedLruCache(size_t capacity_bytes, size_t shard_count = 16)
+        : shards(std::max<size_t>(shard_count, 1)) {
+        for (Shard& shard : shards) shard.capacity = capacity_bytes / shards.size();
+    }
+
+    ShardedLruCache(const ShardedLruCache&) = delete;
+    ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+
+    // El valor de 'key' (y lo pasa al frente), o nullptr
+    Pointer get(const Key& key) {
+        Shard& shard = shard_of(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            ++shard.stats.misses;
+            return nullptr;
+        }
+        ++shard.stats.hits;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->value;
+    }
+
+    // Guarda o reemplaza 'key'; 'bytes' es lo que ocupa el valor
+    void put(const Key& key, Pointer value, size_t bytes) {
+        Shard& shard = shard_of(key);
+        bytes += ENTRY_OVERHEAD;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) remove(shard, it->second);
+        if (bytes > shard.capacity) return;
+        shard.lru.push_front(Entry{key, std::move(value), bytes});
+        shard.index.emplace(key, shard.lru.begin());
+        shard.stats.bytes += bytes;
+        ++shard.stats.entries;
+        ++shard.stats.insertions;
+        while (shard.stats.bytes > shard.capacity) {
+            remove(shard, std::prev(shard.lru.end()));
+            ++shard.stats.evictions;
+        }
+    }
+
+    void erase(const Key& key) {
+        Shard& shard = shard_of(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) return;
+        remove(shard, it->second);
+        ++shard.stats.invalidations;
+    }
+
+    void clear() {
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.stats.invalidations += shard.lru.size();
+            shard.lru.clear();
+            shard.index.clear();
+            shard.stats.entries = 0;
+            shard.stats.bytes = 0;
+        }
+    }
+
+    // Suma de los contadores de todos los shards
+    CacheStats statistics() const {
+        CacheStats total;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total.hits += shard.stats.hits;
+            total.misses += shard.stats.misses;
+            total.insertions += shard.stats.insertions;
+            total.evictions += shard.stats.evictions;
+            total.invalidations += shard.stats.invalidations;
+            total.entries += shard.stats.entries;
+            total.bytes += shard.stats.bytes;
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Pointer value;
+        size_t bytes;
+    };
+    using Iterator = typename std::list<Entry>::iterator;
+
+    // Cada shard en su línea de caché para que los mutex no compartan una
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // el más reciente adelante
+        std::unordered_map<Key, Iterator, Hash> index;
+        size_t capacity = 0;
+        CacheStats stats;
+    };
+
+    std::vector<Shard> shards;
+    Hash hasher;
+
+    Shard& shard_of(const Key& key) {
+        // Los bits altos mezclados: con std::hash de enteros el hash es el valor
+        uint64_t h = static_cast<uint64_t>(hasher(key)) * 0x9E3779B97F4A7C15ull;
+        return shards[(h >> 32) % shards.size()];
+    }
+
+    static void remove(Shard& shard, Iterator entry) {
+        shard.stats.bytes -= entry->bytes;
+        --shard.stats.entries;
+        shard.index.erase(entry->key);
+        shard.lru.erase(entry);
+    }
+};
+
+struct SearchCacheOptions {
+    size_t posting_bytes = size_t(64) << 20;
+    size_t result_bytes = size_t(16) << 20;
+    size_t shards = 16;
+};
+
+// Cachés de búsqueda de un InvertedIndex (ver InvertedIndex::set_cache):
+//   - listas decodificadas por term ID, para InvertedIndex::search y lookup;
+//   - resultados de QueryEngine::search por consulta normalizada.
+// Cuando el índice cambia la lista de un término la saca de la primera y sube
+// la generación; un resultado calculado en una generación anterior cuenta
+// como fallo y se recalcula, así que nunca se devuelve uno viejo. Las claves
+// son IDs de un índice: una caché no se comparte entre índices.
+//
+// Leer desde varios hilos es seguro. Como el índice, no admite cambios
+// mientras otros hilos consultan.
+class SearchCache {
+public:
+    using Docs = std::vector<uint32_t>;
+    using DocsPointer = std::shared_ptr<const Docs>;
+
+    explicit SearchCache(const SearchCacheOptions& options = {})
+        : postings(options.posting_bytes, options.shards), results(options.result_bytes, options.shards) {}
+
+    SearchCache(const SearchCache&) = delete;
+    SearchCache& operator=(const SearchCache&) = delete;
+
+    DocsPointer find_postings(uint32_t term_id) { return postings.get(term_id); }
+
+    void store_postings(uint32_t term_id, DocsPointer docs) {
+        size_t bytes = docs->capacity() * sizeof(uint32_t);
+        postings.put(term_id, std::move(docs), bytes);
+    }
+
+    // Resultado de 'query' (ya normalizada) si se calculó en la generación actual
+    DocsPointer find_result(const std::string& query) {
+        auto cached = results.get(query);
+        if (!cached) return nullptr;
+        if (cached->generation != generation()) {
+            stale.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return DocsPointer(cached, &cached->docs);
+    }
+
+    // 'computed_at' es generation() leída antes de evaluar la consulta
+    DocsPointer store_result(const std::string& query, uint64_t computed_at, Docs docs) {
+        auto entry = std::make_shared<Result>();
+        entry->generation = computed_at;
+        entry->docs = std::move(docs);
+        DocsPointer out(entry, &entry->docs);
+        results.put(query, entry, query.size() + entry->docs.capacity() * sizeof(uint32_t));
+        return out;
+    }
+
+    uint64_t generation() const { return current.load(std::memory_order_acquire); }
+
+    // El índice cambió la lista de 'term_id'
+    void invalidate_term(uint32_t term_id) {
+        postings.erase(term_id);
+        current.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    // El índice se reemplazó entero (por ejemplo, al cargarlo de disco)
+    void clear() {
+        postings.clear();
+        results.clear();
+        current.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    CacheStats posting_statistics() const { return postings.statistics(); }
+
+    // Los resultados viejos descartados cuentan como invalidaciones
+    CacheStats result_statistics() const {
+        CacheStats stats = results.statistics();
+        uint64_t discarded = stale.load(std::memory_order_relaxed);
+        stats.hits -= std::min(stats.hits, discarded);
+        stats.misses += discarded;
+        stats.invalidations += discarded;
+        return stats;
+    }
+
+    // Valores posting_cache_* y result_cache_* en el registro de métricas
+    void record(Metrics& metrics) const {
+        record_stats(metrics, "posting_cache_", posting_statistics());
+        record_stats(metrics, "result_cache_", result_statistics());
+    }
+
+private:
+    struct Result {
+        uint64_t generation = 0;
+        Docs docs;
+    };
+
+    ShardedLruCache<uint32_t, Docs> postings;
+    ShardedLruCache<std::string, Result> results;
+    std::atomic<uint64_t> current{0};
+    std::atomic<uint64_t> stale{0};
+
+    static void record_stats(Metrics& metrics, const std::string& prefix, const CacheStats& stats) {
+        metrics.set(prefix + "hits", static_cast<double>(stats.hits));
+        metrics.set(prefix + "misses", static_cast<double>(stats.misses));
+        metrics.set(prefix + "hit_rate", stats.hit_rate());
+        metrics.set(prefix + "evictions", static_cast<double>(stats.evictions));
+        metrics.set(prefix + "invalidations", static_cast<double>(stats.invalidations));
+        metrics.set(prefix + "entries", static_cast<double>(stats.entries));
+        metrics.set(prefix + "bytes", static_cast<double>(stats.bytes));
+    }
+};
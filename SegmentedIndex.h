@@ -0,0 +1,515 @@
+#pragma once
+#include "InvertedIndex.h"
+#include "IndexWriter.h"
+#include "IndexFileWriter.h"
+#include "QueryEngine.h"
+#include "Ranking.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+struct SegmentOptions {
+    CodecType codec = CodecType::Gamma;
+    bool positional = false;
+    // Postings en el buffer de escritura antes de volcarlo a un segmento nuevo
+    size_t flush_postings = size_t(1) << 20;
+    // Segmentos de un mismo nivel que se fusionan juntos; el nivel de un
+    // segmento es cuántas veces entra merge_factor entre base_bytes y su tamaño
+    size_t merge_factor = 4;
+    size_t base_bytes = size_t(1) << 20;
+    // Sin hilo de fusión, las fusiones corren dentro de flush()
+    bool background_merges = true;
+};
+
+// InvertedIndex que ya no cambia una vez que lo ven las consultas (un
+// segmento de SegmentedIndex, una parte de ConcurrentIndex)
+struct ImmutableIndex {
+    InvertedIndex index;
+
+    explicit ImmutableIndex(CodecType codec, bool positional = false) : index(codec, positional) {}
+
+    // Los tries de comodines se arman una sola vez aunque consulten varios hilos
+    void prepare_dictionary() const {
+        std::call_once(dictionary_once, [this] { index.term_dictionary(); });
+    }
+
+private:
+    mutable std::once_flag dictionary_once;
+};
+
+// Los índices de 'parts', con los diccionarios armados si la consulta los usa
+template <typename Part>
+std::vector<const InvertedIndex*> prepared_indexes(const std::vector<std::shared_ptr<const Part>>& parts,
+                                                 const std::string& query) {
+    bool expands = query.find_first_of("*~") != std::string::npos;
+    std::vector<const InvertedIndex*> indexes;
+    for (const auto& part : parts) {
+        if (expands) part->prepare_dictionary();
+        indexes.push_back(&part->index);
+    }
+    return indexes;
+}
+
+// Fusión por niveles: el nivel de una parte es cuántas veces entra
+// merge_factor entre 'base' y su tamaño, que da size(part) (bytes, postings).
+// Devuelve las merge_factor partes más chicas del nivel más bajo que tenga al
+// menos esa cantidad; vacío si no hay nada que fusionar.
+template <typename Part, typename Size>
+std::vector<std::shared_ptr<const Part>> pick_tiered_merge(const std::vector<std::shared_ptr<const Part>>& parts,
+                                                           size_t base, size_t merge_factor, Size&& size) {
+    std::vector<std::vector<std::shared_ptr<const Part>>> levels;
+    for (const auto& part : parts) {
+        size_t level = 0;
+        for (double limit = static_cast<double>(base); size(*part) > limit; limit *= merge_factor) ++level;
+        if (level >= levels.size()) levels.resize(level + 1);
+        levels[level].push_back(part);
+    }
+    for (auto& level : levels) {
+        if (level.size() < merge_factor) continue;
+        std::sort(level.begin(), level.end(), [&size](const auto& a, const auto& b) { return size(*a) < size(*b); });
+        level.resize(merge_factor);
+        return level;
+    }
+    return {};
+}
+
+// Segmento inmutable: un InvertedIndex guardado con save_to_files y mapeado
+struct Segment : ImmutableIndex {
+    uint32_t id;
+    size_t bytes; // tamaño de sus dos archivos
+
+    Segment(uint32_t id, const std::string& lexicon_file, const std::string& docids_file,
+            const SegmentOptions& options)
+        : ImmutableIndex(options.codec, options.positional), id(id) {
+        index.load_from_files(lexicon_file, docids_file);
+        bytes = std::filesystem::file_size(lexicon_file) + std::filesystem::file_size(docids_file);
+    }
+};
+
+// Índice en segmentos para indexar y consultar a la vez. Los documentos nuevos
+// se acumulan en un buffer en memoria y al llenarse se vuelcan a un segmento
+// nuevo, que ya no cambia. Un hilo de fondo fusiona los segmentos por niveles:
+// cuando un nivel junta merge_factor segmentos se fusionan en uno del nivel
+// siguiente, así que cada posting se reescribe O(log(total / base_bytes)) veces
+// y la cantidad de segmentos (y de listas que lee una consulta) queda acotada.
+//
+// Las consultas recorren los segmentos vivos en el momento de empezar; los
+// documentos del buffer aparecen al hacer flush(). Los doc IDs deben ser
+// únicos en todo el índice. add_document y flush se llaman desde un solo
+// hilo; search y top_k desde cualquiera.
+//
+// En 'directory' quedan seg_NNNNNN.lex / seg_NNNNNN.docs por segmento y el
+// manifiesto 'segments' (siguiente ID y los IDs vivos), que se reemplaza
+// entero en cada cambio: al abrir se cargan los segmentos que lista.
+class SegmentedIndex {
+public:
+    using SegmentList = std::vector<std::shared_ptr<const Segment>>;
+
+    explicit SegmentedIndex(const std::string& directory, const SegmentOptions& options = {})
+        : directory(directory), options(options) {
+        if (options.merge_factor < 2) {
+            throw std::runtime_error("merge_factor debe ser al menos 2");
+        }
+        std::filesystem::create_directories(directory);
+        load_manifest();
+        reset_buffer();
+        if (options.background_merges) merger = std::thread([this] { merge_loop(); });
+    }
+
+    // Los documentos del buffer que no se volcaron se pierden: llamar a flush() antes
+    ~SegmentedIndex() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        merge_wakeup.notify_all();
+        if (merger.joinable()) merger.join();
+    }
+
+    SegmentedIndex(const SegmentedIndex&) = delete;
+    SegmentedIndex& operator=(const SegmentedIndex&) = delete;
+
+    void add_document(uint32_t doc_id, const std::vector<std::string>& terms) {
+        writer->add_document(doc_id, terms);
+        if (writer->pending_postings() >= options.flush_postings) flush();
+    }
+
+    // Vuelca el buffer a un segmento nuevo y lo hace visible a las consultas
+    void flush() {
+        rethrow_merge_error();
+        if (writer->pending_documents() > 0) {
+            writer->flush();
+            uint32_t id = allocate_id();
+            buffer->save_to_files(lexicon_path(id), docids_path(id));
+            auto segment = std::make_shared<const Segment>(id, lexicon_path(id), docids_path(id), options);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                SegmentList next = *segments;
+                next.push_back(segment);
+                publish(std::make_shared<const SegmentList>(std::move(next)));
+                bytes_flushed += segment->bytes;
+                bytes_written += segment->bytes;
+            }
+            reset_buffer();
+        }
+        if (options.background_merges) {
+            merge_wakeup.notify_all();
+        } else {
+            while (merge_once()) {}
+        }
+    }
+
+    // Espera a que el hilo de fondo no tenga fusiones pendientes
+    void wait_for_merges() {
+        std::unique_lock<std::mutex> lock(mutex);
+        merge_idle.wait(lock, [this] { return merge_error || (!merging && pick_merge().empty()); });
+        lock.unlock();
+        rethrow_merge_error();
+    }
+
+    // Segmentos vivos en este momento; siguen válidos aunque después se fusionen
+    std::shared_ptr<const SegmentList> snapshot() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return segments;
+    }
+
+    size_t segment_count() const { return snapshot()->size(); }
+
+    // Bytes escritos (segmentos volcados y fusionados) por byte volcado
+    double write_amplification() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytes_flushed == 0 ? 0.0 : static_cast<double>(bytes_written) / bytes_flushed;
+    }
+
+    size_t merge_count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return merges;
+    }
+
+    // Consulta booleana (sintaxis de QueryEngine) sobre todos los segmentos
+    std::vector<uint32_t> search(const std::string& query) const {
+        return search_all(prepared_indexes(*snapshot(), query), query);
+    }
+
+    // Top-k por BM25 con las estadísticas de todos los segmentos, así que el
+    // puntaje de un documento no depende de en qué segmento quedó
+    std::vector<ScoredDoc> top_k(const std::string& query, size_t k) const {
+        return top_k_all(prepared_indexes(*snapshot(), query), query, k);
+    }
+
+    // search sobre índices con docs disjuntos; si la consulta tiene comodines
+    // sus diccionarios ya deben estar armados (ver InvertedIndex::term_dictionary)
+    static std::vector<uint32_t> search_all(const std::vector<const InvertedIndex*>& indexes,
+                                            const std::string& query) {
+        std::vector<uint32_t> result;
+        for (const InvertedIndex* index : indexes) {
+            std::vector<uint32_t> part = QueryEngine(*index).search(query);
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // top_k sobre índices con docs disjuntos, con las mismas condiciones
+    static std::vector<ScoredDoc> top_k_all(const std::vector<const InvertedIndex*>& indexes,
+                                            const std::string& query, size_t k) {
+        CollectionStats stats;
+        double total_length = 0;
+        std::vector<std::string> words;
+        for (const InvertedIndex* index : indexes) {
+            stats.num_docs += index->doc_count();
+            total_length += index->avg_doc_length() * index->doc_count();
+            std::vector<std::string> part = QueryEngine(*index).scored_terms(query);
+            words.insert(words.end(), part.begin(), part.end());
+        }
+        stats.avg_length = stats.num_docs == 0 ? 0.0 : total_length / stats.num_docs;
+        for (const auto& word : words) {
+            if (stats.df.count(word)) continue;
+            uint32_t df = 0;
+            for (const InvertedIndex* index : indexes) df += index->posting_list(word).count;
+            stats.df[word] = df;
+        }
+
+        std::vector<ScoredDoc> result;
+        for (const InvertedIndex* index : indexes) {
+            std::vector<ScoredDoc> part = QueryEngine(*index).top_k(query, k, &stats);
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        std::sort(result.begin(), result.end(), [](const ScoredDoc& a, const ScoredDoc& b) {
+            return a.score > b.score || (a.score == b.score && a.doc < b.doc);
+        });
+        if (result.size() > k) result.resize(k);
+        return result;
+    }
+
+    // Fusión k-way en memoria: como merge_into con un IndexFileWriter, pero
+    // arma 'out'. Los léxicos de 'inputs' no deben tener términos sin pasar a
+    // bloques (ver InvertedIndex::flush_lexicon); el de 'out' queda sin ninguno
+    static void merge_into(const std::vector<const InvertedIndex*>& inputs, InvertedIndex& out) {
+        for (const InvertedIndex* input : inputs) {
+            input->for_each_doc_length([&out](uint32_t doc, uint32_t length) {
+                out.add_document_length(doc, length);
+            });
+        }
+        std::string term;
+        std::vector<uint32_t> docs, tfs, positions;
+        bool in_term = false;
+        auto end_term = [&] {
+            if (in_term) out.add_term_postings(term, docs, tfs, positions);
+        };
+        merge_postings(
+            inputs,
+            [&](const std::string& next) {
+                end_term();
+                term = next;
+                in_term = true;
+                docs.clear();
+                tfs.clear();
+                positions.clear();
+            },
+            [&](uint32_t doc, uint32_t tf, const uint32_t* doc_positions) {
+                docs.push_back(doc);
+                tfs.push_back(tf);
+                if (doc_positions) positions.insert(positions.end(), doc_positions, doc_positions + tf);
+            });
+        end_term();
+        out.flush_lexicon();
+    }
+
+    // Fusión k-way a disco: los términos van a 'out' a medida que salen, así
+    // que en memoria queda un bloque por índice de entrada y no el índice
+    // fusionado. 'out' debe tener las longitudes de merged_doc_lengths(inputs)
+    // y las mismas condiciones sobre los léxicos; queda sin llamar a finish()
+    static void merge_into(const std::vector<const InvertedIndex*>& inputs, IndexFileWriter& out) {
+        merge_postings(
+            inputs, [&out](const std::string& term) { out.begin_term(term); },
+            [&out](uint32_t doc, uint32_t tf, const uint32_t* positions) { out.add_posting(doc, tf, positions); });
+    }
+
+    // Longitudes de documento de todos los 'inputs', indexadas por doc ID
+    static std::vector<uint32_t> merged_doc_lengths(const std::vector<const InvertedIndex*>& inputs) {
+        std::vector<uint32_t> lengths;
+        for (const InvertedIndex* input : inputs) {
+            input->for_each_doc_length([&lengths](uint32_t doc, uint32_t length) {
+                if (doc >= lengths.size()) lengths.resize(size_t(doc) + 1, 0);
+                lengths[doc] = length;
+            });
+        }
+        return lengths;
+    }
+
+private:
+    std::string directory;
+    SegmentOptions options;
+
+    mutable std::mutex mutex;
+    std::shared_ptr<const SegmentList> segments = std::make_shared<const SegmentList>();
+    uint32_t next_id = 0;
+    size_t bytes_flushed = 0;
+    size_t bytes_written = 0;
+    size_t merges = 0;
+
+    std::unique_ptr<IndexWriter> writer;
+    std::unique_ptr<InvertedIndex> buffer;
+
+    std::thread merger;
+    std::condition_variable merge_wakeup;
+    std::condition_variable merge_idle;
+    bool stopping = false;
+    bool merging = false;
+    std::exception_ptr merge_error;
+
+    std::string segment_path(uint32_t id) const {
+        std::ostringstream name;
+        name << "seg_" << std::setw(6) << std::setfill('0') << id;
+        return (std::filesystem::path(directory) / name.str()).string();
+    }
+    std::string lexicon_path(uint32_t id) const { return segment_path(id) + ".lex"; }
+    std::string docids_path(uint32_t id) const { return segment_path(id) + ".docs"; }
+    std::string manifest_path() const { return (std::filesystem::path(directory) / "segments").string(); }
+
+    // Recorre los léxicos de 'inputs' en orden en paralelo y por cada término
+    // llama a begin_term(term) y después a add_posting(doc, tf, posiciones)
+    // por cada posting de sus listas, en orden de doc (los índices no
+    // comparten docs). Las posiciones son nulas si los índices no las tienen.
+    template <typename BeginTerm, typename AddPosting>
+    static void merge_postings(const std::vector<const InvertedIndex*>& inputs, BeginTerm&& begin_term,
+                               AddPosting&& add_posting) {
+        std::vector<FrontCodeLexicon::Cursor> cursors;
+        for (const InvertedIndex* input : inputs) cursors.push_back(input->term_cursor());
+        auto later = [&cursors](size_t a, size_t b) { return cursors[a].term() > cursors[b].term(); };
+        std::vector<size_t> heap;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            if (!cursors[i].at_end()) heap.push_back(i);
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        // Listas del término en curso, fusionadas por doc con otro heap
+        struct Source {
+            PostingCursor cursor;
+            PositionReader reader;
+        };
+        std::vector<Source> sources;
+        auto later_doc = [&sources](size_t a, size_t b) {
+            return sources[a].cursor.docid() > sources[b].cursor.docid();
+        };
+        std::vector<size_t> doc_heap;
+        while (!heap.empty()) {
+            std::string term = cursors[heap.front()].term();
+            sources.clear();
+            while (!heap.empty() && cursors[heap.front()].term() == term) {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                size_t i = heap.back();
+                const InvertedIndex& index = *inputs[i];
+                sources.push_back({PostingCursor(index.posting_list(cursors[i].id())),
+                                   PositionReader(index.position_list(cursors[i].id()))});
+                cursors[i].next();
+                if (cursors[i].at_end()) {
+                    heap.pop_back();
+                } else {
+                    std::push_heap(heap.begin(), heap.end(), later);
+                }
+            }
+
+            begin_term(term);
+            doc_heap.clear();
+            for (size_t s = 0; s < sources.size(); ++s) {
+                if (!sources[s].cursor.at_end()) doc_heap.push_back(s);
+            }
+            std::make_heap(doc_heap.begin(), doc_heap.end(), later_doc);
+            while (!doc_heap.empty()) {
+                std::pop_heap(doc_heap.begin(), doc_heap.end(), later_doc);
+                Source& source = sources[doc_heap.back()];
+                const uint32_t* positions = nullptr;
+                if (!source.reader.empty()) {
+                    size_t count;
+                    positions = source.reader.positions(source.cursor, count);
+                }
+                add_posting(source.cursor.docid(), source.cursor.freq(), positions);
+                source.cursor.next();
+                if (source.cursor.at_end()) {
+                    doc_heap.pop_back();
+                } else {
+                    std::push_heap(doc_heap.begin(), doc_heap.end(), later_doc);
+                }
+            }
+        }
+    }
+
+    void reset_buffer() {
+        writer.reset();
+        buffer = std::make_unique<InvertedIndex>(options.codec, options.positional);
+        writer = std::make_unique<IndexWriter>(*buffer, SIZE_MAX);
+        writer->set_auto_compact(false);
+    }
+
+    uint32_t allocate_id() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return next_id++;
+    }
+
+    void load_manifest() {
+        std::ifstream in(manifest_path());
+        if (!in) return;
+        SegmentList live;
+        uint32_t id;
+        in >> next_id;
+        while (in >> id) {
+            live.push_back(std::make_shared<const Segment>(id, lexicon_path(id), docids_path(id), options));
+        }
+        segments = std::make_shared<const SegmentList>(std::move(live));
+    }
+
+    // Con 'mutex' tomado: reemplaza la lista viva y reescribe el manifiesto
+    void publish(std::shared_ptr<const SegmentList> next) {
+        replace_file(manifest_path(), [&](std::ofstream& out) {
+            out << next_id << "\n";
+            for (const auto& segment : *next) out << segment->id << "\n";
+        });
+        segments = std::move(next);
+    }
+
+    // Con 'mutex' tomado: los segmentos a fusionar según pick_tiered_merge
+    SegmentList pick_merge() const {
+        return pick_tiered_merge(*segments, options.base_bytes, options.merge_factor,
+                                 [](const Segment& segment) { return segment.bytes; });
+    }
+
+    // Hace una fusión si hay candidatos; devuelve si hizo alguna
+    bool merge_once() {
+        SegmentList inputs;
+        uint32_t id;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inputs = pick_merge();
+            if (inputs.empty()) return false;
+            merging = true;
+            id = next_id++;
+        }
+
+        std::vector<const InvertedIndex*> indexes;
+        for (const auto& segment : inputs) indexes.push_back(&segment->index);
+        IndexFileWriter merged(lexicon_path(id), docids_path(id), options.codec, merged_doc_lengths(indexes),
+                               options.positional);
+        merge_into(indexes, merged);
+        merged.finish();
+        auto segment = std::make_shared<const Segment>(id, lexicon_path(id), docids_path(id), options);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            SegmentList next;
+            for (const auto& live : *segments) {
+                if (std::find(inputs.begin(), inputs.end(), live) == inputs.end()) next.push_back(live);
+            }
+            next.push_back(segment);
+            publish(std::make_shared<const SegmentList>(std::move(next)));
+            bytes_written += segment->bytes;
+            ++merges;
+            merging = false;
+        }
+        // Las consultas en curso mantienen mapeados los archivos viejos
+        for (const auto& input : inputs) {
+            std::filesystem::remove(lexicon_path(input->id));
+            std::filesystem::remove(docids_path(input->id));
+        }
+        merge_idle.notify_all();
+        return true;
+    }
+
+    void merge_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (merge_error || pick_merge().empty()) {
+                merge_idle.notify_all();
+                merge_wakeup.wait(lock);
+                continue;
+            }
+            lock.unlock();
+            try {
+                merge_once();
+            } catch (...) {
+                std::lock_guard<std::mutex> error_lock(mutex);
+                merge_error = std::current_exception();
+                merging = false;
+            }
+            lock.lock();
+        }
+    }
+
+    void rethrow_merge_error() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (merge_error) std::rethrow_exception(merge_error);
+    }
+};
@@ -0,0 +1,334 @@
+#pragma once
+#include "IndexFileWriter.h"
+#include "PostingCodecs.h"
+#include "TermAccumulator.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+
+#include <unistd.h>
+
+struct SpimiOptions {
+    CodecType codec = CodecType::Gamma;
+    // Bytes (estimados) del acumulador en memoria antes de volcar una corrida
+    size_t memory_budget = size_t(256) << 20;
+    // Directorio de las corridas temporales
+    std::string temp_directory = ".";
+};
+
+// Indexación en una pasada con memoria acotada (SPIMI). Los tokens se
+// acumulan en un diccionario término -> (doc, tf) en memoria; cuando su tamaño
+// estimado llega a memory_budget se ordenan los términos y se vuelca una
+// corrida comprimida a disco, y el diccionario se vacía. Al terminar, una
+// fusión de k vías de todas las corridas escribe el índice final con
+// IndexFileWriter, leyendo cada corrida de forma secuencial con un buffer fijo.
+//
+// Corrida: por término, en orden alfabético,
+//   [varint largo][término][varint postings]([varint hueco de doc][varint tf] x postings)
+//
+// Fuera del presupuesto quedan las longitudes de los documentos (4 bytes por
+// doc) y, al fusionar, el léxico y la lista comprimida del término en curso.
+// Un indexador se usa desde un solo hilo; para indexar en paralelo, uno por
+// hilo y merge() de todos al final (un doc repartido entre varios suma sus tf).
+class SpimiIndexer {
+public:
+    explicit SpimiIndexer(const SpimiOptions& options = {}) : options(options) {}
+
+    ~SpimiIndexer() {
+        for (const auto& run : runs) std::remove(run.c_str());
+    }
+
+    SpimiIndexer(const SpimiIndexer&) = delete;
+    SpimiIndexer& operator=(const SpimiIndexer&) = delete;
+
+    // Una aparición de 'term' en 'doc_id'; las de un mismo doc conviene pasarlas seguidas
+    void add_token(std::string_view term, uint32_t doc_id) {
+        key.assign(term.data(), term.size());
+        auto it = terms.find(key);
+        if (it == terms.end()) {
+            it = terms.emplace(key, TermPostings{}).first;
+            used += TERM_OVERHEAD + (key.size() > SSO_CHARS ? key.size() + 1 : 0);
+        }
+        TermPostings& postings = it->second;
+        if (!postings.docs.empty() && postings.docs.back() == doc_id) {
+            ++postings.tfs.back();
+        } else {
+            if (!postings.docs.empty() && doc_id < postings.docs.back()) postings.sorted = false;
+            size_t capacity = postings.docs.capacity();
+            postings.docs.push_back(doc_id);
+            postings.tfs.push_back(1);
+            used += (postings.docs.capacity() - capacity) * 2 * sizeof(uint32_t);
+        }
+
+        if (doc_id >= doc_lengths.size()) {
+            doc_lengths.resize(std::max<size_t>(size_t(doc_id) + 1, doc_lengths.size() * 2), 0);
+        }
+        ++doc_lengths[doc_id];
+        ++tokens;
+        if (used >= options.memory_budget) spill();
+    }
+
+    void add_document(uint32_t doc_id, const std::vector<std::string>& terms) {
+        for (const auto& term : terms) add_token(term, doc_id);
+    }
+
+    // Vuelca lo acumulado a una corrida (si hay algo)
+    void spill() {
+        if (terms.empty()) return;
+        std::vector<std::pair<const std::string, TermPostings>*> sorted;
+        sorted.reserve(terms.size());
+        for (auto& entry : terms) sorted.push_back(&entry);
+        std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        std::string path = next_run_path();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::string buffer;
+        for (auto* entry : sorted) {
+            TermPostings& postings = entry->second;
+            if (!postings.sorted) postings.sort();
+            write_varint(buffer, entry->first.size());
+            buffer += entry->first;
+            write_varint(buffer, postings.docs.size());
+            uint32_t previous = 0;
+            for (size_t i = 0; i < postings.docs.size(); ++i) {
+                write_varint(buffer, postings.docs[i] - previous);
+                write_varint(buffer, postings.tfs[i]);
+                previous = postings.docs[i];
+            }
+            if (buffer.size() >= RUN_BUFFER) {
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                spilled += buffer.size();
+                buffer.clear();
+            }
+        }
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        spilled += buffer.size();
+        out.close();
+        if (!out) {
+            std::remove(path.c_str());
+            throw std::runtime_error("No se pudo escribir la corrida: " + path);
+        }
+        runs.push_back(path);
+
+        // clear() conservaría los buckets: se libera todo
+        std::unordered_map<std::string, TermPostings>().swap(terms);
+        used = 0;
+    }
+
+    // Fusiona las corridas de 'indexers' (volcando antes lo que tengan en
+    // memoria) en un índice guardado en 'lexicon_file' / 'docids_file'. Las
+    // corridas se borran al terminar. Devuelve el tamaño del índice escrito.
+    static IndexStatistics merge(const std::vector<SpimiIndexer*>& indexers, const std::string& lexicon_file,
+                      const std::string& docids_file) {
+        if (indexers.empty()) return {};
+        std::vector<uint32_t> lengths;
+        size_t run_total = 0;
+        for (SpimiIndexer* indexer : indexers) {
+            indexer->spill();
+            const auto& own = indexer->doc_lengths;
+            if (own.size() > lengths.size()) lengths.resize(own.size(), 0);
+            for (size_t doc = 0; doc < own.size(); ++doc) lengths[doc] += own[doc];
+            run_total += indexer->runs.size();
+        }
+        while (!lengths.empty() && lengths.back() == 0) lengths.pop_back();
+
+        const SpimiOptions& options = indexers.front()->options;
+        size_t buffer_size = std::clamp<size_t>(options.memory_budget / std::max<size_t>(run_total, 1),
+                                                MIN_READ_BUFFER, MAX_READ_BUFFER);
+        std::vector<std::unique_ptr<RunReader>> readers;
+        for (SpimiIndexer* indexer : indexers) {
+            for (const auto& run : indexer->runs) readers.push_back(std::make_unique<RunReader>(run, buffer_size));
+        }
+
+        IndexFileWriter writer(lexicon_file, docids_file, options.codec, std::move(lengths));
+        auto later_term = [&readers](size_t a, size_t b) { return readers[a]->term > readers[b]->term; };
+        std::vector<size_t> heap;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            if (readers[i]->next_term()) heap.push_back(i);
+        }
+        std::make_heap(heap.begin(), heap.end(), later_term);
+
+        // Corridas con el término actual, ordenadas por su próximo doc
+        std::vector<size_t> group, popped;
+        auto later_doc = [&readers](size_t a, size_t b) { return readers[a]->doc > readers[b]->doc; };
+        while (!heap.empty()) {
+            std::string term = readers[heap.front()]->term;
+            group.clear();
+            popped.clear();
+            while (!heap.empty() && readers[heap.front()]->term == term) {
+                std::pop_heap(heap.begin(), heap.end(), later_term);
+                size_t i = heap.back();
+                heap.pop_back();
+                popped.push_back(i);
+                if (readers[i]->next_posting()) group.push_back(i);
+            }
+            std::make_heap(group.begin(), group.end(), later_doc);
+
+            writer.begin_term(term);
+            while (!group.empty()) {
+                std::pop_heap(group.begin(), group.end(), later_doc);
+                RunReader& reader = *readers[group.back()];
+                uint32_t doc = reader.doc;
+                uint32_t tf = reader.tf;
+                if (reader.next_posting()) {
+                    std::push_heap(group.begin(), group.end(), later_doc);
+                } else {
+                    group.pop_back();
+                }
+                // El mismo doc en varias corridas (volcado a la mitad, o en otro hilo)
+                while (!group.empty() && readers[group.front()]->doc == doc) {
+                    std::pop_heap(group.begin(), group.end(), later_doc);
+                    RunReader& same = *readers[group.back()];
+                    tf += same.tf;
+                    if (same.next_posting()) {
+                        std::push_heap(group.begin(), group.end(), later_doc);
+                    } else {
+                        group.pop_back();
+                    }
+                }
+                writer.add_posting(doc, tf);
+            }
+            writer.end_term();
+
+            for (size_t i : popped) {
+                if (readers[i]->next_term()) {
+                    heap.push_back(i);
+                    std::push_heap(heap.begin(), heap.end(), later_term);
+                }
+            }
+        }
+        writer.finish();
+
+        readers.clear();
+        for (SpimiIndexer* indexer : indexers) {
+            for (const auto& run : indexer->runs) std::remove(run.c_str());
+            indexer->runs.clear();
+        }
+        return writer.statistics();
+    }
+
+    // Fusiona solo las corridas de este indexador
+    void finish(const std::string& lexicon_file, const std::string& docids_file) {
+        merge({this}, lexicon_file, docids_file);
+    }
+
+    size_t run_count() const { return runs.size(); }
+    uint64_t spilled_bytes() const { return spilled; }
+    uint64_t token_count() const { return tokens; }
+    // Estimación de lo que ocupa el acumulador (lo que se compara con el presupuesto)
+    size_t memory_bytes() const { return used; }
+
+private:
+    static constexpr size_t SSO_CHARS = 15;
+    // Nodo del mapa (clave, dos vectores, siguiente, hash) y su bucket
+    static constexpr size_t TERM_OVERHEAD = sizeof(std::string) + 2 * sizeof(std::vector<uint32_t>) +
+                                            4 * sizeof(void*);
+    static constexpr size_t RUN_BUFFER = size_t(1) << 20;
+    static constexpr size_t MIN_READ_BUFFER = size_t(64) << 10;
+    static constexpr size_t MAX_READ_BUFFER = size_t(4) << 20;
+
+    struct TermPostings {
+        std::vector<uint32_t> docs;
+        std::vector<uint32_t> tfs;
+        bool sorted = true;
+
+        // Ordena por doc y junta las apariciones repetidas de un doc
+        void sort() {
+            sort_postings(docs, tfs);
+            sorted = true;
+        }
+    };
+
+    // Lectura secuencial de una corrida con un buffer de tamaño fijo
+    struct RunReader {
+        std::ifstream in;
+        std::vector<char> buffer;
+        const char* p = nullptr;
+        const char* end = nullptr;
+        std::string path;
+
+        std::string term;
+        uint64_t remaining = 0; // postings sin leer del término actual
+        uint32_t doc = 0;
+        uint32_t tf = 0;
+
+        RunReader(const std::string& path, size_t buffer_size)
+            : in(path, std::ios::binary), buffer(buffer_size), path(path) {
+            if (!in) throw std::runtime_error("No se pudo abrir la corrida: " + path);
+            p = end = buffer.data();
+        }
+
+        // Pasa al término siguiente (descartando los postings sin leer); false al final
+        bool next_term() {
+            while (remaining > 0) next_posting();
+            if (!available(1)) return false;
+            uint64_t length = read();
+            if (!available(length)) corrupt();
+            term.assign(p, length);
+            p += length;
+            remaining = read();
+            doc = 0;
+            return true;
+        }
+
+        // Lee el siguiente posting del término en doc y tf; false si no quedan
+        bool next_posting() {
+            if (remaining == 0) return false;
+            doc += static_cast<uint32_t>(read());
+            tf = static_cast<uint32_t>(read());
+            --remaining;
+            return true;
+        }
+
+        uint64_t read() {
+            if (!available(10) && p == end) corrupt();
+            uint64_t value;
+            if (!read_varint(p, end, value)) corrupt();
+            return value;
+        }
+
+        // Asegura 'n' bytes en el buffer si el archivo los tiene
+        bool available(size_t n) {
+            if (static_cast<size_t>(end - p) >= n) return true;
+            size_t kept = end - p;
+            if (n > buffer.size()) {
+                std::vector<char> larger(n);
+                std::copy(p, end, larger.data());
+                buffer.swap(larger);
+            } else {
+                std::copy(p, end, buffer.data());
+            }
+            in.read(buffer.data() + kept, static_cast<std::streamsize>(buffer.size() - kept));
+            p = buffer.data();
+            end = p + kept + in.gcount();
+            return static_cast<size_t>(end - p) >= n;
+        }
+
+        [[noreturn]] void corrupt() const { throw std::runtime_error("Corrida truncada: " + path); }
+    };
+
+    SpimiOptions options;
+    std::unordered_map<std::string, TermPostings> terms;
+    std::string key;
+    size_t used = 0;
+    std::vector<uint32_t> doc_lengths;
+    std::vector<std::string> runs;
+    uint64_t spilled = 0;
+    uint64_t tokens = 0;
+
+    std::string next_run_path() const {
+        static std::atomic<uint64_t> counter{0};
+        std::string name = "spimi_" + std::to_string(::getpid()) + "_" + std::to_string(counter++) + ".run";
+        return (std::filesystem::path(options.temp_directory) / name).string();
+    }
+};
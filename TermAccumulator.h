@@ -0,0 +1,295 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+// Memoria por bloques grandes que solo crece: reservar es mover un puntero y
+// todo se libera junto al destruir la arena. Un pedido que no entra en lo que
+// queda del bloque actual abre otro (los muy grandes van en un bloque propio).
+class Arena {
+public:
+    static constexpr size_t BLOCK = size_t(1) << 20;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    // 'align' debe ser potencia de dos y a lo sumo alignof(std::max_align_t)
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (bytes > BLOCK / 4) {
+            blocks.push_back(std::make_unique<char[]>(bytes));
+            reserved += bytes;
+            return blocks.back().get();
+        }
+        size_t at = (used + align - 1) & ~(align - 1);
+        if (current == nullptr || at + bytes > BLOCK) {
+            blocks.push_back(std::make_unique<char[]>(BLOCK));
+            reserved += BLOCK;
+            current = blocks.back().get();
+            at = 0;
+        }
+        used = at + bytes;
+        return current + at;
+    }
+
+    // Bloques pedidos al sistema
+    size_t block_count() const { return blocks.size(); }
+    size_t reserved_bytes() const { return reserved; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* current = nullptr;
+    size_t used = 0;
+    size_t reserved = 0;
+};
+
+// Acumulador de postings (doc, tf) para un solo hilo. Los términos se internan
+// en una tabla de direccionamiento abierto (sondeo lineal) que guarda el hash y
+// el ID del término; el texto de cada término se copia una vez a la arena. La
+// lista de cada término es una cadena de bloques de uint32_t en la misma arena,
+// que duplican su tamaño hasta MAX_POSTING_BLOCK: solo se agrega al final y un
+// doc igual al último agregado no agrega un posting, suma uno a su tf.
+//
+// Si los docs no llegan en orden (un hilo que toma tramos desordenados) una
+// lista puede quedar desordenada o con repetidos no consecutivos; postings()
+// los entrega tal cual y quien fusiona ordena y suma los tf.
+//
+// Los términos se reparten además en 'partitions' particiones por su hash.
+// Como el hash no depende del acumulador, un término cae en la misma
+// partición en todos los hilos y cada partición se puede fusionar por
+// separado (ver merge_partition).
+class TermAccumulator {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+    static constexpr uint32_t FIRST_POSTING_BLOCK = 4;
+    static constexpr uint32_t MAX_POSTING_BLOCK = 1024;
+
+    explicit TermAccumulator(size_t partitions = 1)
+        : slots(INITIAL_SLOTS, Slot{0, NO_TERM}), partitions(std::max<size_t>(partitions, 1)) {
+        ++allocations;
+    }
+
+    TermAccumulator(const TermAccumulator&) = delete;
+    TermAccumulator& operator=(const TermAccumulator&) = delete;
+
+    void add(std::string_view term, uint32_t doc) { add(term, hash_term(term), doc); }
+
+    // Con el hash ya calculado (el de hash_term)
+    void add(std::string_view term, uint32_t hash, uint32_t doc) {
+        ++tokens;
+        Term& entry = terms[intern(term, hash)];
+        if (entry.count > 0 && entry.last_doc == doc) {
+            ++entry.tail->tfs()[entry.tail->size - 1];
+            return;
+        }
+        if (entry.tail == nullptr || entry.tail->size == entry.tail->capacity) grow_list(entry);
+        entry.tail->docs()[entry.tail->size] = doc;
+        entry.tail->tfs()[entry.tail->size] = 1;
+        ++entry.tail->size;
+        entry.last_doc = doc;
+        ++entry.count;
+    }
+
+    // ID del término, agregándolo si es nuevo (los IDs son el orden de llegada)
+    uint32_t intern(std::string_view term) { return intern(term, hash_term(term)); }
+
+    uint32_t intern(std::string_view term, uint32_t hash) {
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.id == NO_TERM) {
+                slot = {hash, static_cast<uint32_t>(terms.size())};
+                add_term(term, hash);
+                if (terms.size() * 2 > slots.size()) rehash();
+                return static_cast<uint32_t>(terms.size() - 1);
+            }
+            if (slot.hash == hash && text(slot.id) == term) return slot.id;
+        }
+    }
+
+    uint32_t find(std::string_view term) const {
+        uint32_t hash = hash_term(term);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.id == NO_TERM) return NO_TERM;
+            if (slot.hash == hash && text(slot.id) == term) return slot.id;
+        }
+    }
+
+    size_t term_count() const { return terms.size(); }
+
+    size_t partition_count() const { return partitions.size(); }
+
+    // IDs de los términos de la partición p, en orden de llegada
+    const std::vector<uint32_t>& partition(size_t p) const { return partitions[p]; }
+
+    // FNV-1a: los términos son cortos y de letras
+    static uint32_t hash_term(std::string_view term) {
+        uint32_t hash = 2166136261u;
+        for (char c : term) hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        return hash;
+    }
+
+    // Partición de un término según su hash. Usa los bits altos; la tabla, los bajos.
+    static size_t partition_of(uint32_t hash, size_t count) {
+        return static_cast<size_t>((uint64_t(hash) * count) >> 32);
+    }
+
+    std::string_view text(uint32_t id) const { return {terms[id].text, terms[id].length}; }
+
+    // Postings guardados del término (sin los repetidos consecutivos)
+    uint32_t posting_count(uint32_t id) const { return terms[id].count; }
+
+    // Agrega a 'docs' y 'tfs' los postings del término en el orden en que llegaron
+    void postings(uint32_t id, std::vector<uint32_t>& docs, std::vector<uint32_t>& tfs) const {
+        for (const PostingBlock* block = terms[id].head; block; block = block->next) {
+            docs.insert(docs.end(), block->docs(), block->docs() + block->size);
+            tfs.insert(tfs.end(), block->tfs(), block->tfs() + block->size);
+        }
+    }
+
+    uint64_t token_count() const { return tokens; }
+
+    // Reservas de memoria hechas por el acumulador: bloques de la arena y
+    // crecimientos de la tabla, del vector de términos y de las particiones
+    uint64_t allocation_count() const { return allocations + arena.block_count(); }
+
+    size_t memory_bytes() const {
+        size_t bytes = arena.reserved_bytes() + slots.capacity() * sizeof(Slot) + terms.capacity() * sizeof(Term);
+        for (const auto& ids : partitions) bytes += ids.capacity() * sizeof(uint32_t);
+        return bytes;
+    }
+
+private:
+    static constexpr size_t INITIAL_SLOTS = size_t(1) << 12;
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t id;
+    };
+
+    // Cabecera de un bloque de la lista; a continuación van 'capacity' docs y 'capacity' tfs
+    struct PostingBlock {
+        PostingBlock* next;
+        uint32_t capacity;
+        uint32_t size;
+
+        uint32_t* docs() { return reinterpret_cast<uint32_t*>(this + 1); }
+        const uint32_t* docs() const { return reinterpret_cast<const uint32_t*>(this + 1); }
+        uint32_t* tfs() { return docs() + capacity; }
+        const uint32_t* tfs() const { return docs() + capacity; }
+    };
+
+    struct Term {
+        const char* text;
+        uint32_t length;
+        uint32_t count;
+        uint32_t last_doc;
+        PostingBlock* head;
+        PostingBlock* tail;
+    };
+
+    Arena arena;
+    std::vector<Slot> slots;
+    std::vector<Term> terms;
+    std::vector<std::vector<uint32_t>> partitions;
+    uint64_t tokens = 0;
+    uint64_t allocations = 0;
+
+    void add_term(std::string_view term, uint32_t hash) {
+        char* copy = static_cast<char*>(arena.allocate(term.size(), 1));
+        std::memcpy(copy, term.data(), term.size());
+        std::vector<uint32_t>& ids = partitions[partition_of(hash, partitions.size())];
+        if (terms.size() == terms.capacity()) ++allocations;
+        if (ids.size() == ids.capacity()) ++allocations;
+        ids.push_back(static_cast<uint32_t>(terms.size()));
+        terms.push_back({copy, static_cast<uint32_t>(term.size()), 0, 0, nullptr, nullptr});
+    }
+
+    void grow_list(Term& entry) {
+        uint32_t capacity = entry.tail ? std::min(entry.tail->capacity * 2, MAX_POSTING_BLOCK) : FIRST_POSTING_BLOCK;
+        void* memory = arena.allocate(sizeof(PostingBlock) + 2 * capacity * sizeof(uint32_t), alignof(PostingBlock));
+        PostingBlock* block = new (memory) PostingBlock{nullptr, capacity, 0};
+        if (entry.tail) entry.tail->next = block;
+        else entry.head = block;
+        entry.tail = block;
+    }
+
+    void rehash() {
+        std::vector<Slot> grown(slots.size() * 2, Slot{0, NO_TERM});
+        ++allocations;
+        size_t mask = grown.size() - 1;
+        for (const Slot& slot : slots) {
+            if (slot.id == NO_TERM) continue;
+            size_t i = slot.hash & mask;
+            while (grown[i].id != NO_TERM) i = (i + 1) & mask;
+            grown[i] = slot;
+        }
+        slots.swap(grown);
+    }
+};
+
+// Término fusionado: apunta al texto guardado en uno de los acumuladores
+struct MergedTerm {
+    std::string_view term;
+    std::vector<uint32_t> docs; // ordenados y sin repetir
+    std::vector<uint32_t> tfs;
+};
+
+// Ordena los postings (docs[i], tfs[i]) por doc y suma los tf de un mismo doc
+inline void sort_postings(std::vector<uint32_t>& docs, std::vector<uint32_t>& tfs) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs(docs.size());
+    for (size_t k = 0; k < pairs.size(); ++k) pairs[k] = {docs[k], tfs[k]};
+    std::sort(pairs.begin(), pairs.end());
+    docs.clear();
+    tfs.clear();
+    for (const auto& pair : pairs) {
+        if (!docs.empty() && docs.back() == pair.first) {
+            tfs.back() += pair.second;
+        } else {
+            docs.push_back(pair.first);
+            tfs.push_back(pair.second);
+        }
+    }
+}
+
+// Fusiona la partición p de varios acumuladores con la misma cantidad de
+// particiones. Solo lee esa partición, así que varias se pueden fusionar a la
+// vez sin locks. Los términos salen en orden alfabético.
+inline std::vector<MergedTerm> merge_partition(const std::vector<const TermAccumulator*>& sources, size_t p) {
+    struct Entry {
+        std::string_view term;
+        uint32_t source;
+        uint32_t id;
+    };
+    std::vector<Entry> entries;
+    for (uint32_t s = 0; s < sources.size(); ++s) {
+        for (uint32_t id : sources[s]->partition(p)) entries.push_back({sources[s]->text(id), s, id});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.term < b.term; });
+
+    std::vector<MergedTerm> merged;
+    for (size_t i = 0; i < entries.size();) {
+        MergedTerm out{entries[i].term, {}, {}};
+        bool sorted = true;
+        for (; i < entries.size() && entries[i].term == out.term; ++i) {
+            size_t before = out.docs.size();
+            sources[entries[i].source]->postings(entries[i].id, out.docs, out.tfs);
+            // Cada fuente suele traer su lista ya en orden: se ordena solo si hace falta
+            for (size_t k = std::max<size_t>(before, 1); sorted && k < out.docs.size(); ++k) {
+                sorted = out.docs[k - 1] < out.docs[k];
+            }
+        }
+        if (!sorted) sort_postings(out.docs, out.tfs);
+        merged.push_back(std::move(out));
+    }
+    return merged;
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+// Trie de términos en arreglos planos, con los nodos en orden BFS: los hijos de
+// cada nodo son un rango contiguo [first_child[n], first_child[n + 1]) ordenado
+// por etiqueta. Por nodo se guardan 1 byte de etiqueta y 4 del primer hijo; qué
+// nodos cierran un término va en un bitmap con rango por palabra, y el ID del
+// término se busca por ese rango en 'term_ids'.
+class TermTrie {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // 'entries' (término, ID) ordenados y sin repetidos
+    void build(const std::vector<std::pair<std::string, uint32_t>>& entries) {
+        labels.assign(1, '\0');
+        first_child.clear();
+        term_ids.clear();
+        std::vector<bool> terminal;
+
+        // Cada nodo es el rango de términos que comparten sus primeros 'depth' bytes
+        struct Range {
+            size_t lo, hi, depth;
+        };
+        std::vector<Range> queue{{0, entries.size(), 0}};
+        for (size_t head = 0; head < queue.size(); ++head) {
+            Range node = queue[head];
+            first_child.push_back(static_cast<uint32_t>(queue.size()));
+
+            bool ends_here = node.lo < node.hi && entries[node.lo].first.size() == node.depth;
+            terminal.push_back(ends_here);
+            if (ends_here) term_ids.push_back(entries[node.lo++].second);
+
+            size_t i = node.lo;
+            while (i < node.hi) {
+                char label = entries[i].first[node.depth];
+                size_t j = i + 1;
+                while (j < node.hi && entries[j].first[node.depth] == label) ++j;
+                queue.push_back({i, j, node.depth + 1});
+                labels.push_back(label);
+                i = j;
+            }
+        }
+        first_child.push_back(static_cast<uint32_t>(queue.size()));
+
+        terminal_bits.assign((terminal.size() + 63) / 64, 0);
+        for (size_t n = 0; n < terminal.size(); ++n) {
+            if (terminal[n]) terminal_bits[n / 64] |= uint64_t(1) << (n % 64);
+        }
+        rank_samples.assign(terminal_bits.size() + 1, 0);
+        for (size_t w = 0; w < terminal_bits.size(); ++w) {
+            rank_samples[w + 1] = rank_samples[w] + static_cast<uint32_t>(__builtin_popcountll(terminal_bits[w]));
+        }
+    }
+
+    bool empty() const { return term_ids.empty(); }
+    size_t node_count() const { return labels.size(); }
+
+    size_t memory_bytes() const {
+        return labels.size() + first_child.size() * sizeof(uint32_t) + term_ids.size() * sizeof(uint32_t) +
+               terminal_bits.size() * sizeof(uint64_t) + rank_samples.size() * sizeof(uint32_t);
+    }
+
+    // Nodo al que lleva 'prefix' desde la raíz; NONE si no existe
+    uint32_t walk(const std::string& prefix) const {
+        if (first_child.empty()) return NONE;
+        uint32_t node = 0;
+        for (char ch : prefix) {
+            node = child(node, ch);
+            if (node == NONE) return NONE;
+        }
+        return node;
+    }
+
+    uint32_t term_id(uint32_t node) const {
+        if (!(terminal_bits[node / 64] >> (node % 64) & 1)) return NONE;
+        uint64_t below = terminal_bits[node / 64] & ((uint64_t(1) << (node % 64)) - 1);
+        return term_ids[rank_samples[node / 64] + __builtin_popcountll(below)];
+    }
+
+    // Llama a callback(término, ID) por cada término que empieza con 'prefix',
+    // en orden alfabético; si devuelve false se detiene
+    template <typename Callback>
+    void for_each_prefix(const std::string& prefix, Callback&& callback) const {
+        uint32_t node = walk(prefix);
+        if (node == NONE) return;
+        std::string term = prefix;
+        enumerate(node, term, callback);
+    }
+
+    // Llama a callback(término, ID, distancia) por cada término a distancia de
+    // Levenshtein <= max_edits de 'target'. Recorre el trie con una fila de la
+    // matriz de distancias por nivel (el autómata de Levenshtein simulado) y poda
+    // las ramas cuya fila ya no baja de max_edits.
+    template <typename Callback>
+    void for_each_within(const std::string& target, uint32_t max_edits, Callback&& callback) const {
+        if (term_ids.empty()) return;
+        size_t width = target.size() + 1;
+        std::vector<uint32_t> rows(width);
+        for (size_t j = 0; j < width; ++j) rows[j] = static_cast<uint32_t>(j);
+
+        std::string term;
+        if (width - 1 <= max_edits && term_id(0) != NONE) callback(term, term_id(0), static_cast<uint32_t>(width - 1));
+        fuzzy(0, target, max_edits, rows, term, callback);
+    }
+
+private:
+    std::vector<char> labels;          // etiqueta de la arista que entra a cada nodo
+    std::vector<uint32_t> first_child; // nodos + 1 entradas
+    std::vector<uint32_t> term_ids;    // por rango de nodo terminal
+    std::vector<uint64_t> terminal_bits;
+    std::vector<uint32_t> rank_samples;
+
+    uint32_t child(uint32_t node, char ch) const {
+        auto begin = labels.begin() + first_child[node];
+        auto end = labels.begin() + first_child[node + 1];
+        auto it = std::lower_bound(begin, end, ch, [](char a, char b) {
+            return static_cast<unsigned char>(a) < static_cast<unsigned char>(b);
+        });
+        return (it != end && *it == ch) ? static_cast<uint32_t>(it - labels.begin()) : NONE;
+    }
+
+    template <typename Callback>
+    bool enumerate(uint32_t node, std::string& term, Callback& callback) const {
+        uint32_t id = term_id(node);
+        if (id != NONE && !callback(static_cast<const std::string&>(term), id)) return false;
+        for (uint32_t c = first_child[node]; c < first_child[node + 1]; ++c) {
+            term.push_back(labels[c]);
+            bool keep_going = enumerate(c, term, callback);
+            term.pop_back();
+            if (!keep_going) return false;
+        }
+        return true;
+    }
+
+    // 'rows' trae al final la fila del nodo actual
+    template <typename Callback>
+    void fuzzy(uint32_t node, const std::string& target, uint32_t max_edits, std::vector<uint32_t>& rows,
+               std::string& term, Callback& callback) const {
+        size_t width = target.size() + 1;
+        size_t base = rows.size() - width;
+        for (uint32_t c = first_child[node]; c < first_child[node + 1]; ++c) {
+            char ch = labels[c];
+            rows.resize(base + 2 * width);
+            const uint32_t* prev = rows.data() + base;
+            uint32_t* row = rows.data() + base + width;
+
+            row[0] = prev[0] + 1;
+            uint32_t best = row[0];
+            for (size_t j = 1; j < width; ++j) {
+                uint32_t substitution = prev[j - 1] + (target[j - 1] != ch);
+                row[j] = std::min({prev[j] + 1, row[j - 1] + 1, substitution});
+                best = std::min(best, row[j]);
+            }
+
+            term.push_back(ch);
+            uint32_t id = term_id(c);
+            if (id != NONE && row[width - 1] <= max_edits) {
+                callback(static_cast<const std::string&>(term), id, row[width - 1]);
+            }
+            if (best <= max_edits) fuzzy(c, target, max_edits, rows, term, callback);
+            term.pop_back();
+            rows.resize(base + width);
+        }
+    }
+};
+
+// Diccionario para expandir términos de consulta: un trie de los términos para
+// prefijos y errores de tipeo, y otro de los términos invertidos para sufijos
+class TermDictionary {
+public:
+    struct Match {
+        std::string term;
+        uint32_t id;
+        uint32_t distance;
+    };
+
+    void build(std::vector<std::pair<std::string, uint32_t>> entries) {
+        std::sort(entries.begin(), entries.end());
+        forward.build(entries);
+        for (auto& entry : entries) std::reverse(entry.first.begin(), entry.first.end());
+        std::sort(entries.begin(), entries.end());
+        reversed.build(entries);
+    }
+
+    size_t memory_bytes() const { return forward.memory_bytes() + reversed.memory_bytes(); }
+
+    // Patrón con '*' (cualquier secuencia, posiblemente vacía). Los candidatos
+    // salen del prefijo fijo o, si no hay, del sufijo fijo en el trie invertido;
+    // después se filtran con el patrón completo. Sin ninguno de los dos (*or*)
+    // se recorre todo el léxico. A lo sumo 'limit' resultados.
+    std::vector<Match> wildcard(const std::string& pattern, size_t limit) const {
+        size_t first = pattern.find('*');
+        size_t last = pattern.rfind('*');
+        std::string prefix = pattern.substr(0, first);
+        std::string suffix = first == std::string::npos ? std::string() : pattern.substr(last + 1);
+
+        std::vector<Match> matches;
+        auto accept = [&](const std::string& term, uint32_t id) {
+            if (glob_match(pattern, term)) matches.push_back({term, id, 0});
+            return matches.size() < limit;
+        };
+        if (!prefix.empty() || suffix.empty()) {
+            forward.for_each_prefix(prefix, accept);
+        } else {
+            std::string reversed_suffix(suffix.rbegin(), suffix.rend());
+            reversed.for_each_prefix(reversed_suffix, [&](const std::string& term, uint32_t id) {
+                return accept(std::string(term.rbegin(), term.rend()), id);
+            });
+        }
+        return matches;
+    }
+
+    // Términos a distancia <= max_edits, los más cercanos primero
+    std::vector<Match> fuzzy(const std::string& term, uint32_t max_edits, size_t limit) const {
+        std::vector<Match> matches;
+        forward.for_each_within(term, max_edits, [&](const std::string& found, uint32_t id, uint32_t distance) {
+            matches.push_back({found, id, distance});
+        });
+        std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+            return a.distance != b.distance ? a.distance < b.distance : a.term < b.term;
+        });
+        if (matches.size() > limit) matches.resize(limit);
+        return matches;
+    }
+
+    static bool glob_match(const std::string& pattern, const std::string& text) {
+        size_t p = 0, t = 0, star = std::string::npos, resume = 0;
+        while (t < text.size()) {
+            if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                resume = t;
+            } else if (p < pattern.size() && pattern[p] == text[t]) {
+                ++p;
+                ++t;
+            } else if (star != std::string::npos) {
+                p = star + 1;
+                t = ++resume;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') ++p;
+        return p == pattern.size();
+    }
+
+private:
+    TermTrie forward;
+    TermTrie reversed;
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+// Pool de hilos con robo de trabajo. Cada hilo tiene su cola: toma de atrás
+// de la propia (lo último que agregó, todavía en caché) y, si está vacía, roba
+// del frente de las de los demás (lo más viejo, que suele ser lo más grande
+// por repartir). Las tareas que se agregan desde afuera se reparten entre las
+// colas en ronda; las que agrega una tarea van a la cola de su hilo.
+//
+// Cada tarea recibe el número de hilo que la corre (0..size()-1), para que
+// use estructuras propias de ese hilo sin sincronizar.
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t worker)>;
+
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 0; i < threads; ++i) workers.emplace_back([this, i] { run(i); });
+    }
+
+    // Espera a que terminen las tareas pendientes
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle.wait(lock, [this] { return pending == 0; });
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    void submit(Task task) {
+        size_t target = current_pool == this ? current_worker : next_queue++ % queues.size();
+        // Se cuenta antes de encolar: un hilo despierto podría tomar la tarea y
+        // descontarla antes de que se sumara. Mientras tanto, quien vea queued > 0
+        // sin encontrarla vuelve a intentar.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued;
+            ++pending;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        wakeup.notify_one();
+    }
+
+    // Espera a que terminen todas las tareas agregadas hasta ahora (y las que
+    // agreguen ellas). Relanza la primera excepción de una tarea, si hubo.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending == 0; });
+        if (error) {
+            std::exception_ptr first = error;
+            error = nullptr;
+            std::rethrow_exception(first);
+        }
+    }
+
+    // Tareas que cada hilo tomó de otra cola
+    size_t steal_count() const { return steals; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_queue{0};
+    std::atomic<size_t> steals{0};
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    size_t queued = 0;  // tareas en alguna cola
+    size_t pending = 0; // agregadas y sin terminar
+    bool stopping = false;
+    std::exception_ptr error;
+
+    static inline thread_local const ThreadPool* current_pool = nullptr;
+    static inline thread_local size_t current_worker = 0;
+
+    bool try_pop(size_t worker, Task& task) {
+        {
+            Queue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = *queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                ++steals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t worker) {
+        current_pool = this;
+        current_worker = worker;
+        Task task;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping && queued == 0) return;
+            }
+            if (!try_pop(worker, task)) continue;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --queued;
+            }
+
+            std::exception_ptr failure;
+            try {
+                task(worker);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (failure && !error) error = failure;
+            if (--pending == 0) idle.notify_all();
+        }
+    }
+};
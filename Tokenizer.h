@@ -0,0 +1,154 @@
+#pragma once
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Tokenizador de texto para indexar, con las mismas reglas que la versión por
+// palabra con std::locale ("C"): las palabras se separan por espacios ASCII
+// (' ', \t, \n, \v, \f, \r) y de cada una quedan solo sus letras ASCII en
+// minúscula; las que quedan vacías se descartan.
+//
+// Se clasifican 64 bytes por vuelta con máscaras de bits (AVX2 con -mavx2,
+// SSE2 en cualquier x86-64, escalar en otro caso): los bordes de las palabras
+// salen de los cambios en la máscara de espacios y el texto se pasa a
+// minúscula en el registro y se guarda en su lugar. Una palabra que solo
+// tiene letras se entrega tal cual, como string_view dentro del buffer; las
+// que tienen otros caracteres se compactan sobre sí mismas. No se reserva
+// memoria.
+namespace tokenizer_detail {
+
+// Byte a byte: bits de espacio y de letra de p[0, n), con n <= 64. Los bytes
+// desde n cuentan como espacio, así que una palabra al final del buffer se cierra.
+inline void classify_scalar(char* p, size_t n, uint64_t& spaces, uint64_t& letters) {
+    spaces = n < 64 ? ~uint64_t(0) << n : 0;
+    letters = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t c = static_cast<uint8_t>(p[i]);
+        if (c == ' ' || static_cast<uint8_t>(c - '\t') <= '\r' - '\t') {
+            spaces |= uint64_t(1) << i;
+        } else if (static_cast<uint8_t>((c | 0x20) - 'a') < 26) {
+            letters |= uint64_t(1) << i;
+            p[i] = static_cast<char>(c | 0x20);
+        }
+    }
+}
+
+#if defined(__AVX2__)
+inline uint32_t classify32(char* p, uint32_t& letters) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    // Sin signo: x <= k equivale a min(x, k) == x
+    __m256i control = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8('\r' - '\t')), control);
+    __m256i is_space = _mm256_or_si256(is_control, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_sub_epi8(lower, _mm256_set1_epi8('a'));
+    __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(25)), letter);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_blendv_epi8(v, lower, is_letter));
+    letters = static_cast<uint32_t>(_mm256_movemask_epi8(is_letter));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(is_space));
+}
+#elif defined(__SSE2__)
+inline uint32_t classify16(char* p, uint32_t& letters) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i control = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8('\r' - '\t')), control);
+    __m128i is_space = _mm_or_si128(is_control, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_sub_epi8(lower, _mm_set1_epi8('a'));
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+    __m128i lowered = _mm_or_si128(v, _mm_and_si128(is_letter, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), lowered);
+    letters = static_cast<uint32_t>(_mm_movemask_epi8(is_letter));
+    return static_cast<uint32_t>(_mm_movemask_epi8(is_space));
+}
+#endif
+
+// 64 bytes completos
+inline void classify64(char* p, uint64_t& spaces, uint64_t& letters) {
+#if defined(__AVX2__)
+    uint32_t l0, l1;
+    uint32_t s0 = classify32(p, l0);
+    uint32_t s1 = classify32(p + 32, l1);
+    spaces = s0 | uint64_t(s1) << 32;
+    letters = l0 | uint64_t(l1) << 32;
+#elif defined(__SSE2__)
+    spaces = letters = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        uint32_t l;
+        spaces |= uint64_t(classify16(p + 16 * i, l)) << (16 * i);
+        letters |= uint64_t(l) << (16 * i);
+    }
+#else
+    classify_scalar(p, 64, spaces, letters);
+#endif
+}
+
+// Bits [from, to) con 0 <= from <= to <= 64
+inline uint64_t bit_range(unsigned from, unsigned to) {
+    uint64_t below_to = to == 64 ? ~uint64_t(0) : (uint64_t(1) << to) - 1;
+    return below_to & ~((uint64_t(1) << from) - 1);
+}
+
+// Deja en [begin, end) solo las letras (ya en minúscula); devuelve cuántas quedan
+inline size_t compact_letters(char* begin, char* end) {
+    char* out = begin;
+    for (char* p = begin; p < end; ++p) {
+        if (static_cast<uint8_t>(*p - 'a') < 26) *out++ = *p;
+    }
+    return out - begin;
+}
+
+} // namespace tokenizer_detail
+
+// Llama a callback(std::string_view) por cada término de [begin, end), en
+// orden. El buffer se modifica (minúsculas y palabras compactadas) y las vistas
+// apuntan dentro de él: valen mientras no se reutilice.
+template <typename Callback>
+void tokenize_in_place(char* begin, char* end, Callback&& callback) {
+    using namespace tokenizer_detail;
+    size_t size = end - begin;
+    bool in_word = false;
+    bool dirty = false; // la palabra en curso tiene caracteres que no son letras
+    size_t start = 0;
+    auto emit = [&](size_t word_end) {
+        char* word = begin + start;
+        size_t length = word_end - start;
+        if (dirty) length = compact_letters(word, word + length);
+        if (length > 0) callback(std::string_view(word, length));
+    };
+
+    for (size_t base = 0; base < size; base += 64) {
+        uint64_t spaces, letters;
+        if (size - base >= 64) classify64(begin + base, spaces, letters);
+        else classify_scalar(begin + base, size - base, spaces, letters);
+
+        uint64_t words = ~spaces;
+        uint64_t others = words & ~letters;
+        // Un bit por cada comienzo o fin de palabra
+        uint64_t edges = words ^ (words << 1 | (in_word ? 1 : 0));
+        unsigned from = 0;
+        while (edges) {
+            unsigned pos = static_cast<unsigned>(__builtin_ctzll(edges));
+            edges &= edges - 1;
+            if (!in_word) {
+                in_word = true;
+                dirty = false;
+                start = base + pos;
+                from = pos;
+                continue;
+            }
+            in_word = false;
+            dirty |= (others & bit_range(from, pos)) != 0;
+            emit(base + pos);
+        }
+        if (in_word) dirty |= (others & bit_range(from, 64)) != 0;
+    }
+    // Palabra que llega hasta el final con un tamaño múltiplo de 64 (en el
+    // resto, classify_scalar marca como espacio lo que sigue al final)
+    if (in_word) emit(size);
+}
+
@@ -0,0 +1,437 @@
+// Benchmarks reproducibles sobre un corpus sintético de Zipf (CorpusGenerator.h).
+// Cada resultado sale en stdout como una línea JSON con el mejor tiempo y la
+// mediana de --repeat vueltas y los ítems por segundo del mejor; la primera
+// línea describe el corpus. Con --baseline se compara contra una salida
+// anterior y el programa termina con 2 si algún benchmark quedó más de
+// --tolerance (proporción) por debajo en ítems por segundo.
+//
+//   benchmark [--seed n] [--vocabulary n] [--zipf s] [--docs n]
+//             [--lengths fixed|uniform|lognormal] [--mean-length n] [--sigma x]
+//             [--repeat n] [--threads n] [--dir directorio] [--only prefijo]
+//             [--baseline archivo] [--tolerance x]
+//   benchmark generate <prefijo> <archivos> [opciones del corpus]
+//
+// generate solo escribe el corpus, un documento por línea (para main2 --docs line).
+//
+// Compilar: g++ -O2 -std=c++17 -mavx2 -pthread benchmark.cpp -o benchmark
+#include "CorpusGenerator.h"
+#include "GammaEncoder.h"
+#include "PostingCodecs.h"
+#include "FrontCodedLexicon.h"
+#include "InvertedIndex.h"
+#include "IndexPipeline.h"
+#include "SpimiIndexer.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+
+using namespace std;
+using namespace chrono;
+namespace fs = std::filesystem;
+
+struct Options {
+    CorpusSpec corpus;
+    size_t repeat = 5;
+    size_t threads = max(1u, thread::hardware_concurrency());
+    string dir = "benchmark_corpus";
+    string only;
+    string baseline;
+    double tolerance = 0.1;
+};
+
+struct Result {
+    string name;
+    vector<double> seconds;
+    uint64_t items = 0;
+    uint64_t bytes = 0;
+    vector<pair<string, double>> extra;
+
+    double best() const { return *min_element(seconds.begin(), seconds.end()); }
+    double median() const {
+        vector<double> sorted = seconds;
+        sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+    double items_per_second() const { return items / best(); }
+};
+
+static const char* length_name(LengthDistribution lengths) {
+    switch (lengths) {
+        case LengthDistribution::Fixed: return "fixed";
+        case LengthDistribution::Uniform: return "uniform";
+        case LengthDistribution::LogNormal: return "lognormal";
+    }
+    return "?";
+}
+
+static void print_json(const Result& result) {
+    cout << "{\"benchmark\":\"" << result.name << "\",\"seconds_best\":" << result.best()
+         << ",\"seconds_median\":" << result.median() << ",\"repeat\":" << result.seconds.size()
+         << ",\"items\":" << result.items << ",\"items_per_second\":" << result.items_per_second();
+    if (result.bytes > 0) cout << ",\"bytes\":" << result.bytes << ",\"bytes_per_second\":" << result.bytes / result.best();
+    for (const auto& field : result.extra) cout << ",\"" << field.first << "\":" << field.second;
+    cout << "}" << endl;
+}
+
+// Corre 'body' options.repeat veces (más una de calentamiento) y mide cada una.
+// 'body' devuelve la cantidad de ítems procesados.
+class Runner {
+public:
+    explicit Runner(const Options& options) : options(options) {}
+
+    // Un benchmark o un grupo ("codec_") entra si --only es prefijo de su
+    // nombre o si el nombre es prefijo de --only
+    bool selected(const string& name) const {
+        return name.compare(0, options.only.size(), options.only) == 0 ||
+               options.only.compare(0, name.size(), name) == 0;
+    }
+
+    Result* run(const string& name, const function<uint64_t()>& body) {
+        if (!selected(name)) return nullptr;
+        Result result;
+        result.name = name;
+        result.items = body();
+        for (size_t i = 0; i < options.repeat; ++i) {
+            auto start = steady_clock::now();
+            uint64_t items = body();
+            result.seconds.push_back(duration<double>(steady_clock::now() - start).count());
+            if (items != result.items) {
+                throw runtime_error("El benchmark " + name + " no procesó lo mismo en cada vuelta");
+            }
+        }
+        results.push_back(move(result));
+        return &results.back();
+    }
+
+    void print(const Result* result) const {
+        if (result) print_json(*result);
+    }
+
+    const vector<Result>& all() const { return results; }
+
+private:
+    const Options& options;
+    vector<Result> results;
+};
+
+// Número de un campo de una línea JSON de este mismo programa
+static bool json_number(const string& line, const string& field, double& value) {
+    size_t at = line.find("\"" + field + "\":");
+    if (at == string::npos) return false;
+    value = strtod(line.c_str() + at + field.size() + 3, nullptr);
+    return true;
+}
+
+static string json_string(const string& line, const string& field) {
+    size_t at = line.find("\"" + field + "\":\"");
+    if (at == string::npos) return "";
+    at += field.size() + 4;
+    return line.substr(at, line.find('"', at) - at);
+}
+
+// Compara contra una salida anterior; devuelve la cantidad de regresiones
+static size_t compare_baseline(const vector<Result>& results, const string& path, double tolerance) {
+    ifstream in(path);
+    if (!in) throw runtime_error("No se pudo abrir el archivo: " + path);
+    map<string, double> baseline;
+    string line;
+    while (getline(in, line)) {
+        double rate;
+        string name = json_string(line, "benchmark");
+        if (!name.empty() && json_number(line, "items_per_second", rate)) baseline[name] = rate;
+    }
+
+    size_t regressions = 0;
+    for (const Result& result : results) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end()) continue;
+        double ratio = result.items_per_second() / it->second;
+        if (ratio < 1 - tolerance) {
+            cerr << "Regresión en " << result.name << ": " << result.items_per_second() << " ítems/s contra "
+                 << it->second << " (" << static_cast<int>((1 - ratio) * 100) << "% menos)\n";
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+static bool parse_corpus_option(const string& arg, int& i, int argc, char* argv[], CorpusSpec& corpus) {
+    if (i + 1 >= argc) return false;
+    if (arg == "--seed") corpus.seed = stoull(argv[++i]);
+    else if (arg == "--vocabulary") corpus.vocabulary = static_cast<uint32_t>(stoul(argv[++i]));
+    else if (arg == "--zipf") corpus.zipf = stod(argv[++i]);
+    else if (arg == "--docs") corpus.documents = static_cast<uint32_t>(stoul(argv[++i]));
+    else if (arg == "--mean-length") corpus.mean_length = stod(argv[++i]);
+    else if (arg == "--sigma") corpus.length_sigma = stod(argv[++i]);
+    else if (arg == "--lengths") {
+        string kind = argv[++i];
+        if (kind == "fixed") corpus.lengths = LengthDistribution::Fixed;
+        else if (kind == "uniform") corpus.lengths = LengthDistribution::Uniform;
+        else if (kind == "lognormal") corpus.lengths = LengthDistribution::LogNormal;
+        else throw runtime_error("Distribución de longitudes desconocida: " + kind);
+    } else return false;
+    return true;
+}
+
+int main(int argc, char* argv[]) try {
+    Options options;
+    if (argc > 1 && string(argv[1]) == "generate") {
+        if (argc < 4) {
+            cerr << "Uso: benchmark generate <prefijo> <archivos> [opciones del corpus]\n";
+            return 1;
+        }
+        for (int i = 4; i < argc; ++i) {
+            if (!parse_corpus_option(argv[i], i, argc, argv, options.corpus)) {
+                cerr << "Opción desconocida: " << argv[i] << endl;
+                return 1;
+            }
+        }
+        CorpusGenerator generator(options.corpus);
+        for (const string& path : generator.write_files(argv[2], stoul(argv[3]))) cout << path << "\n";
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (parse_corpus_option(arg, i, argc, argv, options.corpus)) continue;
+        if (arg == "--repeat" && i + 1 < argc) options.repeat = max<size_t>(1, stoul(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) options.threads = max<size_t>(1, stoul(argv[++i]));
+        else if (arg == "--dir" && i + 1 < argc) options.dir = argv[++i];
+        else if (arg == "--only" && i + 1 < argc) options.only = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) options.baseline = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc) options.tolerance = stod(argv[++i]);
+        else {
+            cerr << "Opción desconocida: " << arg << endl;
+            return 1;
+        }
+    }
+
+    // Corpus en memoria: rangos de cada documento y, por término, sus docs
+    const CorpusSpec& spec = options.corpus;
+    CorpusGenerator generator(spec);
+    vector<vector<uint32_t>> documents(spec.documents);
+    vector<vector<uint32_t>> postings(spec.vocabulary);
+    uint64_t tokens = 0, posting_count = 0;
+    for (uint32_t doc = 0; doc < spec.documents; ++doc) {
+        generator.next_document(documents[doc]);
+        tokens += documents[doc].size();
+        for (uint32_t rank : documents[doc]) {
+            if (postings[rank].empty() || postings[rank].back() != doc) postings[rank].push_back(doc);
+        }
+    }
+    vector<string> words(spec.vocabulary);
+    for (uint32_t rank = 0; rank < spec.vocabulary; ++rank) words[rank] = CorpusGenerator::word(rank);
+    size_t used_terms = 0;
+    for (const auto& list : postings) {
+        posting_count += list.size();
+        if (!list.empty()) ++used_terms;
+    }
+
+    cout << "{\"corpus\":{\"seed\":" << spec.seed << ",\"vocabulary\":" << spec.vocabulary << ",\"zipf\":" << spec.zipf
+         << ",\"documents\":" << spec.documents << ",\"lengths\":\"" << length_name(spec.lengths)
+         << "\",\"mean_length\":" << spec.mean_length << ",\"sigma\":" << spec.length_sigma
+         << "},\"tokens\":" << tokens << ",\"postings\":" << posting_count << ",\"terms\":" << used_terms
+         << ",\"threads\":" << options.threads << "}" << endl;
+
+    Runner runner(options);
+
+    // GammaEncoder sobre cada lista completa
+    Result* result;
+    if (runner.selected("gamma_")) {
+        vector<string> gamma(spec.vocabulary);
+        uint64_t gamma_bytes = 0;
+        auto encode = [&] {
+            gamma_bytes = 0;
+            for (uint32_t rank = 0; rank < spec.vocabulary; ++rank) {
+                gamma[rank] = GammaEncoder::encode(postings[rank]);
+                gamma_bytes += gamma[rank].size();
+            }
+            return posting_count;
+        };
+        result = runner.run("gamma_encode", encode);
+        if (result) {
+            result->extra.push_back({"bits_per_posting", 8.0 * gamma_bytes / posting_count});
+            runner.print(result);
+        } else {
+            encode();
+        }
+        vector<uint32_t> decoded;
+        runner.print(runner.run("gamma_decode", [&] {
+            uint64_t count = 0;
+            for (const string& encoded : gamma) {
+                decoded.clear();
+                GammaEncoder::decode(encoded.data(), encoded.size(), decoded);
+                count += decoded.size();
+            }
+            return count;
+        }));
+    }
+
+    // Cada códec por bloques de POSTING_BLOCK con IDs relativos al bloque, como en el índice
+    for (CodecType codec : {CodecType::Gamma, CodecType::StreamVByte, CodecType::PForDelta, CodecType::BP128}) {
+        string name = codec_name(codec);
+        if (!runner.selected("codec_encode/" + name) && !runner.selected("codec_decode/" + name)) continue;
+        vector<string> encoded(spec.vocabulary);
+        uint32_t relative[POSTING_BLOCK];
+        auto encode = [&] {
+            for (uint32_t rank = 0; rank < spec.vocabulary; ++rank) {
+                const vector<uint32_t>& list = postings[rank];
+                encoded[rank].clear();
+                for (size_t begin = 0; begin < list.size(); begin += POSTING_BLOCK) {
+                    size_t n = min(POSTING_BLOCK, list.size() - begin);
+                    for (size_t i = 0; i < n; ++i) relative[i] = list[begin + i] - list[begin];
+                    PostingCodec::encode(codec, relative, n, encoded[rank]);
+                }
+            }
+            return posting_count;
+        };
+        result = runner.run("codec_encode/" + name, encode);
+        if (result) {
+            uint64_t bytes = 0;
+            for (const string& list : encoded) bytes += list.size();
+            result->extra.push_back({"bits_per_posting", 8.0 * bytes / posting_count});
+            runner.print(result);
+        } else {
+            encode();
+        }
+
+        uint32_t block[POSTING_BLOCK];
+        runner.print(runner.run("codec_decode/" + name, [&] {
+            uint64_t count = 0, checksum = 0;
+            for (uint32_t rank = 0; rank < spec.vocabulary; ++rank) {
+                const string& bytes = encoded[rank];
+                size_t at = 0;
+                for (size_t left = postings[rank].size(); left > 0;) {
+                    size_t n = min(POSTING_BLOCK, left);
+                    at += PostingCodec::decode(codec, bytes.data() + at, bytes.size() - at, n, block);
+                    checksum += block[n - 1];
+                    count += n;
+                    left -= n;
+                }
+            }
+            return count + (checksum == UINT64_MAX);
+        }));
+    }
+
+    // Búsquedas en el léxico: términos con la distribución del corpus y un 10% que no está
+    vector<string> queries;
+    {
+        CorpusSpec query_spec = spec;
+        query_spec.seed = spec.seed + 1;
+        CorpusGenerator query_generator(query_spec);
+        for (size_t i = 0; i < 200000; ++i) {
+            queries.push_back(i % 10 == 9 ? CorpusGenerator::word(spec.vocabulary + static_cast<uint32_t>(i))
+                                          : words[query_generator.next_rank()]);
+        }
+    }
+    if (runner.selected("lexicon_lookup")) {
+        vector<string> sorted_words = words;
+        sort(sorted_words.begin(), sorted_words.end());
+        FrontCodeLexicon lexicon;
+        for (const string& word : sorted_words) lexicon.append_sorted(word);
+        runner.print(runner.run("lexicon_lookup", [&] {
+            uint64_t found = 0;
+            for (const string& query : queries) found += lexicon.get_term_id(query) != FrontCodeLexicon::NOT_FOUND;
+            return queries.size() + (found == UINT64_MAX);
+        }));
+    }
+
+    // Indexado en memoria con InvertedIndex::add_documents y búsquedas sobre ese índice
+    if (runner.selected("index_")) {
+        vector<pair<uint32_t, vector<string>>> batch(spec.documents);
+        for (uint32_t doc = 0; doc < spec.documents; ++doc) {
+            batch[doc].first = doc;
+            for (uint32_t rank : documents[doc]) batch[doc].second.push_back(words[rank]);
+        }
+        InvertedIndex index;
+        runner.print(runner.run("index_add_documents", [&] {
+            index = InvertedIndex();
+            index.add_documents(batch);
+            return tokens;
+        }));
+        if (index.term_count() == 0) index.add_documents(batch);
+        runner.print(runner.run("index_search", [&] {
+            uint64_t decoded = 0;
+            for (size_t i = 0; i < queries.size(); i += 4) decoded += index.search(queries[i]).size();
+            return (queries.size() + 3) / 4 + (decoded == UINT64_MAX);
+        }));
+    }
+
+    // De punta a punta desde archivos (un documento por línea)
+    if (runner.selected("end_to_end")) {
+        fs::create_directories(options.dir);
+        CorpusGenerator file_generator(spec);
+        vector<string> files = file_generator.write_files((fs::path(options.dir) / "corpus").string(),
+                                                          max<size_t>(options.threads, 4));
+        uint64_t file_bytes = 0;
+        for (const string& file : files) file_bytes += fs::file_size(file);
+        ThreadPool pool(options.threads);
+
+        // Pipeline y fusión por particiones, sin escribir el índice
+        result = runner.run("end_to_end/pipeline", [&] {
+            CorpusSplitter corpus(files, DocumentModel::per_line());
+            PipelineOptions pipeline_options;
+            pipeline_options.tokenizers = max<size_t>(1, options.threads / 4);
+            pipeline_options.indexers = max<size_t>(1, options.threads - pipeline_options.tokenizers);
+            IndexPipeline pipeline(corpus, pipeline_options);
+            pipeline.run(pool);
+            vector<const TermAccumulator*> sources = pipeline.sources();
+            vector<size_t> terms(pipeline.settings().partitions);
+            for (size_t p = 0; p < terms.size(); ++p) {
+                pool.submit([&, p](size_t) { terms[p] = merge_partition(sources, p).size(); });
+            }
+            pool.wait();
+            uint64_t count = 0;
+            for (const TermAccumulator* source : sources) count += source->token_count();
+            return count;
+        });
+        if (result) {
+            result->bytes = file_bytes;
+            runner.print(result);
+        }
+
+        // SPIMI con presupuesto chico, hasta lexicon.dat / docids.dat
+        result = runner.run("end_to_end/spimi", [&] {
+            CorpusSplitter corpus(files, DocumentModel::per_line());
+            SpimiOptions spimi;
+            spimi.memory_budget = size_t(16) << 20;
+            spimi.temp_directory = options.dir;
+            vector<unique_ptr<SpimiIndexer>> indexers;
+            for (size_t i = 0; i < pool.size(); ++i) indexers.push_back(make_unique<SpimiIndexer>(spimi));
+            corpus.tokenize(pool, [&](size_t worker, string_view term, uint32_t doc) {
+                indexers[worker]->add_token(term, doc);
+            });
+            vector<SpimiIndexer*> all;
+            uint64_t count = 0;
+            for (auto& indexer : indexers) {
+                all.push_back(indexer.get());
+                count += indexer->token_count();
+            }
+            SpimiIndexer::merge(all, (fs::path(options.dir) / "lexicon.dat").string(),
+                                (fs::path(options.dir) / "docids.dat").string());
+            return count;
+        });
+        if (result) {
+            result->bytes = file_bytes;
+            runner.print(result);
+        }
+    }
+
+    if (!options.baseline.empty() && compare_baseline(runner.all(), options.baseline, options.tolerance) > 0) {
+        return 2;
+    }
+    return 0;
+} catch (const exception& e) {
+    cerr << "Error: " << e.what() << endl;
+    return 1;
+}
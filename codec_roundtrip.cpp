@@ -0,0 +1,146 @@
+// Prueba de ida y vuelta de los códecs de PostingCodecs.h: empaqueta y
+// desempaqueta bloques de 128 valores en cada ancho de bit (0 a 32) y
+// codifica y decodifica listas de cada códec con huecos de cada ancho, con
+// colas de todos los largos y con listas al azar. Cada lista se decodifica
+// desde una copia del tamaño justo, así que una lectura de más también se ve
+// (con -fsanitize=address). Termina con 1 si algo no vuelve igual.
+//
+// Las rutas de decodificación se eligen al compilar; para probar las tres:
+//
+// Compilar: g++ -O2 -std=c++17 -mavx2 codec_roundtrip.cpp -o codec_roundtrip
+//           g++ -O2 -std=c++17 -msse4.1 codec_roundtrip.cpp -o codec_roundtrip_sse
+//           g++ -O2 -std=c++17 codec_roundtrip.cpp -o codec_roundtrip_scalar
+#include "PostingCodecs.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+static const CodecType CODECS[] = {CodecType::Gamma, CodecType::StreamVByte, CodecType::PForDelta, CodecType::BP128};
+
+static size_t failures = 0;
+
+static void fail(const string& what) {
+    if (++failures <= 20) cerr << "FALLA: " << what << endl;
+}
+
+static uint32_t bits_mask(unsigned bits) { return bits == 32 ? ~0u : (1u << bits) - 1; }
+
+// pack128 / unpack128 con valores al azar que usan justo 'bits' bits
+static void check_blocks(mt19937& rng) {
+    for (unsigned bits = 0; bits <= 32; ++bits) {
+        for (int round = 0; round < 8; ++round) {
+            uint32_t in[codec_detail::BLOCK];
+            for (uint32_t& v : in) v = rng() & bits_mask(bits);
+            if (bits > 0) in[rng() % codec_detail::BLOCK] |= 1u << (bits - 1);
+
+            string packed;
+            codec_detail::pack128(in, bits, packed);
+            if (packed.size() != bits * 16) fail("pack128 de " + to_string(bits) + " bits ocupa " + to_string(packed.size()));
+            unique_ptr<char[]> exact(new char[packed.size() + 1]);
+            memcpy(exact.get(), packed.data(), packed.size());
+
+            uint32_t out[codec_detail::BLOCK];
+            codec_detail::unpack128(exact.get(), bits, out);
+            if (memcmp(in, out, sizeof(in)) != 0) fail("unpack128 de " + to_string(bits) + " bits");
+        }
+    }
+}
+
+static void check_list(CodecType codec, const vector<uint32_t>& docs, const string& label) {
+    string encoded;
+    PostingCodec::encode(codec, docs.data(), docs.size(), encoded);
+    unique_ptr<char[]> exact(new char[encoded.size() + 1]);
+    memcpy(exact.get(), encoded.data(), encoded.size());
+
+    vector<uint32_t> decoded(docs.size() + 1, 0xDEADBEEF);
+    size_t used;
+    try {
+        used = PostingCodec::decode(codec, exact.get(), encoded.size(), docs.size(), decoded.data());
+    } catch (const exception& e) {
+        fail(string(codec_name(codec)) + " " + label + ": " + e.what());
+        return;
+    }
+    string name = string(codec_name(codec)) + " " + label + " (" + to_string(docs.size()) + " docs)";
+    if (used != encoded.size()) fail(name + ": consumió " + to_string(used) + " de " + to_string(encoded.size()) + " bytes");
+    if (!equal(docs.begin(), docs.end(), decoded.begin())) fail(name + ": valores distintos");
+    if (decoded[docs.size()] != 0xDEADBEEF) fail(name + ": escribió de más");
+}
+
+// Lista de 'n' docs cuyos huecos usan a lo sumo 'bits' bits y, mientras
+// alcance el rango de 32 bits, uno por bloque de 128 usa exactamente 'bits'
+static vector<uint32_t> list_with_bits(mt19937& rng, size_t n, unsigned bits) {
+    vector<uint32_t> docs;
+    uint64_t doc = 0;
+    unsigned small = min(bits, 6u);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t gap;
+        if (i % codec_detail::BLOCK == 0 && bits > 0) {
+            gap = (uint64_t(1) << (bits - 1)) | (rng() & bits_mask(bits - 1));
+        } else {
+            gap = 1 + (rng() & bits_mask(small));
+            if (gap >= (uint64_t(1) << bits)) gap = 1;
+        }
+        if (i == 0) gap -= 1; // el primero puede ser 0
+        if (doc + gap > UINT32_MAX) gap = 1;
+        if (doc + gap > UINT32_MAX) break;
+        doc += gap;
+        docs.push_back(static_cast<uint32_t>(doc));
+    }
+    return docs;
+}
+
+static vector<uint32_t> random_list(mt19937& rng, size_t n) {
+    vector<uint32_t> docs;
+    uint64_t doc = rng() % 1000;
+    for (size_t i = 0; i < n && doc <= UINT32_MAX; ++i) {
+        docs.push_back(static_cast<uint32_t>(doc));
+        // Mayormente chicos con algunos saltos grandes (excepciones de PForDelta)
+        doc += rng() % 100 == 0 ? 1 + rng() % (1u << 20) : 1 + rng() % 64;
+    }
+    return docs;
+}
+
+int main() {
+#if defined(__AVX2__)
+    const char* path = "avx2";
+#elif defined(__SSE4_1__)
+    const char* path = "sse4.1";
+#else
+    const char* path = "escalar";
+#endif
+    mt19937 rng(12345);
+    size_t lists = 0;
+
+    check_blocks(rng);
+
+    for (CodecType codec : CODECS) {
+        check_list(codec, {}, "vacía");
+        check_list(codec, {0}, "solo 0");
+        check_list(codec, {UINT32_MAX}, "solo el máximo");
+        lists += 3;
+        for (unsigned bits = 1; bits <= 32; ++bits) {
+            for (size_t n : {size_t(1), size_t(127), size_t(128), size_t(129), size_t(1000)}) {
+                check_list(codec, list_with_bits(rng, n, bits), to_string(bits) + " bits");
+                ++lists;
+            }
+        }
+        for (size_t n = 0; n <= 300; ++n) {
+            check_list(codec, random_list(rng, n), "cola de " + to_string(n));
+            ++lists;
+        }
+        for (int round = 0; round < 200; ++round) {
+            check_list(codec, random_list(rng, rng() % 5000), "al azar");
+            ++lists;
+        }
+    }
+
+    cout << "ruta " << path << ": " << lists << " listas y " << 33 * 8 << " bloques, " << failures << " fallas" << endl;
+    return failures == 0 ? 0 : 1;
+}
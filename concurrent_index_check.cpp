@@ -0,0 +1,236 @@
+// Prueba de ConcurrentIndex, con fusiones de fondo y sin ellas:
+//  - cada tanto toma un Snapshot y compara sus consultas con un InvertedIndex
+//    armado con los mismos documentos; al final, después de todas las fusiones,
+//    cada Snapshot tiene que seguir dando exactamente lo mismo;
+//  - el índice final da lo mismo que el de referencia;
+//  - con lectores tomando Snapshots mientras dos escritores agregan documentos,
+//    cada Snapshot ve una versión entera: el término que tienen todos los
+//    documentos aparece en tantos como dice document_count(), sin repetidos, y
+//    las versiones que ve un lector nunca retroceden.
+// La última parte está pensada para -fsanitize=thread; con TSan conviene
+// achicar los argumentos (por ejemplo, 1500 2). Termina con 1 si algo difiere.
+//
+// Uso: concurrent_index_check [documentos] [lectores]
+// Compilar: g++ -O2 -std=c++17 -pthread concurrent_index_check.cpp -o concurrent_index_check
+#include "ConcurrentIndex.h"
+#include "CorpusGenerator.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+static size_t failures = 0;
+static mutex failures_mutex;
+
+static void fail(const string& what) {
+    lock_guard<mutex> lock(failures_mutex);
+    if (++failures <= 20) cerr << "FALLA: " << what << endl;
+}
+
+static const string EVERY_DOC = "todos";
+
+static vector<pair<uint32_t, vector<string>>> make_documents(uint32_t count) {
+    CorpusSpec spec;
+    spec.documents = count;
+    spec.vocabulary = 2000;
+    spec.mean_length = 30;
+    CorpusGenerator generator(spec);
+    vector<pair<uint32_t, vector<string>>> documents(count);
+    vector<uint32_t> ranks;
+    for (uint32_t doc = 0; doc < count; ++doc) {
+        generator.next_document(ranks);
+        documents[doc].first = doc;
+        for (uint32_t rank : ranks) documents[doc].second.push_back(CorpusGenerator::word(rank));
+        documents[doc].second.push_back(EVERY_DOC);
+    }
+    return documents;
+}
+
+static vector<string> make_queries() {
+    vector<string> queries;
+    for (uint32_t r = 0; r < 40; ++r) {
+        string a = CorpusGenerator::word(r), b = CorpusGenerator::word(r + 1), c = CorpusGenerator::word(r * 7 + 3);
+        queries.push_back(a);
+        queries.push_back(c);
+        queries.push_back(a + " AND " + c);
+        queries.push_back(a + " OR " + c);
+        queries.push_back(b + " NOT " + a);
+        queries.push_back(c.substr(0, 2) + "*");
+    }
+    return queries;
+}
+
+static bool same_ranking(const vector<ScoredDoc>& a, const vector<ScoredDoc>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].doc != b[i].doc || fabs(a[i].score - b[i].score) > 1e-9 * max(1.0, fabs(b[i].score))) return false;
+    }
+    return true;
+}
+
+// Resultados de un Snapshot guardados al tomarlo
+struct Checkpoint {
+    ConcurrentIndex::Snapshot snapshot;
+    uint64_t documents;
+    vector<vector<uint32_t>> results;
+    vector<vector<ScoredDoc>> rankings;
+};
+
+static Checkpoint take_checkpoint(const ConcurrentIndex& index, const vector<string>& queries) {
+    Checkpoint checkpoint{index.snapshot(), 0, {}, {}};
+    checkpoint.documents = checkpoint.snapshot.document_count();
+    for (const auto& query : queries) {
+        checkpoint.results.push_back(checkpoint.snapshot.search(query));
+        checkpoint.rankings.push_back(checkpoint.snapshot.top_k(query, 10));
+    }
+    return checkpoint;
+}
+
+static void compare(const string& where, const Checkpoint& checkpoint, const InvertedIndex& reference,
+                    const vector<string>& queries) {
+    QueryEngine engine(reference);
+    for (size_t q = 0; q < queries.size(); ++q) {
+        if (checkpoint.results[q] != engine.search(queries[q])) fail(where + ": search de \"" + queries[q] + "\"");
+        if (!same_ranking(checkpoint.rankings[q], engine.top_k(queries[q], 10))) {
+            fail(where + ": top_k de \"" + queries[q] + "\"");
+        }
+    }
+}
+
+// Snapshots tomados durante la carga, comparados al tomarlos y al final
+static void check_versions(bool background, const vector<pair<uint32_t, vector<string>>>& documents,
+                           const vector<string>& queries) {
+    string mode = background ? "con fusiones de fondo" : "sin hilo de fusión";
+    ConcurrentIndexOptions options;
+    options.publish_documents = 50;
+    options.base_postings = 512;
+    options.merge_factor = 3;
+    options.background_merges = background;
+    ConcurrentIndex index(options);
+    vector<Checkpoint> checkpoints; // se destruyen antes que el índice
+
+    InvertedIndex reference;
+    for (size_t d = 0; d < documents.size(); ++d) {
+        index.add_document(documents[d].first, documents[d].second);
+        reference.add_document(documents[d].first, documents[d].second);
+        if ((d + 1) % 400 == 0) {
+            index.publish();
+            checkpoints.push_back(take_checkpoint(index, queries));
+            if (checkpoints.back().documents != d + 1) {
+                fail(mode + ": el Snapshot tiene " + to_string(checkpoints.back().documents) +
+                     " documentos en lugar de " + to_string(d + 1));
+            }
+            compare(mode + ", " + to_string(d + 1) + " documentos", checkpoints.back(), reference, queries);
+        }
+    }
+    index.publish();
+    index.wait_for_merges();
+    if (index.merge_count() == 0) fail(mode + ": no hubo ninguna fusión");
+
+    // Las versiones viejas no cambian aunque sus partes se hayan fusionado
+    for (size_t c = 0; c < checkpoints.size(); ++c) {
+        const Checkpoint& old = checkpoints[c];
+        for (size_t q = 0; q < queries.size(); ++q) {
+            if (old.snapshot.search(queries[q]) != old.results[q] ||
+                !same_ranking(old.snapshot.top_k(queries[q], 10), old.rankings[q])) {
+                fail(mode + ": el Snapshot " + to_string(c) + " cambió en \"" + queries[q] + "\"");
+            }
+        }
+    }
+    Checkpoint last = take_checkpoint(index, queries);
+    compare(mode + ", índice final", last, reference, queries);
+    cout << mode << ": " << checkpoints.size() << " Snapshots, " << index.merge_count() << " fusiones, "
+         << last.snapshot.part_count() << " partes al final" << endl;
+}
+
+// Lectores y escritores a la vez
+static void stress(bool background, const vector<pair<uint32_t, vector<string>>>& documents, size_t readers) {
+    string mode = background ? "con fusiones de fondo" : "sin hilo de fusión";
+    ConcurrentIndexOptions options;
+    options.publish_documents = 20;
+    options.base_postings = 256;
+    options.merge_factor = 3;
+    options.background_merges = background;
+    ConcurrentIndex index(options);
+
+    atomic<bool> done{false};
+    atomic<size_t> snapshots{0};
+    vector<thread> threads;
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            uint64_t last_version = 0, last_documents = 0;
+            for (size_t i = r; !done.load(); ++i) {
+                ConcurrentIndex::Snapshot snapshot = index.snapshot();
+                vector<uint32_t> every = snapshot.term_docs(EVERY_DOC);
+                if (every.size() != snapshot.document_count() ||
+                    adjacent_find(every.begin(), every.end()) != every.end()) {
+                    fail(mode + ": versión " + to_string(snapshot.version_number()) + " con " +
+                         to_string(every.size()) + " documentos en lugar de " + to_string(snapshot.document_count()));
+                }
+                if (snapshot.version_number() < last_version || snapshot.document_count() < last_documents) {
+                    fail(mode + ": un lector vio la versión " + to_string(snapshot.version_number()) +
+                         " después de la " + to_string(last_version));
+                }
+                last_version = snapshot.version_number();
+                last_documents = snapshot.document_count();
+                snapshot.search(CorpusGenerator::word(i % 50) + " OR " + CorpusGenerator::word(i % 7));
+                snapshot.top_k(CorpusGenerator::word(i % 20), 5);
+                ++snapshots;
+            }
+        });
+    }
+    // Dos escritores, con los doc IDs pares y los impares
+    vector<thread> writers;
+    for (size_t w = 0; w < 2; ++w) {
+        writers.emplace_back([&, w] {
+            for (size_t d = w; d < documents.size(); d += 2) index.add_document(documents[d].first, documents[d].second);
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    index.publish();
+    index.wait_for_merges();
+    done = true;
+    for (auto& thread : threads) thread.join();
+
+    ConcurrentIndex::Snapshot last = index.snapshot();
+    if (last.term_docs(EVERY_DOC).size() != documents.size() || last.document_count() != documents.size()) {
+        fail(mode + ": quedaron " + to_string(last.document_count()) + " documentos de " +
+             to_string(documents.size()));
+    }
+    cout << mode << ": " << snapshots.load() << " Snapshots con " << readers << " lectores, "
+         << index.merge_count() << " fusiones" << endl;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(stoul(argv[1])) : 4000;
+    size_t readers = argc > 2 ? stoul(argv[2]) : 3;
+    vector<pair<uint32_t, vector<string>>> documents = make_documents(count);
+    vector<string> queries = make_queries();
+
+    for (bool background : {true, false}) {
+        check_versions(background, documents, queries);
+        stress(background, documents, readers);
+    }
+
+    // Destruir el índice con una fusión de fondo en curso
+    {
+        ConcurrentIndexOptions options;
+        options.publish_documents = 10;
+        options.base_postings = 64;
+        ConcurrentIndex index(options);
+        for (size_t d = 0; d < documents.size() && d < 500; ++d) {
+            index.add_document(documents[d].first, documents[d].second);
+        }
+    }
+
+    cout << failures << " fallas" << endl;
+    return failures == 0 ? 0 : 1;
+}
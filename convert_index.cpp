@@ -0,0 +1,56 @@
+// Convierte índices guardados con formatos antiguos al formato empaquetado actual.
+//
+//   convert_index --raw invertedIndex.dat lexicon.dat docids.dat
+//       Importa el volcado crudo (término + doc IDs de 32 bits).
+//   convert_index --legacy lexicon.dat docids.dat [lexicon_out docids_out]
+//       Reescribe un docids.dat con un char '0'/'1' por bit.
+//   convert_index --compact lexicon.dat docids.dat
+//       Reescribe las listas de forma contigua y descarta el espacio sin uso.
+//
+// Compilar: g++ -O2 -std=c++17 convert_index.cpp -o convert_index
+#include "InvertedIndex.h"
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Uso: " << argv[0] << " --raw <invertedIndex.dat> <lexicon_out> <docids_out>\n"
+             << "     " << argv[0] << " --legacy <lexicon> <docids> [lexicon_out docids_out]\n"
+             << "     " << argv[0] << " --compact <lexicon> <docids>\n";
+        return 1;
+    }
+
+    try {
+        string mode = argv[1];
+        InvertedIndex index;
+
+        if (mode == "--raw" && argc >= 5) {
+            index.import_raw_index(argv[2]);
+            index.save_to_files(argv[3], argv[4]);
+        } else if (mode == "--legacy") {
+            // load_from_files detecta el formato antiguo y lo convierte al cargar
+            index.load_from_files(argv[2], argv[3]);
+            string lexicon_out = argc >= 6 ? argv[4] : argv[2];
+            string docids_out = argc >= 6 ? argv[5] : argv[3];
+            index.save_to_files(lexicon_out, docids_out);
+        } else if (mode == "--compact") {
+            index.load_from_files(argv[2], argv[3]);
+            size_t reclaimed = index.compact();
+            index.save_to_files(argv[2], argv[3]);
+            cout << "Bytes recuperados: " << reclaimed << "\n";
+        } else {
+            cerr << "Modo desconocido: " << mode << endl;
+            return 1;
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Excepción: " << e.what() << endl;
+        return 1;
+    }
+
+    cout << "Índice convertido exitosamente.\n";
+    return 0;
+}
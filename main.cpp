@@ -8,7 +8,7 @@
 #include <vector>
 #include <omp.h>
 #include <mutex>
-#include <locale>
+#include <string_view>
 #include <filesystem>
 #include <algorithm>
 #include <memory>
@@ -16,6 +16,9 @@
 #include <chrono>
 #include <stdexcept>
 
+#include "CorpusSplitter.h"
+#include "ThreadPool.h"
+
 namespace fs = std::filesystem;
 using namespace std;
 using namespace chrono;
@@ -24,57 +27,12 @@ struct ThreadIndex {
     unordered_map<string, unordered_set<int>> localIndex;
     mutex mtx;
 
-    void addWord(const string& word, int docID) {
+    void addWord(string_view word, int docID) {
         lock_guard<mutex> lock(mtx);
-        localIndex[word].insert(docID);
+        localIndex[string(word)].insert(docID);
     }
 };
 
-// Función para procesar el archivo con mmap
-void processFileWithMmap(const string& filename, int docID, ThreadIndex& threadIndex) {
-    try {
-        int fd = open(filename.c_str(), O_RDONLY);
-        if (fd == -1) {
-            throw runtime_error("Error al abrir el archivo: " + filename);
-        }
-
-        struct stat sb;
-        if (fstat(fd, &sb) == -1) {
-            throw runtime_error("Error al obtener el tamaño del archivo: " + filename);
-        }
-
-        size_t fileSize = sb.st_size;
-        char* fileContent = (char*)mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
-        if (fileContent == MAP_FAILED) {
-            throw runtime_error("Error al mapear el archivo a memoria: " + filename);
-        }
-
-        const size_t chunkSize = 64 * 1024 * 1024; // 64 MB por bloque
-        size_t remaining = fileSize;
-
-        while (remaining > 0) {
-            const size_t readSize = min(chunkSize, remaining);
-            char* start = fileContent + (fileSize - remaining);
-            char* end = start + readSize;
-
-            if (end > fileContent + fileSize) {
-                end = fileContent + fileSize;
-            }
-
-            processChunk(start, end, docID, threadIndex);
-            remaining -= readSize;
-        }
-
-        if (munmap(fileContent, fileSize) == -1) {
-            throw runtime_error("Error al desmapear el archivo.");
-        }
-        close(fd);
-    }
-    catch (const exception& e) {
-        cerr << "Excepción: " << e.what() << endl;
-    }
-}
-
 // Función para fusionar los índices con manejo de excepciones
 void mergeIndexes(vector<unique_ptr<ThreadIndex>>& threadIndexes, unordered_map<string, unordered_set<int>>& globalIndex) {
     try {
@@ -112,7 +70,30 @@ void mergeIndexes(vector<unique_ptr<ThreadIndex>>& threadIndexes, unordered_map<
     }
 }
 
-int main() {
+void saveIndexToTxt(const unordered_map<string, unordered_set<int>>& index, const string& filename) {
+    ofstream outFile(filename);
+    if (!outFile.is_open()) {
+        throw runtime_error("No se pudo abrir el archivo para guardar el índice: " + filename);
+    }
+
+    vector<pair<string, unordered_set<int>>> sortedIndex(index.begin(), index.end());
+    sort(sortedIndex.begin(), sortedIndex.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (const auto& entry : sortedIndex) {
+        outFile << entry.first << ":";
+        vector<int> sortedDocs(entry.second.begin(), entry.second.end());
+        sort(sortedDocs.begin(), sortedDocs.end());
+        for (int docID : sortedDocs) {
+            outFile << " " << docID;
+        }
+        outFile << "\n";
+    }
+}
+
+// Uso: main [archivos...]; cada archivo es un documento. Los archivos se parten
+// en tramos alineados a palabras que indexan todos los hilos (ver CorpusSplitter.h).
+int main(int argc, char* argv[]) {
     try {
         auto start = high_resolution_clock::now();
 
@@ -120,18 +101,19 @@ int main() {
         cout << "Usando " << numThreads << " hilos disponibles\n";
         omp_set_num_threads(numThreads);
 
-        vector<string> files = {"file1.txt", "file2.txt", "file3.txt", "file4.txt"};
+        vector<string> files(argv + 1, argv + argc);
+        if (files.empty()) files = {"file1.txt", "file2.txt", "file3.txt", "file4.txt"};
         vector<unique_ptr<ThreadIndex>> threadIndexes(numThreads);
 
         for (auto& ti : threadIndexes) {
             ti = make_unique<ThreadIndex>();
         }
 
-        #pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < files.size(); ++i) {
-            int threadNum = omp_get_thread_num();
-            processFileWithMmap(files[i], i, *threadIndexes[threadNum]);
-        }
+        ThreadPool pool(numThreads);
+        CorpusSplitter corpus(files, DocumentModel::per_file());
+        corpus.tokenize(pool, [&](size_t worker, string_view word, uint32_t docID) {
+            threadIndexes[worker]->addWord(word, static_cast<int>(docID));
+        });
 
         unordered_map<string, unordered_set<int>> globalIndex;
         mergeIndexes(threadIndexes, globalIndex);
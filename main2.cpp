@@ -1,207 +1,420 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <unordered_map>
-#include <unordered_set>
 #include <string>
 #include <cctype>
 #include <vector>
 #include <omp.h>
-#include <mutex>
-#include <locale>
+#include <string_view>
 #include <filesystem>
 #include <algorithm>
 #include <memory>
 #include <cstring>
 #include <chrono>
 
+#include "SpimiIndexer.h"
+#include "TermAccumulator.h"
+#include "IndexPipeline.h"
+#include "CorpusSplitter.h"
+#include "ThreadPool.h"
+#include "Metrics.h"
+
 namespace fs = std::filesystem;
 using namespace std;
 using namespace chrono;
 
-// Estructura para manejar el índice por hilos
-struct ThreadIndex {
-    unordered_map<string, unordered_set<int>> localIndex;
-    mutex mtx;
+// Acumulador SPIMI por hilo: vuelca corridas a disco al llenar su parte del
+// presupuesto de memoria
+struct SpimiThreadIndex {
+    SpimiIndexer indexer;
+
+    explicit SpimiThreadIndex(const SpimiOptions& options) : indexer(options) {}
 
-    void addWord(const string& word, int docID) {
-        lock_guard<mutex> lock(mtx);
-        localIndex[word].insert(docID);
+    void addWord(string_view word, int docID) {
+        indexer.add_token(word, static_cast<uint32_t>(docID));
     }
 };
 
-string normalizeWord(const string &word) {
-    string normalized;
-    locale loc;
-
-    normalized.reserve(word.size());
-    for (auto &ch : word) {
-        if (isalpha(ch, loc)) {
-            normalized += tolower(ch, loc);
-        }
+// Fusiona los acumuladores: el shard p (los términos cuyo hash cae en la
+// partición p) lo arma una sola tarea leyendo la partición p de cada uno, así
+// que no hay locks ni un mapa compartido. Cada shard sale ordenado.
+vector<vector<MergedTerm>> mergeIndexes(ThreadPool& pool, const vector<const TermAccumulator*>& sources) {
+    size_t shards = sources.empty() ? 0 : sources[0]->partition_count();
+    vector<vector<MergedTerm>> merged(shards);
+    for (size_t p = 0; p < shards; ++p) {
+        pool.submit([&, p](size_t) { merged[p] = merge_partition(sources, p); });
     }
-    return normalized;
+    pool.wait();
+    return merged;
 }
 
-void processChunk(const char* start, const char* end, int docID, ThreadIndex& threadIndex) {
-    const char* p = start;
-    const char* wordStart = p;
-    string word;
-    
-    while (p != end) {
-        if (isspace(*p)) {
-            if (wordStart != p) {
-                word.assign(wordStart, p);
-                string normalized = normalizeWord(word);
-                if (!normalized.empty()) {
-                    threadIndex.addWord(normalized, docID);
-                }
-            }
-            wordStart = p + 1;
-        }
-        ++p;
-    }
-    
-    // Procesar la última palabra si existe
-    if (wordStart != p) {
-        word.assign(wordStart, p);
-        string normalized = normalizeWord(word);
-        if (!normalized.empty()) {
-            threadIndex.addWord(normalized, docID);
-        }
-    }
-}
-
-void processFile(const string& filename, int docID, ThreadIndex& threadIndex, size_t chunkSize = 64 * 1024 * 1024) {
-    ifstream file(filename, ios::binary | ios::ate);
-    if (!file.is_open()) {
-        cerr << "Error al abrir archivo: " << filename << endl;
+// Escribe el índice en orden alfabético intercalando los shards ya ordenados
+void saveIndexToTxt(const vector<vector<MergedTerm>>& shards, const string& filename) {
+    ofstream outFile(filename);
+    if (!outFile.is_open()) {
+        cerr << "No se pudo abrir el archivo para guardar el índice.\n";
         return;
     }
 
-    const size_t fileSize = file.tellg();
-    file.seekg(0, ios::beg);
-
-    vector<char> buffer(chunkSize);
-    size_t remaining = fileSize;
-    size_t overlapSize = 256; // Suficiente para la palabra más larga
-
-    while (remaining > 0) {
-        const size_t readSize = min(chunkSize, remaining);
-        file.read(buffer.data(), readSize);
+    // Montículo de (shard, posición) con el menor término arriba
+    vector<pair<size_t, size_t>> heap;
+    auto later = [&shards](const pair<size_t, size_t>& a, const pair<size_t, size_t>& b) {
+        return shards[a.first][a.second].term > shards[b.first][b.second].term;
+    };
+    for (size_t p = 0; p < shards.size(); ++p) {
+        if (!shards[p].empty()) heap.push_back({p, 0});
+    }
+    make_heap(heap.begin(), heap.end(), later);
 
-        // Encontrar el último espacio en blanco para dividir palabras correctamente
-        size_t validSize = readSize;
-        if (remaining > readSize) {
-            validSize = 0;
-            for (size_t i = readSize - 1; i > 0; --i) {
-                if (isspace(buffer[i])) {
-                    validSize = i + 1;
-                    break;
-                }
-            }
-            if (validSize == 0) validSize = readSize; // No se encontró espacio
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), later);
+        auto& top = heap.back();
+        const MergedTerm& entry = shards[top.first][top.second];
+        outFile << entry.term << ":";
+        for (uint32_t docID : entry.docs) {
+            outFile << " " << docID;
         }
-
-        processChunk(buffer.data(), buffer.data() + validSize, docID, threadIndex);
-
-        // Preparar para la siguiente lectura
-        if (remaining > readSize) {
-            // Mover el resto al inicio del buffer para la próxima lectura
-            size_t overlap = readSize - validSize;
-            memmove(buffer.data(), buffer.data() + validSize, overlap);
-            file.seekg(-static_cast<streamoff>(overlap), ios::cur);
-            remaining += overlap; // Ajustar el remaining
+        outFile << "\n";
+        if (++top.second < shards[top.first].size()) {
+            push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
         }
-
-        remaining -= validSize;
     }
 }
 
-void mergeIndexes(vector<unique_ptr<ThreadIndex>>& threadIndexes, unordered_map<string, unordered_set<int>>& globalIndex) {
-    // Primero recolectar todas las palabras únicas
-    unordered_set<string> allWords;
-    for (const auto& ti : threadIndexes) {
-        for (const auto& entry : ti->localIndex) {
-            allWords.insert(entry.first);
-        }
+// Listas de un shard ya codificadas, en el orden de sus términos
+struct EncodedShard {
+    string bytes;
+    vector<size_t> ends;     // fin de la lista de cada término en 'bytes'
+    vector<uint32_t> counts; // postings de cada término
+};
+
+// Codifica las listas de cada shard en paralelo y libera los postings sin comprimir
+vector<EncodedShard> encodeShards(ThreadPool& pool, vector<vector<MergedTerm>>& shards, CodecType codec,
+                                  const vector<uint32_t>& docLengths) {
+    vector<EncodedShard> encoded(shards.size());
+    for (size_t p = 0; p < shards.size(); ++p) {
+        pool.submit([&, p](size_t) {
+            EncodedShard& out = encoded[p];
+            vector<uint32_t> lengths;
+            for (MergedTerm& term : shards[p]) {
+                lengths.resize(term.docs.size());
+                for (size_t i = 0; i < term.docs.size(); ++i) {
+                    lengths[i] = term.docs[i] < docLengths.size() ? docLengths[term.docs[i]] : 0;
+                }
+                PostingListView::encode(codec, term.docs, term.tfs, lengths, out.bytes);
+                out.ends.push_back(out.bytes.size());
+                out.counts.push_back(static_cast<uint32_t>(term.docs.size()));
+                vector<uint32_t>().swap(term.docs);
+                vector<uint32_t>().swap(term.tfs);
+            }
+        });
     }
+    pool.wait();
+    return encoded;
+}
 
-    // Convertir a vector para procesamiento paralelo
-    vector<string> words(allWords.begin(), allWords.end());
+// Escribe lexicon.dat / docids.dat en el formato de InvertedIndex intercalando
+// los shards ya ordenados; el writer solo copia las listas codificadas.
+// Devuelve los términos, postings y bytes de listas escritos.
+IndexStatistics saveIndex(const vector<vector<MergedTerm>>& shards, const vector<EncodedShard>& encoded, CodecType codec,
+               vector<uint32_t> docLengths, const string& lexiconFile, const string& docidsFile) {
+    IndexFileWriter writer(lexiconFile, docidsFile, codec, move(docLengths));
 
-    #pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < words.size(); ++i) {
-        const string& word = words[i];
-        unordered_set<int> docIDs;
-        
-        for (const auto& ti : threadIndexes) {
-            auto it = ti->localIndex.find(word);
-            if (it != ti->localIndex.end()) {
-                docIDs.insert(it->second.begin(), it->second.end());
-            }
-        }
+    vector<pair<size_t, size_t>> heap;
+    auto later = [&shards](const pair<size_t, size_t>& a, const pair<size_t, size_t>& b) {
+        return shards[a.first][a.second].term > shards[b.first][b.second].term;
+    };
+    for (size_t p = 0; p < shards.size(); ++p) {
+        if (!shards[p].empty()) heap.push_back({p, 0});
+    }
+    make_heap(heap.begin(), heap.end(), later);
 
-        #pragma omp critical
-        {
-            globalIndex[word] = move(docIDs);
+    string term;
+    while (!heap.empty()) {
+        pop_heap(heap.begin(), heap.end(), later);
+        auto& top = heap.back();
+        const EncodedShard& lists = encoded[top.first];
+        size_t begin = top.second == 0 ? 0 : lists.ends[top.second - 1];
+        term.assign(shards[top.first][top.second].term);
+        writer.add_list(term, lists.bytes.data() + begin, lists.ends[top.second] - begin, lists.counts[top.second]);
+        if (++top.second < shards[top.first].size()) {
+            push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
         }
     }
+    writer.finish();
+    return writer.statistics();
 }
 
-void saveIndexToTxt(const unordered_map<string, unordered_set<int>>& index, const string& filename) {
-    ofstream outFile(filename);
-    if (!outFile.is_open()) {
-        cerr << "No se pudo abrir el archivo para guardar el índice.\n";
-        return;
+// Bytes de los archivos del corpus (los que no se pueden leer no cuentan)
+uint64_t corpusBytes(const vector<string>& files) {
+    uint64_t total = 0;
+    for (const string& file : files) {
+        error_code error;
+        uintmax_t size = fs::file_size(file, error);
+        if (!error) total += size;
     }
+    return total;
+}
 
-    // Convertir a vector para ordenar solo por palabra
-    vector<pair<string, unordered_set<int>>> sortedIndex(index.begin(), index.end());
-    sort(sortedIndex.begin(), sortedIndex.end(), 
-        [](const auto& a, const auto& b) { return a.first < b.first; });
+// Pasa las etapas del pipeline al registro: las tres corren a la vez, así que
+// cada una lleva el tiempo de reloj del pipeline y la CPU de sus hilos
+void recordPipeline(Metrics* metrics, const PipelineStats& stats) {
+    if (!metrics) return;
+    auto record = [&](const string& name, const vector<ThreadMetrics>& threads, uint64_t bytes, uint64_t items) {
+        StageMetrics stage;
+        stage.calls = 1;
+        stage.wall = stats.seconds;
+        stage.bytes = bytes;
+        stage.items = items;
+        stage.threads = threads;
+        for (const ThreadMetrics& thread : threads) stage.cpu += thread.cpu;
+        metrics->add_stage(name, stage);
+    };
+    record("read", stats.readers, stats.bytes, stats.chunks);
+    record("tokenize", stats.tokenizers, stats.bytes, stats.tokens);
+    record("index", stats.indexers, 0, stats.tokens);
+}
 
-    for (const auto& entry : sortedIndex) {
-        outFile << entry.first << ":";
-        // Convertir docIDs a vector para ordenarlos
-        vector<int> sortedDocs(entry.second.begin(), entry.second.end());
-        sort(sortedDocs.begin(), sortedDocs.end());
-        for (int docID : sortedDocs) {
-            outFile << " " << docID;
+// Uso: main2 [--spimi <MB>] [--docs file|line|delim:<texto>] [--chunk <MB>]
+//            [--buffers <n>] [--tokenizers <n>] [--indexers <n>] [--codec <nombre>]
+//            [--txt] [--metrics <archivo>] [--metrics-format json|prometheus]
+//            [archivos...]
+// El índice se guarda en lexicon.dat / docids.dat en el formato de
+// InvertedIndex, con el códec de --codec (gamma por defecto). --txt escribe
+// además inverted_index.txt, legible, para depurar.
+// Con --spimi el índice se arma con memoria acotada (SPIMI): cada hilo usa a lo
+// sumo su parte de los MB indicados, vuelca corridas al llenarse y al final se
+// fusionan en los mismos archivos.
+// --docs elige qué es un documento: cada archivo (por defecto), cada línea o
+// cada tramo entre apariciones de un delimitador. Los archivos se parten en
+// tramos de --chunk MB (16 por defecto) que indexan todos los hilos, así que
+// un solo archivo grande también se reparte.
+// Sin --spimi se indexa con un pipeline de etapas (IndexPipeline): un hilo lee
+// los tramos por adelantado a --buffers buffers (tope de memoria del texto),
+// --tokenizers hilos los tokenizan y --indexers hilos acumulan los postings.
+// --metrics guarda el tiempo de reloj y de CPU, los bytes y tokens por segundo
+// y el reparto entre hilos de cada etapa, el pico de memoria y el tamaño del
+// índice (ver Metrics.h), en JSON o en el formato de texto de Prometheus.
+// Compilado con -DNO_METRICS no se mide nada.
+int main(int argc, char* argv[]) {
+    auto start = high_resolution_clock::now(); // Tiempo de inicio
+
+    size_t spimiBudget = 0;
+    size_t buffers = 0, tokenizers = 0, indexers = 0;
+    CodecType codec = CodecType::Gamma;
+    bool textDump = false;
+    string metricsFile;
+    Metrics::Format metricsFormat = Metrics::Format::Json;
+    size_t chunkBytes = CorpusSplitter::DEFAULT_CHUNK;
+    DocumentModel model = DocumentModel::per_file();
+    vector<string> files;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--spimi" && i + 1 < argc) {
+            spimiBudget = static_cast<size_t>(stoull(argv[++i])) << 20;
+        } else if (arg == "--codec" && i + 1 < argc) {
+            if (!parse_codec(argv[++i], codec)) {
+                cerr << "Códec desconocido: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--txt") {
+            textDump = true;
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (arg == "--metrics-format" && i + 1 < argc) {
+            string format = argv[++i];
+            if (format == "prometheus") {
+                metricsFormat = Metrics::Format::Prometheus;
+            } else if (format != "json") {
+                cerr << "Formato de métricas desconocido: " << format << endl;
+                return 1;
+            }
+        } else if (arg == "--buffers" && i + 1 < argc) {
+            buffers = stoul(argv[++i]);
+        } else if (arg == "--tokenizers" && i + 1 < argc) {
+            tokenizers = stoul(argv[++i]);
+        } else if (arg == "--indexers" && i + 1 < argc) {
+            indexers = stoul(argv[++i]);
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            chunkBytes = static_cast<size_t>(stoull(argv[++i])) << 20;
+        } else if (arg == "--docs" && i + 1 < argc) {
+            string kind = argv[++i];
+            if (kind == "line") {
+                model = DocumentModel::per_line();
+            } else if (kind.compare(0, 6, "delim:") == 0) {
+                model = DocumentModel::per_delimiter(kind.substr(6));
+            } else if (kind != "file") {
+                cerr << "Modelo de documento desconocido: " << kind << endl;
+                return 1;
+            }
+        } else {
+            files.push_back(arg);
         }
-        outFile << "\n";
     }
-}
+    if (files.empty()) files = {"file1.txt", "file2.txt", "file3.txt", "file4.txt"};
 
-int main() {
-    auto start = high_resolution_clock::now(); // Tiempo de inicio
+    // Sin --metrics no hay registro y cada medición es un puntero nulo
+    unique_ptr<Metrics> metricsRegistry;
+    if (!metricsFile.empty()) {
+        if (!Metrics::enabled) cerr << "Métricas desactivadas al compilar (NO_METRICS): no se escribe " << metricsFile << endl;
+        metricsRegistry = make_unique<Metrics>();
+    }
+    Metrics* metrics = metricsRegistry.get();
+    auto saveMetrics = [&] {
+        if (!metrics || !Metrics::enabled) return true;
+        try {
+            metrics->save(metricsFile, metricsFormat);
+        } catch (const exception& e) {
+            cerr << "Excepción al guardar las métricas: " << e.what() << endl;
+            return false;
+        }
+        cout << "Métricas guardadas en " << metricsFile << "\n";
+        return true;
+    };
 
     // Configuración automática de hilos
     int numThreads = omp_get_max_threads();
     cout << "Usando " << numThreads << " hilos disponibles\n";
     omp_set_num_threads(numThreads);
+    ThreadPool pool(numThreads);
+    CorpusSplitter corpus(files, model, chunkBytes);
 
-    vector<string> files = {"file1.txt", "file2.txt", "file3.txt", "file4.txt"};
-    
-    // Crear índices por hilo para evitar contención
-    vector<unique_ptr<ThreadIndex>> threadIndexes(numThreads);
-    for (auto& ti : threadIndexes) {
-        ti = make_unique<ThreadIndex>();
+    if (spimiBudget > 0) {
+        SpimiOptions options;
+        options.memory_budget = max<size_t>(spimiBudget / numThreads, 1);
+        options.codec = codec;
+        vector<unique_ptr<SpimiThreadIndex>> threadIndexes(numThreads);
+        for (auto& ti : threadIndexes) {
+            ti = make_unique<SpimiThreadIndex>(options);
+        }
+
+        vector<SpimiIndexer*> indexers;
+        size_t runs = 0;
+        try {
+            Metrics::Stage tokenizeStage(metrics, "spimi_tokenize");
+            corpus.tokenize(pool, [&](size_t worker, string_view word, uint32_t docID) {
+                threadIndexes[worker]->addWord(word, static_cast<int>(docID));
+            });
+            for (auto& ti : threadIndexes) {
+                indexers.push_back(&ti->indexer);
+                runs += ti->indexer.run_count();
+                // Sin tiempos por hilo: el reparto se ve en los tokens de cada uno
+                ThreadMetrics thread;
+                thread.items = ti->indexer.token_count();
+                tokenizeStage.add_thread(thread);
+                tokenizeStage.add_items(thread.items);
+            }
+            if (metrics) tokenizeStage.add_bytes(corpusBytes(files));
+            tokenizeStage.finish();
+
+            Metrics::Stage mergeStage(metrics, "spimi_merge");
+            IndexStatistics written = SpimiIndexer::merge(indexers, "lexicon.dat", "docids.dat");
+            mergeStage.add_items(written.postings);
+            mergeStage.add_bytes(written.doclist_bytes);
+            mergeStage.finish();
+            if (metrics) {
+                metrics->record_index(written);
+                metrics->set("spimi_runs", static_cast<double>(runs));
+            }
+        } catch (const exception& e) {
+            cerr << "Excepción al indexar: " << e.what() << endl;
+            return 1;
+        }
+
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "Índice guardado en lexicon.dat / docids.dat (" << runs << " corridas antes del último volcado).\n";
+        cout << "Tiempo total de procesamiento: " << duration.count() << " ms" << endl;
+        return saveMetrics() ? 0 : 1;
+    }
+
+    // Acumular los postings es bastante más lento que tokenizar: la mayoría
+    // de los hilos van a los indexadores
+    PipelineOptions pipelineOptions;
+    pipelineOptions.tokenizers = tokenizers > 0 ? tokenizers : max(1, numThreads / 4);
+    pipelineOptions.indexers = indexers > 0 ? indexers : max<size_t>(1, numThreads - pipelineOptions.tokenizers);
+    pipelineOptions.buffers = buffers > 0 ? buffers : max<size_t>(8, 2 * pipelineOptions.tokenizers);
+    IndexPipeline pipeline(corpus, pipelineOptions);
+
+    auto tokenizeStart = steady_clock::now();
+    try {
+        pipeline.run(pool);
+    } catch (const exception& e) {
+        cerr << "Excepción al indexar: " << e.what() << endl;
+        return 1;
     }
+    double tokenizeSeconds = duration<double>(steady_clock::now() - tokenizeStart).count();
+    recordPipeline(metrics, pipeline.statistics());
 
-    // Procesar archivos en paralelo
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < files.size(); ++i) {
-        int threadNum = omp_get_thread_num();
-        processFile(files[i], i, *threadIndexes[threadNum]);
+    // Tiempo de cada etapa (sumado entre sus hilos) trabajando y esperando
+    const PipelineStats& stats = pipeline.statistics();
+    cout << "Pipeline: " << stats.chunks << " tramos, " << (stats.bytes >> 20) << " MB en "
+         << tokenizeSeconds << " s con " << pipelineOptions.buffers << " buffers\n";
+    cout << "  lectura:      " << stats.read_busy << " s trabajando, " << stats.read_wait << " s esperando\n";
+    cout << "  tokenizado:   " << stats.tokenize_busy << " s trabajando, " << stats.tokenize_wait << " s esperando\n";
+    cout << "  acumulación:  " << stats.index_busy << " s trabajando, " << stats.index_wait << " s esperando\n";
+
+    // Tokens por segundo de cada indexador (sobre el tiempo del pipeline)
+    // y reservas de memoria de su acumulador por millón de tokens
+    vector<const TermAccumulator*> sources = pipeline.sources();
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const TermAccumulator& terms = *sources[i];
+        double millions = max<double>(terms.token_count(), 1) / 1e6;
+        cout << "Indexador " << i << ": " << terms.token_count() << " tokens, "
+             << static_cast<uint64_t>(terms.token_count() / tokenizeSeconds) << " tokens/s, "
+             << terms.term_count() << " términos, "
+             << terms.allocation_count() / millions << " reservas por millón de tokens, "
+             << (terms.memory_bytes() >> 20) << " MB\n";
     }
 
     // Fusionar índices
-    unordered_map<string, unordered_set<int>> globalIndex;
-    mergeIndexes(threadIndexes, globalIndex);
+    auto mergeStart = steady_clock::now();
+    Metrics::Stage mergeStage(metrics, "merge");
+    vector<vector<MergedTerm>> shards = mergeIndexes(pool, sources);
+    mergeStage.add_items(stats.tokens);
+    mergeStage.finish();
+    cout << "Fusión de " << shards.size() << " shards: "
+         << duration_cast<milliseconds>(steady_clock::now() - mergeStart).count() << " ms\n";
+
+    // Texto legible solo para depurar: es bastante más lento que el binario
+    if (textDump) {
+        Metrics::Stage textStage(metrics, "save_txt");
+        saveIndexToTxt(shards, "inverted_index.txt");
+        if (metrics) {
+            error_code error;
+            uintmax_t size = fs::file_size("inverted_index.txt", error);
+            if (!error) textStage.add_bytes(size);
+        }
+    }
 
-    // Guardar en archivo de texto
-    saveIndexToTxt(globalIndex, "inverted_index.txt");
+    auto saveStart = steady_clock::now();
+    try {
+        Metrics::Stage encodeStage(metrics, "encode");
+        vector<EncodedShard> encoded = encodeShards(pool, shards, codec, pipeline.document_lengths());
+        for (const EncodedShard& shard : encoded) {
+            encodeStage.add_bytes(shard.bytes.size());
+            for (uint32_t count : shard.counts) encodeStage.add_items(count);
+        }
+        encodeStage.finish();
+        auto writeStart = steady_clock::now();
+        Metrics::Stage writeStage(metrics, "write");
+        IndexStatistics written =
+            saveIndex(shards, encoded, codec, pipeline.document_lengths(), "lexicon.dat", "docids.dat");
+        writeStage.add_bytes(written.doclist_bytes);
+        writeStage.add_items(written.terms);
+        writeStage.finish();
+        if (metrics) metrics->record_index(written);
+        cout << "Índice guardado en lexicon.dat / docids.dat (" << codec_name(codec) << "): codificación "
+             << duration_cast<milliseconds>(writeStart - saveStart).count() << " ms, escritura "
+             << duration_cast<milliseconds>(steady_clock::now() - writeStart).count() << " ms\n";
+    } catch (const exception& e) {
+        cerr << "Excepción al guardar el índice: " << e.what() << endl;
+        return 1;
+    }
 
     // Medir el tiempo total
     auto end = high_resolution_clock::now();
@@ -209,5 +422,5 @@ int main() {
     cout << "Índice invertido construido y guardado exitosamente.\n";
     cout << "Tiempo total de procesamiento: " << duration.count() << " ms" << endl;
 
-    return 0;
+    return saveMetrics() ? 0 : 1;
 }
@@ -0,0 +1,114 @@
+// Prueba de los lotes de QueryEngine: search_batch y top_k_batch tienen que
+// dar, consulta por consulta, lo mismo que search y top_k de a una, también
+// cuando en un lote hay consultas repetidas o que solo se distinguen en cómo
+// se rankean ("a b" es una lista de términos para top_k y "a AND b" una
+// conjunción). Usa un índice chico armado a mano y otro al azar con
+// CorpusGenerator. Termina con 1 si algún resultado difiere.
+//
+// Compilar: g++ -O2 -std=c++17 -mavx2 query_batch_check.cpp -o query_batch_check
+#include "QueryEngine.h"
+#include "CorpusGenerator.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstdint>
+
+using namespace std;
+
+static size_t failures = 0;
+
+static void fail(const string& what) {
+    if (++failures <= 20) cerr << "FALLA: " << what << endl;
+}
+
+static string describe(const vector<ScoredDoc>& docs) {
+    string out;
+    for (const auto& doc : docs) out += to_string(doc.doc) + ' ';
+    return out;
+}
+
+// Evalúa 'queries' en un lote y una por una, y compara
+static void check_batch(const QueryEngine& engine, const vector<string>& queries, const vector<size_t>& ks) {
+    vector<unique_ptr<QueryNode>> roots;
+    vector<const QueryNode*> nodes;
+    for (const auto& query : queries) {
+        roots.push_back(QueryParser::parse(query));
+        nodes.push_back(roots.back().get());
+    }
+
+    auto searched = engine.search_batch(nodes);
+    auto ranked = engine.top_k_batch(nodes, ks);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (*searched[i] != engine.search(queries[i])) fail("search_batch de \"" + queries[i] + "\"");
+        vector<ScoredDoc> alone = engine.top_k(queries[i], ks[i]);
+        bool same = alone.size() == ranked[i].size();
+        for (size_t j = 0; same && j < alone.size(); ++j) {
+            same = alone[j].doc == ranked[i][j].doc && alone[j].score == ranked[i][j].score;
+        }
+        if (!same) {
+            fail("top_k_batch de \"" + queries[i] + "\" con k = " + to_string(ks[i]) + ": " + describe(ranked[i]) +
+                 "en lugar de " + describe(alone));
+        }
+    }
+}
+
+int main() {
+    size_t batches = 0;
+
+    // Doc 1 tiene los dos términos; 2 y 3, uno cada uno
+    InvertedIndex small;
+    small.add_documents(vector<pair<uint32_t, vector<string>>>{{1, {"a", "b"}}, {2, {"a"}}, {3, {"b"}}});
+    QueryEngine small_engine(small);
+    check_batch(small_engine, {"a b", "a AND b"}, {10, 10});
+    check_batch(small_engine, {"a AND b", "a b"}, {10, 10});
+    check_batch(small_engine, {"a b", "b a", "a OR b", "b AND a", "a NOT b"}, {10, 10, 10, 10, 10});
+    check_batch(small_engine, {"a b", "a b", "a b"}, {1, 3, 1});
+    batches += 4;
+
+    CorpusSpec spec;
+    spec.documents = 3000;
+    spec.vocabulary = 2000;
+    spec.mean_length = 40;
+    CorpusGenerator generator(spec);
+    vector<pair<uint32_t, vector<string>>> documents(spec.documents);
+    vector<uint32_t> ranks;
+    for (uint32_t doc = 0; doc < spec.documents; ++doc) {
+        generator.next_document(ranks);
+        documents[doc].first = doc;
+        for (uint32_t rank : ranks) documents[doc].second.push_back(CorpusGenerator::word(rank));
+    }
+    InvertedIndex index;
+    index.add_documents(documents);
+    QueryEngine engine(index);
+
+    // Formas con los mismos términos que se evalúan distinto, mezcladas en cada lote
+    const char* forms[] = {"%a %b", "%a AND %b", "%a OR %b", "%b %a", "%a NOT %b", "(%a OR %c) AND %b",
+                           "%a %b %c", "%a AND %b AND %c", "%c*", "%a~1 %b"};
+    mt19937 rng(12345);
+    for (int round = 0; round < 50; ++round) {
+        vector<string> queries;
+        vector<size_t> ks;
+        for (int i = 0; i < 24; ++i) {
+            string words[] = {CorpusGenerator::word(rng() % 30), CorpusGenerator::word(rng() % 300),
+                              CorpusGenerator::word(rng() % 10)};
+            if (i % 4 == 3) words[0] = CorpusGenerator::word(round % 30); // se repiten términos entre consultas
+            string form = forms[rng() % (sizeof(forms) / sizeof(forms[0]))], query;
+            for (size_t k = 0; k < form.size(); ++k) {
+                query += form[k] == '%' ? words[form[++k] - 'a'] : string(1, form[k]);
+            }
+            queries.push_back(query);
+            ks.push_back(rng() % 4 == 0 ? size_t(UINT32_MAX) : 1 + rng() % 20);
+        }
+        // Una consulta repetida con el mismo k
+        queries.push_back(queries[0]);
+        ks.push_back(ks[0]);
+        check_batch(engine, queries, ks);
+        ++batches;
+    }
+
+    cout << batches << " lotes, " << failures << " fallas" << endl;
+    return failures == 0 ? 0 : 1;
+}
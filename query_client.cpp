@@ -0,0 +1,251 @@
+// Generador de carga para query_server: abre --connections conexiones, cada una
+// con --depth pedidos en vuelo, y manda consultas hasta completar --requests o
+// pasar --duration segundos. Al final escribe en stdout una línea JSON con los
+// pedidos por segundo y la latencia (p50, p99, p99.9 y máxima, en µs) medida
+// desde que se manda cada pedido hasta que llega su respuesta.
+//
+//   query_client <socket> [--connections n] [--depth n] [--requests n]
+//                [--duration s] [--top-k k] [--queries archivo]
+//                [--seed n] [--vocabulary n] [--zipf s]
+//
+// Las consultas salen de --queries (una por línea) o se generan: de uno a tres
+// términos de Zipf (CorpusGenerator.h) unidos con AND u OR, así que con los
+// mismos --seed, --vocabulary y --zipf que "benchmark generate" se consultan
+// palabras que están en el índice. Con --top-k se piden los k mejores por
+// BM25 en lugar de todos los documentos.
+//
+// Compilar: g++ -O2 -std=c++17 -pthread query_client.cpp -o query_client
+#include "QueryProtocol.h"
+#include "CorpusGenerator.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace chrono;
+
+struct Options {
+    string socket;
+    size_t connections = 4;
+    size_t depth = 8;
+    uint64_t requests = 100000;
+    double duration = 0; // 0 = sin límite de tiempo
+    uint32_t top_k = 0;
+    string queries;
+    CorpusSpec corpus;
+};
+
+struct ConnectionResult {
+    vector<double> latencies; // segundos
+    uint64_t errors = 0;
+    uint64_t documents = 0;
+    string failure;
+};
+
+static int connect_to(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw runtime_error("Ruta de socket demasiado larga: " + path);
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw runtime_error(string("No se pudo crear el socket: ") + strerror(errno));
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        string error = strerror(errno);
+        ::close(fd);
+        throw runtime_error("No se pudo conectar a " + path + ": " + error);
+    }
+    return fd;
+}
+
+static void send_all(int fd, const string& bytes) {
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw runtime_error(string("Error al enviar: ") + strerror(errno));
+        sent += static_cast<size_t>(n);
+    }
+}
+
+static vector<string> generate_queries(const CorpusSpec& spec, size_t count) {
+    CorpusGenerator generator(spec);
+    vector<string> queries;
+    for (size_t i = 0; i < count; ++i) {
+        size_t terms = 1 + i % 3;
+        string query = CorpusGenerator::word(generator.next_rank());
+        for (size_t t = 1; t < terms; ++t) {
+            query += (i / 3) % 2 == 0 ? " AND " : " OR ";
+            query += CorpusGenerator::word(generator.next_rank());
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+// Una conexión: mantiene 'depth' pedidos en vuelo mientras queden por mandar
+static void drive(const Options& options, const vector<string>& queries, atomic<uint64_t>& issued,
+                  steady_clock::time_point deadline, ConnectionResult& result) {
+    int fd = connect_to(options.socket);
+    QueryOp op = options.top_k > 0 ? QueryOp::TopK : QueryOp::Search;
+    unordered_map<uint32_t, steady_clock::time_point> in_flight;
+    uint32_t next_id = 0;
+    string out, in;
+    char buffer[1 << 16];
+    QueryResponse response;
+    bool timed = options.duration > 0;
+    try {
+        for (;;) {
+            out.clear();
+            while (in_flight.size() < options.depth && (!timed || steady_clock::now() < deadline) &&
+                   issued.fetch_add(1, memory_order_relaxed) < options.requests) {
+                QueryRequest request;
+                request.id = next_id++;
+                request.op = op;
+                request.k = options.top_k;
+                request.query = queries[request.id * 7919u % queries.size()];
+                append_request(out, request);
+                in_flight.emplace(request.id, steady_clock::now());
+            }
+            if (!out.empty()) send_all(fd, out);
+            if (in_flight.empty()) break;
+
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw runtime_error("El servidor cerró la conexión");
+            in.append(buffer, static_cast<size_t>(n));
+            size_t offset = 0;
+            while (size_t used = parse_response(in.data() + offset, in.size() - offset, op, response)) {
+                offset += used;
+                auto it = in_flight.find(response.id);
+                if (it == in_flight.end()) throw runtime_error("Respuesta a un pedido desconocido");
+                result.latencies.push_back(duration<double>(steady_clock::now() - it->second).count());
+                in_flight.erase(it);
+                if (response.status != QueryStatus::Ok) {
+                    if (result.errors++ == 0) cerr << "Error del servidor: " << response.error << endl;
+                }
+                result.documents += op == QueryOp::TopK ? response.scored.size() : response.docs.size();
+            }
+            in.erase(0, offset);
+        }
+    } catch (const exception& e) {
+        result.failure = e.what();
+    }
+    ::close(fd);
+}
+
+static double percentile(const vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t at = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[min(at, sorted.size() - 1)];
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Uso: " << argv[0] << " <socket> [--connections n] [--depth n] [--requests n] [--duration s]"
+             << " [--top-k k] [--queries archivo] [--seed n] [--vocabulary n] [--zipf s]" << endl;
+        return 1;
+    }
+    Options options;
+    options.socket = argv[1];
+    try {
+        for (int i = 2; i < argc; ++i) {
+            string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--connections" && has_value) {
+                options.connections = max<size_t>(1, stoul(argv[++i]));
+            } else if (arg == "--depth" && has_value) {
+                options.depth = max<size_t>(1, stoul(argv[++i]));
+            } else if (arg == "--requests" && has_value) {
+                options.requests = stoull(argv[++i]);
+            } else if (arg == "--duration" && has_value) {
+                options.duration = stod(argv[++i]);
+                if (options.requests == Options().requests) options.requests = UINT64_MAX;
+            } else if (arg == "--top-k" && has_value) {
+                options.top_k = static_cast<uint32_t>(stoul(argv[++i]));
+            } else if (arg == "--queries" && has_value) {
+                options.queries = argv[++i];
+            } else if (arg == "--seed" && has_value) {
+                options.corpus.seed = stoull(argv[++i]);
+            } else if (arg == "--vocabulary" && has_value) {
+                options.corpus.vocabulary = static_cast<uint32_t>(stoul(argv[++i]));
+            } else if (arg == "--zipf" && has_value) {
+                options.corpus.zipf = stod(argv[++i]);
+            } else {
+                cerr << "Opción desconocida: " << arg << endl;
+                return 1;
+            }
+        }
+    } catch (const exception&) {
+        cerr << "Valor inválido en las opciones" << endl;
+        return 1;
+    }
+
+    vector<string> queries;
+    if (!options.queries.empty()) {
+        ifstream in(options.queries);
+        if (!in) {
+            cerr << "No se pudo abrir el archivo: " << options.queries << endl;
+            return 1;
+        }
+        for (string line; getline(in, line);) {
+            if (!line.empty()) queries.push_back(line);
+        }
+    } else {
+        queries = generate_queries(options.corpus, 65536);
+    }
+    if (queries.empty()) {
+        cerr << "No hay consultas" << endl;
+        return 1;
+    }
+
+    atomic<uint64_t> issued{0};
+    vector<ConnectionResult> results(options.connections);
+    vector<thread> threads;
+    auto start = steady_clock::now();
+    auto deadline = start + duration_cast<steady_clock::duration>(duration<double>(options.duration));
+    for (size_t c = 0; c < options.connections; ++c) {
+        threads.emplace_back([&, c] { drive(options, queries, issued, deadline, results[c]); });
+    }
+    for (auto& t : threads) t.join();
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    vector<double> latencies;
+    uint64_t errors = 0, documents = 0;
+    for (const auto& result : results) {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        errors += result.errors;
+        documents += result.documents;
+        if (!result.failure.empty()) {
+            cerr << "Conexión interrumpida: " << result.failure << endl;
+            return 1;
+        }
+    }
+    sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double latency : latencies) sum += latency;
+
+    cout << "{\"benchmark\":\"" << (options.top_k > 0 ? "server_top_k" : "server_search") << "\""
+         << ",\"connections\":" << options.connections << ",\"depth\":" << options.depth
+         << ",\"requests\":" << latencies.size() << ",\"errors\":" << errors << ",\"documents\":" << documents
+         << ",\"seconds\":" << seconds << ",\"qps\":" << latencies.size() / seconds
+         << ",\"latency_mean_us\":" << (latencies.empty() ? 0 : sum / latencies.size() * 1e6)
+         << ",\"latency_p50_us\":" << percentile(latencies, 0.5) * 1e6
+         << ",\"latency_p99_us\":" << percentile(latencies, 0.99) * 1e6
+         << ",\"latency_p999_us\":" << percentile(latencies, 0.999) * 1e6
+         << ",\"latency_max_us\":" << (latencies.empty() ? 0 : latencies.back() * 1e6) << "}" << endl;
+    return 0;
+}
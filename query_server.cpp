@@ -0,0 +1,130 @@
+// Servidor de consultas: carga (mapea) el índice una vez y lo atiende por un
+// socket Unix con el protocolo de QueryProtocol.h (ver QueryServer.h), así los
+// programas que consultan no cargan cada uno su copia. Corre hasta SIGINT o
+// SIGTERM; al salir, con --metrics guarda la latencia de cada pedido (desde
+// que llegó hasta que se respondió), los lotes y las cachés.
+//
+//   query_server <socket> [--lexicon archivo] [--docids archivo] [--workers n]
+//                [--max-batch n] [--cache-mb n] [--metrics archivo]
+//                [--metrics-format json|prometheus]
+//
+// Por defecto usa lexicon.dat / docids.dat, los que escribe main2. --cache-mb
+// reparte esos MB entre la caché de listas y la de resultados (0 = sin caché).
+//
+// Compilar: g++ -O2 -std=c++17 -mavx2 -pthread query_server.cpp -o query_server
+#include "InvertedIndex.h"
+#include "QueryServer.h"
+#include "SearchCache.h"
+#include "Metrics.h"
+
+#include <iostream>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <csignal>
+
+using namespace std;
+using namespace chrono;
+
+static QueryServer* running = nullptr;
+
+static void on_signal(int) {
+    if (running) running->stop();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Uso: " << argv[0] << " <socket> [--lexicon archivo] [--docids archivo] [--workers n]"
+             << " [--max-batch n] [--cache-mb n] [--metrics archivo] [--metrics-format json|prometheus]" << endl;
+        return 1;
+    }
+    QueryServerOptions options;
+    options.socket_path = argv[1];
+    string lexiconFile = "lexicon.dat", docidsFile = "docids.dat";
+    size_t cacheMb = 64;
+    string metricsFile;
+    Metrics::Format metricsFormat = Metrics::Format::Json;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--lexicon" && i + 1 < argc) {
+                lexiconFile = argv[++i];
+            } else if (arg == "--docids" && i + 1 < argc) {
+                docidsFile = argv[++i];
+            } else if (arg == "--workers" && i + 1 < argc) {
+                options.workers = max<size_t>(1, stoul(argv[++i]));
+            } else if (arg == "--max-batch" && i + 1 < argc) {
+                options.max_batch = max<size_t>(1, stoul(argv[++i]));
+            } else if (arg == "--cache-mb" && i + 1 < argc) {
+                cacheMb = stoul(argv[++i]);
+            } else if (arg == "--metrics" && i + 1 < argc) {
+                metricsFile = argv[++i];
+            } else if (arg == "--metrics-format" && i + 1 < argc) {
+                string format = argv[++i];
+                if (format == "prometheus") {
+                    metricsFormat = Metrics::Format::Prometheus;
+                } else if (format != "json") {
+                    cerr << "Formato de métricas desconocido: " << format << endl;
+                    return 1;
+                }
+            } else {
+                cerr << "Opción desconocida: " << arg << endl;
+                return 1;
+            }
+        }
+    } catch (const exception&) {
+        cerr << "Valor inválido en las opciones" << endl;
+        return 1;
+    }
+
+    try {
+        Metrics metrics;
+        InvertedIndex index;
+        if (!metricsFile.empty()) index.set_metrics(&metrics);
+
+        unique_ptr<SearchCache> cache;
+        if (cacheMb > 0) {
+            SearchCacheOptions cacheOptions;
+            cacheOptions.posting_bytes = (cacheMb << 20) * 3 / 4;
+            cacheOptions.result_bytes = (cacheMb << 20) / 4;
+            cache = make_unique<SearchCache>(cacheOptions);
+            index.set_cache(cache.get());
+        }
+
+        auto start = steady_clock::now();
+        {
+            Metrics::Stage stage(&metrics, "load");
+            index.load_from_files(lexiconFile, docidsFile);
+        }
+        if (index.term_count() == 0) {
+            cerr << "El índice está vacío o no se pudo leer: " << lexiconFile << ", " << docidsFile << endl;
+            return 1;
+        }
+
+        QueryServer server(index, options);
+        cerr << "Índice cargado en " << duration<double>(steady_clock::now() - start).count() << " s ("
+             << index.term_count() << " términos, " << index.doc_count() << " documentos); escuchando en "
+             << options.socket_path << " con " << options.workers << " workers" << endl;
+
+        running = &server;
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+        server.run();
+        running = nullptr;
+
+        QueryServerStats stats = server.statistics();
+        cerr << stats.requests << " pedidos en " << stats.batches << " lotes (media " << stats.mean_batch()
+             << ", máximo " << stats.largest_batch << "), " << stats.errors << " errores" << endl;
+
+        if (!metricsFile.empty() && Metrics::enabled) {
+            server.record(metrics);
+            if (cache) cache->record(metrics);
+            metrics.record_index(index.statistics());
+            metrics.save(metricsFile, metricsFormat);
+        }
+    } catch (const exception& e) {
+        cerr << "Excepción: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
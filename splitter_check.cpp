@@ -0,0 +1,136 @@
+// Prueba de CorpusSplitter: tokeniza archivos al azar en tramos, con tamaños
+// de tramo y delimitadores al azar, y compara los pares (doc, término) y la
+// cantidad de documentos con los de tokenizar cada archivo entero de una vez.
+// Los textos mezclan palabras largas, separadores variados y apariciones del
+// delimitador que se solapan ("\n\n\n" con "\n\n", "ababa" con "aba") o que
+// tienen espacios adentro (" | "), para que los cortes caigan en todos los
+// casos de cut_after. Conviene correrla también
+// con -fsanitize=address,undefined. Termina con 1 si algún par difiere.
+//
+// Compilar: g++ -O2 -std=c++17 -pthread splitter_check.cpp -o splitter_check
+#include "CorpusSplitter.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+
+using namespace std;
+
+static size_t failures = 0;
+
+static void fail(const string& what) {
+    if (++failures <= 20) cerr << "FALLA: " << what << endl;
+}
+
+using Postings = vector<pair<uint32_t, string>>;
+
+// Texto con palabras de todos los largos (ninguna llega a un tramo, así que
+// siempre hay un espacio donde cortar), separadores y el delimitador
+static string random_text(mt19937& rng, const string& delimiter) {
+    static const char* separators[] = {" ", "  ", "\n", "\t", ", ", ". ", "\r\n"};
+    static const string letters = "abcdeABCDE0123ñ-_'";
+    size_t length = rng() % 4 == 0 ? rng() % 64 : rng() % 60000;
+    string text;
+    while (text.size() < length) {
+        unsigned pick = rng() % 20;
+        if (pick < 3 && !delimiter.empty()) {
+            for (unsigned k = 1 + rng() % 3; k > 0; --k) text += delimiter; // a veces seguidos
+        } else if (pick == 3 && !delimiter.empty()) {
+            text += delimiter.substr(0, 1 + rng() % delimiter.size()); // prefijo que no llega a serlo
+        } else if (pick < 7) {
+            text += separators[rng() % (sizeof(separators) / sizeof(separators[0]))];
+        } else {
+            size_t word = rng() % 50 == 0 ? 500 + rng() % 3000 : 1 + rng() % 12;
+            for (size_t i = 0; i < word; ++i) text += letters[rng() % letters.size()];
+            text += ' ';
+        }
+    }
+    return text;
+}
+
+// Referencia: cada archivo entero, partido en documentos con string::find
+static uint32_t reference(const vector<string>& texts, const DocumentModel& model, Postings& out) {
+    uint32_t doc = 0;
+    for (size_t f = 0; f < texts.size(); ++f) {
+        string text = texts[f];
+        auto emit = [&out, &doc](string_view term) { out.emplace_back(doc, string(term)); };
+        if (model.kind == DocumentModel::Kind::File) {
+            tokenize_in_place(&text[0], &text[0] + text.size(), emit);
+            ++doc;
+            continue;
+        }
+        size_t start = 0;
+        for (size_t at = text.find(model.delimiter); at != string::npos; at = text.find(model.delimiter, start)) {
+            tokenize_in_place(&text[0] + start, &text[0] + at, emit);
+            start = at + model.delimiter.size();
+            ++doc;
+        }
+        tokenize_in_place(&text[0] + start, &text[0] + text.size(), emit);
+        if (start < text.size()) ++doc;
+    }
+    sort(out.begin(), out.end());
+    return doc;
+}
+
+int main() {
+    filesystem::path dir = filesystem::temp_directory_path() / "splitter_check";
+    filesystem::create_directories(dir);
+
+    // Los que tienen espacios adentro obligan a cut_after a retroceder
+    const string delimiters[] = {"", "\n", "\n\n", "@@", "aba", "---\n", "</doc>", "a", " | ", "\n \n", "\r\n\r\n"};
+    const size_t chunk_sizes[] = {1, 4096, 4097, 5000, 8191, 20000, CorpusSplitter::DEFAULT_CHUNK};
+    mt19937 rng(2024);
+    ThreadPool pool(4);
+    size_t rounds = 0;
+
+    for (int round = 0; round < 220; ++round) {
+        const string& delimiter = delimiters[round % (sizeof(delimiters) / sizeof(delimiters[0]))];
+        DocumentModel model = delimiter.empty() ? DocumentModel::per_file() : DocumentModel::per_delimiter(delimiter);
+        size_t chunk_bytes = chunk_sizes[rng() % (sizeof(chunk_sizes) / sizeof(chunk_sizes[0]))];
+
+        vector<string> texts(1 + rng() % 4), files;
+        for (size_t f = 0; f < texts.size(); ++f) {
+            texts[f] = random_text(rng, delimiter);
+            if (!delimiter.empty() && rng() % 3 == 0) texts[f] += delimiter; // termina con el delimitador
+            files.push_back((dir / ("f" + to_string(f))).string());
+            ofstream(files.back(), ios::binary) << texts[f];
+        }
+
+        Postings expected;
+        uint32_t expected_docs = reference(texts, model, expected);
+
+        CorpusSplitter splitter(files, model, chunk_bytes);
+        vector<Postings> by_worker(pool.size());
+        uint32_t docs = splitter.tokenize(pool, [&by_worker](size_t worker, string_view term, uint32_t doc) {
+            by_worker[worker].emplace_back(doc, string(term));
+        });
+        Postings got;
+        for (auto& postings : by_worker) got.insert(got.end(), postings.begin(), postings.end());
+        sort(got.begin(), got.end());
+
+        string where = "ronda " + to_string(round) + " (delimitador \"" + delimiter + "\", tramos de " +
+                       to_string(chunk_bytes) + ")";
+        if (docs != expected_docs) {
+            fail(where + ": " + to_string(docs) + " documentos en lugar de " + to_string(expected_docs));
+        }
+        if (got != expected) {
+            auto diff = mismatch(got.begin(), got.end(), expected.begin(), expected.end());
+            string detail = diff.first == got.end() ? "faltan pares"
+                                                    : "primer par distinto (" + to_string(diff.first->first) +
+                                                          ", " + diff.first->second.substr(0, 20) + ")";
+            fail(where + ": " + to_string(got.size()) + " pares en lugar de " + to_string(expected.size()) + ", " +
+                 detail);
+        }
+        ++rounds;
+    }
+
+    filesystem::remove_all(dir);
+    cout << rounds << " rondas, " << failures << " fallas" << endl;
+    return failures == 0 ? 0 : 1;
+}
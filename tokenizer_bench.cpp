@@ -0,0 +1,133 @@
+// Mide el tokenizador en GB/s por núcleo (un solo hilo) contra la versión
+// anterior de main2.cpp (isspace por byte, std::string por palabra y
+// normalizeWord con std::locale). Sin archivo se genera texto de prueba.
+//
+//   tokenizer_bench [archivo] [MB]
+//
+// Compilar: g++ -O2 -std=c++17 -mavx2 tokenizer_bench.cpp -o tokenizer_bench
+#include "Tokenizer.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <locale>
+#include <random>
+#include <chrono>
+#include <cctype>
+
+using namespace std;
+using namespace chrono;
+
+// Versión anterior, para comparar
+static string normalizeWord(const string& word) {
+    string normalized;
+    locale loc;
+
+    normalized.reserve(word.size());
+    for (auto& ch : word) {
+        if (isalpha(ch, loc)) {
+            normalized += tolower(ch, loc);
+        }
+    }
+    return normalized;
+}
+
+template <typename Callback>
+static void processChunkLocale(const char* start, const char* end, Callback&& callback) {
+    const char* wordStart = start;
+    string word;
+    for (const char* p = start; p != end; ++p) {
+        if (isspace(*p)) {
+            if (wordStart != p) {
+                word.assign(wordStart, p);
+                string normalized = normalizeWord(word);
+                if (!normalized.empty()) callback(normalized);
+            }
+            wordStart = p + 1;
+        }
+    }
+    if (wordStart != end) {
+        word.assign(wordStart, end);
+        string normalized = normalizeWord(word);
+        if (!normalized.empty()) callback(normalized);
+    }
+}
+
+// Palabras de largo variable con mayúsculas y algo de puntuación
+static string generate_text(size_t bytes) {
+    mt19937 rng(42);
+    const char* punctuation = ".,;:'\"()-";
+    string text;
+    text.reserve(bytes + 32);
+    while (text.size() < bytes) {
+        size_t length = 1 + rng() % 10;
+        for (size_t i = 0; i < length; ++i) {
+            char ch = static_cast<char>('a' + rng() % 26);
+            if (i == 0 && rng() % 8 == 0) ch = static_cast<char>(toupper(ch));
+            text += ch;
+        }
+        if (rng() % 10 == 0) text += punctuation[rng() % 9];
+        text += rng() % 16 == 0 ? '\n' : ' ';
+    }
+    return text;
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 2 ? stoul(argv[2]) : 256;
+    string text;
+    if (argc > 1 && string(argv[1]) != "-") {
+        ifstream in(argv[1], ios::binary);
+        if (!in) {
+            cerr << "No se pudo abrir el archivo: " << argv[1] << endl;
+            return 1;
+        }
+        text.resize(megabytes << 20);
+        in.read(&text[0], static_cast<streamsize>(text.size()));
+        text.resize(static_cast<size_t>(in.gcount()));
+    } else {
+        text = generate_text(megabytes << 20);
+    }
+
+    const char* simd = "escalar";
+#if defined(__AVX2__)
+    simd = "avx2";
+#elif defined(__SSE2__)
+    simd = "sse2";
+#endif
+
+    // El tokenizador modifica el buffer: cada vuelta trabaja sobre una copia
+    string buffer;
+    size_t tokens = 0, checksum = 0;
+    double best = 1e30;
+    for (int round = 0; round < 3; ++round) {
+        buffer = text;
+        tokens = checksum = 0;
+        auto start = steady_clock::now();
+        tokenize_in_place(&buffer[0], &buffer[0] + buffer.size(), [&](string_view word) {
+            ++tokens;
+            checksum += word.size();
+        });
+        best = min(best, duration<double>(steady_clock::now() - start).count());
+    }
+
+    size_t old_tokens = 0, old_checksum = 0;
+    auto start = steady_clock::now();
+    processChunkLocale(text.data(), text.data() + text.size(), [&](const string& word) {
+        ++old_tokens;
+        old_checksum += word.size();
+    });
+    double old_seconds = duration<double>(steady_clock::now() - start).count();
+
+    double gigabytes = text.size() / 1e9;
+    cout << "bytes " << text.size() << ", tokens " << tokens << "\n";
+    cout << "tokenize_in_place (" << simd << "): " << gigabytes / best << " GB/s, "
+         << tokens / best / 1e6 << " Mtokens/s\n";
+    cout << "normalizeWord + locale: " << gigabytes / old_seconds << " GB/s, "
+         << old_tokens / old_seconds / 1e6 << " Mtokens/s\n";
+    if (tokens != old_tokens || checksum != old_checksum) {
+        cerr << "Los tokenizadores no coinciden\n";
+        return 1;
+    }
+    return 0;
+}